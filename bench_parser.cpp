@@ -0,0 +1,316 @@
+// Бенчмарк: parse_uart с PacketCallback против uart::Parser с лямбдой.
+//
+// Оба пути получают один и тот же поток пакетов одинаковыми порциями и
+// должны выдать одинаковое число пакетов и одинаковую сумму байтов тела;
+// то же проверяется для вытягивания пакетов через parser_next_packet.
+// Отдельно меряется parse_uart с фильтром типов: он должен выдать ровно
+// пакеты принятых типов из нефильтрованного прогона. Для него сравниваются
+// только типы и размеры: при дочитывании тела parse_uart оставляет в body
+// байты предыдущего пакета, а пропущенные пакеты body не заполняют.
+// Многоканальный прогон сравнивает parse_uart по массиву Parser с
+// MultiParser, когда каждый из kChannels каналов получает по kChannelChunk
+// байтов за опрос; там учитывается только время разбора, без write_fifo.
+// В конце печатаются размеры FIFO_Buffer и Parser и время init_fifo +
+// init_parser на канал (сравнивать со сборкой -DPARSER_COMPACT=ON).
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "multi_parser.h"
+#include "parser.hpp"
+
+namespace {
+
+constexpr int kPackets = 200000;
+constexpr int kChunk = 256;
+constexpr int kRounds = 5;
+constexpr int kChannels = 4096;
+constexpr int kChannelChunk = 4;
+constexpr int kInitRounds = 50;
+
+unsigned long long g_c_packets = 0;
+unsigned long long g_c_checksum = 0;
+unsigned long long g_kept_packets = 0;
+unsigned long long g_kept_checksum = 0;
+
+// Фильтр пропускает каждый четвёртый тип.
+bool kept_type(unsigned int type) {
+    return (type & 3u) == 0;
+}
+
+unsigned long long packet_sum(unsigned int type, const unsigned char *data, unsigned int size) {
+    unsigned long long sum = type;
+    for (unsigned int i = 0; i < size; i++) {
+        sum += data[i];
+    }
+    return sum;
+}
+
+void c_callback(unsigned int type, unsigned char *data, unsigned int size) {
+    unsigned long long sum = packet_sum(type, data, size);
+    g_c_packets++;
+    g_c_checksum += sum;
+    if (kept_type(type)) {
+        g_kept_packets++;
+        g_kept_checksum += type + size;
+    }
+}
+
+unsigned long long g_filtered_packets = 0;
+unsigned long long g_filtered_checksum = 0;
+
+void filtered_callback(unsigned int type, unsigned char *, unsigned int size) {
+    g_filtered_packets++;
+    g_filtered_checksum += type + size;
+}
+
+std::vector<unsigned char> make_stream() {
+    std::vector<unsigned char> stream;
+    unsigned char packet[SYNC_SEQUENCE_LENGTH + MAX_HEADER_SIZE + MAX_PACKET_SIZE];
+    unsigned char body[128];
+    unsigned int seed = 12345;
+    for (int i = 0; i < kPackets; i++) {
+        seed = seed * 1103515245u + 12345u;
+        unsigned int size = (seed >> 16) % 64;
+        unsigned int type = (seed >> 8) % 128;
+        for (unsigned int j = 0; j < size; j++) {
+            body[j] = static_cast<unsigned char>(seed + j);
+        }
+        unsigned int length;
+        build_packet(packet, &length, size, type, body);
+        stream.insert(stream.end(), packet, packet + length);
+        // parse_uart дочитывает один лишний байт после тела; заполнитель не даёт ему съесть следующий пакет.
+        stream.push_back(0x00);
+    }
+    return stream;
+}
+
+struct ChannelTotals {
+    unsigned long long packets = 0;
+    unsigned long long checksum = 0;
+};
+
+void multi_callback(void *context, int, unsigned int type, unsigned char *data, unsigned int size) {
+    ChannelTotals *totals = static_cast<ChannelTotals *>(context);
+    totals->packets++;
+    totals->checksum += packet_sum(type, data, size);
+}
+
+void handler_callback(void *context, unsigned int type, unsigned char *data, unsigned int size) {
+    multi_callback(context, 0, type, data, size);
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void report(const char *name, double seconds, size_t bytes, unsigned long long packets) {
+    double total = static_cast<double>(bytes) * kRounds;
+    std::printf("%-22s %8.1f MB/s  %7.1f ns/packet  (%llu packets)\n", name, total / seconds / 1e6,
+                seconds * 1e9 / static_cast<double>(packets * kRounds), packets);
+}
+
+} // namespace
+
+int main() {
+    std::vector<unsigned char> stream = make_stream();
+    const size_t n = stream.size();
+
+    // C: FIFO_Buffer + parse_uart + указатель на функцию.
+    static FIFO_Buffer fifo;
+    static ::Parser parser;
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < kRounds; round++) {
+        // Парсер с чистым телом, как новый uart::Parser: компактная сборка тело не обнуляет,
+        // а parse_uart оставляет в нём байты предыдущего пакета.
+        parser = ::Parser();
+        init_fifo(&fifo);
+        init_parser(&parser, &fifo, c_callback);
+        g_c_packets = 0;
+        g_c_checksum = 0;
+        g_kept_packets = 0;
+        g_kept_checksum = 0;
+        for (size_t pos = 0; pos < n; pos += kChunk) {
+            int chunk = static_cast<int>(n - pos < kChunk ? n - pos : kChunk);
+            write_fifo(&fifo, &stream[pos], chunk);
+            parse_uart(&parser);
+        }
+    }
+    double c_seconds = seconds_since(start);
+
+    // C++: uart::Fifo + uart::Parser + лямбда.
+    static uart::Fifo<MAX_FIFO_SIZE> cpp_fifo;
+    unsigned long long cpp_packets = 0;
+    unsigned long long cpp_checksum = 0;
+    start = std::chrono::steady_clock::now();
+    for (int round = 0; round < kRounds; round++) {
+        cpp_fifo = uart::Fifo<MAX_FIFO_SIZE>();
+        cpp_packets = 0;
+        cpp_checksum = 0;
+        auto cpp_parser = uart::make_parser(cpp_fifo, [&](unsigned int type, unsigned char *data, unsigned int size) {
+            cpp_packets++;
+            cpp_checksum += type;
+            for (unsigned int i = 0; i < size; i++) {
+                cpp_checksum += data[i];
+            }
+        });
+        for (size_t pos = 0; pos < n; pos += kChunk) {
+            int chunk = static_cast<int>(n - pos < kChunk ? n - pos : kChunk);
+            cpp_fifo.write(&stream[pos], chunk);
+            cpp_parser.parse();
+        }
+    }
+    double cpp_seconds = seconds_since(start);
+
+    // C, вытягивание пакетов: parser_next_packet в собственном цикле, без косвенного вызова.
+    unsigned long long pull_packets = 0;
+    unsigned long long pull_checksum = 0;
+    start = std::chrono::steady_clock::now();
+    for (int round = 0; round < kRounds; round++) {
+        parser = ::Parser();
+        init_fifo(&fifo);
+        init_parser(&parser, &fifo, nullptr);
+        pull_packets = 0;
+        pull_checksum = 0;
+        for (size_t pos = 0; pos < n; pos += kChunk) {
+            int chunk = static_cast<int>(n - pos < kChunk ? n - pos : kChunk);
+            write_fifo(&fifo, &stream[pos], chunk);
+            PacketView packet;
+            while (parser_next_packet(&parser, &packet)) {
+                pull_packets++;
+                pull_checksum += packet_sum(packet.type, packet.data, packet.size);
+            }
+        }
+    }
+    double pull_seconds = seconds_since(start);
+
+    // C с фильтром типов: тела отклонённых пакетов пропускаются без копирования.
+    static ParserTypeFilter filter;
+    parser_type_filter_init(&filter, 0);
+    for (unsigned int type = 0; type < PARSER_TYPE_COUNT; type++) {
+        if (kept_type(type)) {
+            parser_type_filter_set(&filter, type, 1);
+        }
+    }
+    start = std::chrono::steady_clock::now();
+    for (int round = 0; round < kRounds; round++) {
+        init_fifo(&fifo);
+        init_parser(&parser, &fifo, filtered_callback);
+        parser_set_type_filter(&parser, &filter);
+        g_filtered_packets = 0;
+        g_filtered_checksum = 0;
+        for (size_t pos = 0; pos < n; pos += kChunk) {
+            int chunk = static_cast<int>(n - pos < kChunk ? n - pos : kChunk);
+            write_fifo(&fifo, &stream[pos], chunk);
+            parse_uart(&parser);
+        }
+    }
+    double filtered_seconds = seconds_since(start);
+
+    // Много каналов по несколько байтов: каждый канал получает свою часть потока.
+    const size_t per_channel = n / kChannels;
+    std::vector<FIFO_Buffer> channel_fifos(kChannels);
+    std::vector<::Parser> channel_parsers(kChannels);
+    ChannelTotals scalar_totals;
+    double scalar_seconds = 0.0;
+    for (int round = 0; round < kRounds; round++) {
+        scalar_totals = ChannelTotals();
+        for (int c = 0; c < kChannels; c++) {
+            channel_parsers[c] = ::Parser();
+            init_fifo(&channel_fifos[c]);
+            init_parser(&channel_parsers[c], &channel_fifos[c], nullptr);
+            parser_set_handler(&channel_parsers[c], handler_callback, &scalar_totals);
+            parser_set_event_sink(&channel_parsers[c], nullptr, nullptr);
+        }
+        for (size_t pos = 0; pos < per_channel; pos += kChannelChunk) {
+            int chunk = static_cast<int>(per_channel - pos < kChannelChunk ? per_channel - pos : kChannelChunk);
+            for (int c = 0; c < kChannels; c++) {
+                write_fifo(&channel_fifos[c], &stream[c * per_channel + pos], chunk);
+            }
+            start = std::chrono::steady_clock::now();
+            for (int c = 0; c < kChannels; c++) {
+                parse_uart(&channel_parsers[c]);
+            }
+            scalar_seconds += seconds_since(start);
+        }
+    }
+
+    ChannelTotals multi_totals;
+    MultiParser multi;
+    if (multi_parser_init(&multi, kChannels, multi_callback, &multi_totals) != 0) {
+        std::printf("multi_parser_init failed\n");
+        return EXIT_FAILURE;
+    }
+    double multi_seconds = 0.0;
+    for (int round = 0; round < kRounds; round++) {
+        multi_totals = ChannelTotals();
+        for (int c = 0; c < kChannels; c++) {
+            init_fifo(&channel_fifos[c]);
+            multi_parser_attach(&multi, c, &channel_fifos[c]);
+        }
+        for (size_t pos = 0; pos < per_channel; pos += kChannelChunk) {
+            int chunk = static_cast<int>(per_channel - pos < kChannelChunk ? per_channel - pos : kChannelChunk);
+            for (int c = 0; c < kChannels; c++) {
+                write_fifo(&channel_fifos[c], &stream[c * per_channel + pos], chunk);
+            }
+            start = std::chrono::steady_clock::now();
+            multi_parser_poll(&multi);
+            multi_seconds += seconds_since(start);
+        }
+    }
+    multi_parser_destroy(&multi);
+
+    // Холодный старт: инициализация всех каналов.
+    start = std::chrono::steady_clock::now();
+    for (int round = 0; round < kInitRounds; round++) {
+        for (int c = 0; c < kChannels; c++) {
+            init_fifo(&channel_fifos[c]);
+            init_parser(&channel_parsers[c], &channel_fifos[c], nullptr);
+        }
+    }
+    double init_seconds = seconds_since(start);
+
+    std::printf("stream: %zu bytes, %d packets, chunk %d, %d rounds\n", n, kPackets, kChunk, kRounds);
+    report("C parse_uart", c_seconds, n, g_c_packets);
+    report("C++ uart::Parser", cpp_seconds, n, cpp_packets);
+    std::printf("speedup: %.2fx\n", c_seconds / cpp_seconds);
+    report("C parser_next_packet", pull_seconds, n, pull_packets);
+    report("C parse_uart, 1/4 types", filtered_seconds, n, g_filtered_packets);
+    std::printf("filtered: %llu packets skipped, speedup %.2fx\n",
+                static_cast<unsigned long long>(parser.stats.packets_filtered), c_seconds / filtered_seconds);
+    std::printf("channels: %d x %zu bytes, %d bytes per poll\n", kChannels, per_channel, kChannelChunk);
+    report("C parse_uart x channels", scalar_seconds, per_channel * kChannels, scalar_totals.packets);
+    report("MultiParser", multi_seconds, per_channel * kChannels, multi_totals.packets);
+    std::printf("speedup: %.2fx\n", scalar_seconds / multi_seconds);
+#if PARSER_COMPACT
+    const char *build = "compact";
+#else
+    const char *build = "default";
+#endif
+    std::printf("%s build: sizeof(FIFO_Buffer) %zu, sizeof(Parser) %zu, %zu bytes per channel, init %.1f ns per channel\n",
+                build, sizeof(FIFO_Buffer), sizeof(::Parser), sizeof(FIFO_Buffer) + sizeof(::Parser),
+                init_seconds * 1e9 / (static_cast<double>(kChannels) * kInitRounds));
+
+    if (g_c_packets != cpp_packets || g_c_checksum != cpp_checksum) {
+        std::printf("MISMATCH: C %llu/%llu, C++ %llu/%llu\n", g_c_packets, g_c_checksum, cpp_packets, cpp_checksum);
+        return EXIT_FAILURE;
+    }
+    if (pull_packets != g_c_packets || pull_checksum != g_c_checksum) {
+        std::printf("PULL MISMATCH: parse_uart %llu/%llu, parser_next_packet %llu/%llu\n", g_c_packets, g_c_checksum,
+                    pull_packets, pull_checksum);
+        return EXIT_FAILURE;
+    }
+    if (scalar_totals.packets != multi_totals.packets || scalar_totals.checksum != multi_totals.checksum) {
+        std::printf("MULTI MISMATCH: parse_uart %llu/%llu, MultiParser %llu/%llu\n", scalar_totals.packets,
+                    scalar_totals.checksum, multi_totals.packets, multi_totals.checksum);
+        return EXIT_FAILURE;
+    }
+    if (g_filtered_packets != g_kept_packets || g_filtered_checksum != g_kept_checksum) {
+        std::printf("FILTER MISMATCH: expected %llu/%llu, got %llu/%llu\n", g_kept_packets, g_kept_checksum,
+                    g_filtered_packets, g_filtered_checksum);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,117 @@
+/**
+ * @file bounded_queue.c
+ * @brief Реализация ограниченной блокирующей очереди.
+ */
+#include "bounded_queue.h"
+#include <stdlib.h>
+
+int bounded_queue_init(BoundedQueue *queue, int capacity) {
+    if (capacity <= 0) {
+        return -1;
+    }
+    queue->items = malloc((size_t)capacity * sizeof(void *));
+    if (queue->items == NULL) {
+        return -1;
+    }
+    queue->capacity = capacity;
+    queue->head = 0;
+    queue->count = 0;
+    queue->closed = 0;
+    queue->waits = 0;
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->not_empty, NULL);
+    pthread_cond_init(&queue->not_full, NULL);
+    return 0;
+}
+
+void bounded_queue_destroy(BoundedQueue *queue) {
+    pthread_cond_destroy(&queue->not_full);
+    pthread_cond_destroy(&queue->not_empty);
+    pthread_mutex_destroy(&queue->lock);
+    free(queue->items);
+    queue->items = NULL;
+}
+
+// Добавление под захваченным мьютексом
+static void push_locked(BoundedQueue *queue, void *item) {
+    queue->items[(queue->head + queue->count) % queue->capacity] = item;
+    queue->count++;
+    pthread_cond_signal(&queue->not_empty);
+}
+
+// Извлечение под захваченным мьютексом
+static void *pop_locked(BoundedQueue *queue) {
+    void *item = queue->items[queue->head];
+    queue->head = (queue->head + 1) % queue->capacity;
+    queue->count--;
+    pthread_cond_signal(&queue->not_full);
+    return item;
+}
+
+int bounded_queue_push(BoundedQueue *queue, void *item) {
+    pthread_mutex_lock(&queue->lock);
+    if (queue->count == queue->capacity && !queue->closed) {
+        queue->waits++;
+        while (queue->count == queue->capacity && !queue->closed) {
+            pthread_cond_wait(&queue->not_full, &queue->lock);
+        }
+    }
+    if (queue->closed) {
+        pthread_mutex_unlock(&queue->lock);
+        return -1;
+    }
+    push_locked(queue, item);
+    pthread_mutex_unlock(&queue->lock);
+    return 0;
+}
+
+int bounded_queue_try_push(BoundedQueue *queue, void *item) {
+    int result = -1;
+    pthread_mutex_lock(&queue->lock);
+    if (!queue->closed && queue->count < queue->capacity) {
+        push_locked(queue, item);
+        result = 0;
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return result;
+}
+
+int bounded_queue_pop(BoundedQueue *queue, void **item) {
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count == 0 && !queue->closed) {
+        pthread_cond_wait(&queue->not_empty, &queue->lock);
+    }
+    if (queue->count == 0) {
+        pthread_mutex_unlock(&queue->lock);
+        return -1;
+    }
+    *item = pop_locked(queue);
+    pthread_mutex_unlock(&queue->lock);
+    return 0;
+}
+
+int bounded_queue_try_pop(BoundedQueue *queue, void **item) {
+    int result = -1;
+    pthread_mutex_lock(&queue->lock);
+    if (queue->count > 0) {
+        *item = pop_locked(queue);
+        result = 0;
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return result;
+}
+
+void bounded_queue_close(BoundedQueue *queue) {
+    pthread_mutex_lock(&queue->lock);
+    queue->closed = 1;
+    pthread_cond_broadcast(&queue->not_empty);
+    pthread_cond_broadcast(&queue->not_full);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+int bounded_queue_size(BoundedQueue *queue) {
+    pthread_mutex_lock(&queue->lock);
+    int count = queue->count;
+    pthread_mutex_unlock(&queue->lock);
+    return count;
+}
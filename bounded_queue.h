@@ -0,0 +1,104 @@
+/**
+ * @file bounded_queue.h
+ * @brief Ограниченная блокирующая очередь указателей для связи потоков.
+ *
+ * Очередь на мьютексе и двух условных переменных. Закрытая очередь
+ * перестаёт принимать элементы, но отдаёт уже накопленные; после этого
+ * bounded_queue_pop возвращает -1, что служит сигналом завершения потока.
+ */
+#ifndef BOUNDED_QUEUE_H
+#define BOUNDED_QUEUE_H
+
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @struct BoundedQueue
+ * @brief Кольцевая очередь указателей фиксированной ёмкости.
+ */
+typedef struct {
+    void **items;              /**< Кольцевой массив элементов */
+    int capacity;              /**< Ёмкость */
+    int head;                  /**< Индекс первого элемента */
+    int count;                 /**< Число элементов */
+    int closed;                /**< Очередь закрыта */
+    unsigned long waits;       /**< Сколько раз писатель ждал свободного места */
+    pthread_mutex_t lock;      /**< Мьютекс очереди */
+    pthread_cond_t not_empty;  /**< Сигнал для читателей */
+    pthread_cond_t not_full;   /**< Сигнал для писателей */
+} BoundedQueue;
+
+/**
+ * @brief Создаёт очередь.
+ *
+ * @param queue Указатель на очередь.
+ * @param capacity Ёмкость (больше нуля).
+ * @return Возвращает 0 при успехе, -1 при ошибке.
+ */
+int bounded_queue_init(BoundedQueue *queue, int capacity);
+
+/**
+ * @brief Освобождает очередь (элементы не освобождаются).
+ *
+ * @param queue Указатель на очередь.
+ */
+void bounded_queue_destroy(BoundedQueue *queue);
+
+/**
+ * @brief Добавляет элемент, ожидая свободного места.
+ *
+ * @param queue Указатель на очередь.
+ * @param item Элемент.
+ * @return Возвращает 0 при успехе, -1 если очередь закрыта.
+ */
+int bounded_queue_push(BoundedQueue *queue, void *item);
+
+/**
+ * @brief Добавляет элемент без ожидания.
+ *
+ * @param queue Указатель на очередь.
+ * @param item Элемент.
+ * @return Возвращает 0 при успехе, -1 если очередь заполнена или закрыта.
+ */
+int bounded_queue_try_push(BoundedQueue *queue, void *item);
+
+/**
+ * @brief Извлекает элемент, ожидая его появления.
+ *
+ * @param queue Указатель на очередь.
+ * @param item Указатель, куда будет сохранён элемент.
+ * @return Возвращает 0 при успехе, -1 если очередь закрыта и пуста.
+ */
+int bounded_queue_pop(BoundedQueue *queue, void **item);
+
+/**
+ * @brief Извлекает элемент без ожидания.
+ *
+ * @param queue Указатель на очередь.
+ * @param item Указатель, куда будет сохранён элемент.
+ * @return Возвращает 0 при успехе, -1 если очередь пуста.
+ */
+int bounded_queue_try_pop(BoundedQueue *queue, void **item);
+
+/**
+ * @brief Закрывает очередь и будит все ожидающие потоки.
+ *
+ * @param queue Указатель на очередь.
+ */
+void bounded_queue_close(BoundedQueue *queue);
+
+/**
+ * @brief Возвращает текущее число элементов.
+ *
+ * @param queue Указатель на очередь.
+ */
+int bounded_queue_size(BoundedQueue *queue);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BOUNDED_QUEUE_H
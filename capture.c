@@ -0,0 +1,509 @@
+/**
+ * @file capture.c
+ * @brief Реализация записи и чтения индексированного файла пакетов.
+ */
+#include "capture.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define ITEM_HEADER_SIZE 8u
+#define RECORD_HEADER_SIZE 16u
+#define INDEX_HEADER_SIZE 32u
+#define DIRECTORY_HEADER_SIZE 8u
+#define FOOTER_SIZE (ITEM_HEADER_SIZE + 8u)
+
+// Длина элемента с заголовком и выравниванием
+static uint64_t item_span(uint32_t length) {
+    return (ITEM_HEADER_SIZE + (uint64_t)length + 7u) & ~(uint64_t)7u;
+}
+
+// ---------------------------------------------------------------- Запись
+
+static int write_bytes(CaptureWriter *writer, const void *data, size_t size) {
+    if (size > 0 && fwrite(data, 1, size, writer->file) != size) {
+        return -1;
+    }
+    writer->offset += size;
+    return 0;
+}
+
+// Заголовок элемента в начале, выравнивание в конце
+static int write_item_header(CaptureWriter *writer, uint32_t tag, uint32_t length) {
+    uint32_t header[2];
+    header[0] = tag;
+    header[1] = length;
+    return write_bytes(writer, header, sizeof(header));
+}
+
+static int write_padding(CaptureWriter *writer) {
+    static const unsigned char zeros[8] = {0};
+    return write_bytes(writer, zeros, (size_t)((8u - (writer->offset & 7u)) & 7u));
+}
+
+static int compare_entries(const void *a, const void *b) {
+    const CaptureIndexEntry *left = (const CaptureIndexEntry *)a;
+    const CaptureIndexEntry *right = (const CaptureIndexEntry *)b;
+    if (left->type != right->type) {
+        return left->type < right->type ? -1 : 1;
+    }
+    if (left->timestamp != right->timestamp) {
+        return left->timestamp < right->timestamp ? -1 : 1;
+    }
+    return left->offset < right->offset ? -1 : (left->offset > right->offset);
+}
+
+// Индекс текущего блока: диапазон времени и записи, отсортированные по (тип, время)
+static int write_index(CaptureWriter *writer) {
+    CaptureBlock block;
+    uint64_t header[4];
+    if (writer->entry_count == 0) {
+        return 0;
+    }
+    if (writer->block_count == writer->block_capacity) {
+        uint32_t capacity = writer->block_capacity ? writer->block_capacity * 2 : 64;
+        CaptureBlock *blocks = (CaptureBlock *)realloc(writer->blocks, capacity * sizeof(CaptureBlock));
+        if (blocks == NULL) {
+            return -1;
+        }
+        writer->blocks = blocks;
+        writer->block_capacity = capacity;
+    }
+    block.first_time = writer->entries[0].timestamp;
+    block.last_time = writer->entries[writer->entry_count - 1].timestamp;
+    block.index_offset = writer->offset;
+    qsort(writer->entries, writer->entry_count, sizeof(CaptureIndexEntry), compare_entries);
+
+    header[0] = block.first_time;
+    header[1] = block.last_time;
+    header[2] = writer->block_offset;
+    header[3] = writer->entry_count;
+    if (write_item_header(writer, CAPTURE_TAG_INDEX,
+                          INDEX_HEADER_SIZE + writer->entry_count * (uint32_t)sizeof(CaptureIndexEntry)) != 0 ||
+        write_bytes(writer, header, sizeof(header)) != 0 ||
+        write_bytes(writer, writer->entries, writer->entry_count * sizeof(CaptureIndexEntry)) != 0) {
+        return -1;
+    }
+    writer->blocks[writer->block_count++] = block;
+    writer->block_offset = writer->offset;
+    writer->entry_count = 0;
+    return 0;
+}
+
+int capture_writer_open(CaptureWriter *writer, const char *path, uint32_t block_records) {
+    uint32_t header[2];
+    memset(writer, 0, sizeof(*writer));
+    writer->block_records = block_records ? block_records : CAPTURE_DEFAULT_BLOCK_RECORDS;
+    writer->clock = monotonic_clock_ns;
+    writer->entries = (CaptureIndexEntry *)malloc(writer->block_records * sizeof(CaptureIndexEntry));
+    if (writer->entries == NULL) {
+        return -1;
+    }
+    writer->file = fopen(path, "wb");
+    if (writer->file == NULL) {
+        free(writer->entries);
+        writer->entries = NULL;
+        return -1;
+    }
+    header[0] = CAPTURE_VERSION;
+    header[1] = writer->block_records;
+    if (write_item_header(writer, CAPTURE_TAG_FILE, sizeof(header)) != 0 ||
+        write_bytes(writer, header, sizeof(header)) != 0) {
+        fclose(writer->file);
+        free(writer->entries);
+        writer->file = NULL;
+        writer->entries = NULL;
+        return -1;
+    }
+    writer->block_offset = writer->offset;
+    return 0;
+}
+
+void capture_writer_set_clock(CaptureWriter *writer, MonotonicClockFn clock, void *context) {
+    writer->clock = clock;
+    writer->clock_context = context;
+}
+
+int capture_writer_append(CaptureWriter *writer, uint64_t timestamp, unsigned int type,
+                          const unsigned char *data, unsigned int size) {
+    uint64_t header[2];
+    CaptureIndexEntry *entry;
+    if (writer->file == NULL || timestamp < writer->last_timestamp || size > UINT32_MAX - RECORD_HEADER_SIZE - 8u) {
+        return -1;
+    }
+    // Смещения внутри блока 32-битные
+    if (writer->offset + item_span(RECORD_HEADER_SIZE + size) - writer->block_offset > UINT32_MAX &&
+        write_index(writer) != 0) {
+        return -1;
+    }
+    entry = &writer->entries[writer->entry_count];
+    entry->timestamp = timestamp;
+    entry->type = type;
+    entry->offset = (uint32_t)(writer->offset - writer->block_offset);
+
+    header[0] = timestamp;
+    header[1] = (uint64_t)type | ((uint64_t)size << 32);
+    if (write_item_header(writer, CAPTURE_TAG_RECORD, RECORD_HEADER_SIZE + size) != 0 ||
+        write_bytes(writer, header, sizeof(header)) != 0 ||
+        write_bytes(writer, data, size) != 0 ||
+        write_padding(writer) != 0) {
+        return -1;
+    }
+    writer->last_timestamp = timestamp;
+    if (++writer->entry_count == writer->block_records) {
+        return write_index(writer);
+    }
+    return 0;
+}
+
+int capture_writer_flush(CaptureWriter *writer) {
+    if (writer->file == NULL || write_index(writer) != 0) {
+        return -1;
+    }
+    return fflush(writer->file) == 0 ? 0 : -1;
+}
+
+int capture_writer_close(CaptureWriter *writer) {
+    uint32_t header[2];
+    uint64_t directory_offset;
+    int result = 0;
+    if (writer->file == NULL) {
+        return -1;
+    }
+    if (write_index(writer) != 0) {
+        result = -1;
+    }
+    directory_offset = writer->offset;
+    header[0] = writer->block_count;
+    header[1] = 0;
+    if (result != 0 ||
+        write_item_header(writer, CAPTURE_TAG_DIRECTORY,
+                          DIRECTORY_HEADER_SIZE + writer->block_count * (uint32_t)sizeof(CaptureBlock)) != 0 ||
+        write_bytes(writer, header, sizeof(header)) != 0 ||
+        write_bytes(writer, writer->blocks, writer->block_count * sizeof(CaptureBlock)) != 0 ||
+        write_item_header(writer, CAPTURE_TAG_FOOTER, sizeof(directory_offset)) != 0 ||
+        write_bytes(writer, &directory_offset, sizeof(directory_offset)) != 0) {
+        result = -1;
+    }
+    if (fclose(writer->file) != 0) {
+        result = -1;
+    }
+    free(writer->entries);
+    free(writer->blocks);
+    memset(writer, 0, sizeof(*writer));
+    return result;
+}
+
+void capture_packet_handler(void *context, unsigned int type, unsigned char *data, unsigned int size) {
+    CaptureWriter *writer = (CaptureWriter *)context;
+    uint64_t now = writer->clock(writer->clock_context);
+    // Часы могут совпасть с предыдущим отсчётом, но не уйти назад
+    if (now < writer->last_timestamp) {
+        now = writer->last_timestamp;
+    }
+    capture_writer_append(writer, now, type, data, size);
+}
+
+// ---------------------------------------------------------------- Чтение
+
+// Элемент по смещению с проверкой границ
+static const unsigned char *item_at(const CaptureReader *reader, uint64_t offset, uint32_t tag, uint32_t *length) {
+    uint32_t header[2];
+    if (offset > reader->size || reader->size - offset < ITEM_HEADER_SIZE) {
+        return NULL;
+    }
+    memcpy(header, reader->data + offset, sizeof(header));
+    if (header[0] != tag || header[1] > reader->size - offset - ITEM_HEADER_SIZE) {
+        return NULL;
+    }
+    *length = header[1];
+    return reader->data + offset + ITEM_HEADER_SIZE;
+}
+
+static uint64_t load_u64(const unsigned char *data) {
+    uint64_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+// Файл без списка блоков: собрать индексные блоки проходом по элементам
+static int recover_blocks(CaptureReader *reader, uint64_t offset) {
+    uint32_t capacity = 0;
+    while (reader->size - offset >= ITEM_HEADER_SIZE) {
+        uint32_t header[2];
+        memcpy(header, reader->data + offset, sizeof(header));
+        if (header[1] > reader->size - offset - ITEM_HEADER_SIZE) {
+            break; // Оборванный последний элемент
+        }
+        if (header[0] == CAPTURE_TAG_INDEX && header[1] >= INDEX_HEADER_SIZE) {
+            const unsigned char *payload = reader->data + offset + ITEM_HEADER_SIZE;
+            if (reader->block_count == capacity) {
+                uint32_t grown = capacity ? capacity * 2 : 64;
+                CaptureBlock *blocks = (CaptureBlock *)realloc(reader->owned_blocks, grown * sizeof(CaptureBlock));
+                if (blocks == NULL) {
+                    return -1;
+                }
+                reader->owned_blocks = blocks;
+                capacity = grown;
+            }
+            reader->owned_blocks[reader->block_count].first_time = load_u64(payload);
+            reader->owned_blocks[reader->block_count].last_time = load_u64(payload + 8);
+            reader->owned_blocks[reader->block_count].index_offset = offset;
+            reader->block_count++;
+        } else if (header[0] != CAPTURE_TAG_RECORD) {
+            break;
+        }
+        offset += item_span(header[1]);
+    }
+    reader->blocks = reader->owned_blocks;
+    return 0;
+}
+
+static int load_directory(CaptureReader *reader) {
+    uint32_t length;
+    uint64_t directory_offset;
+    const unsigned char *payload;
+    uint32_t count;
+    if (reader->size < FOOTER_SIZE) {
+        return -1;
+    }
+    payload = item_at(reader, reader->size - FOOTER_SIZE, CAPTURE_TAG_FOOTER, &length);
+    if (payload == NULL || length != 8) {
+        return -1;
+    }
+    directory_offset = load_u64(payload);
+    payload = item_at(reader, directory_offset, CAPTURE_TAG_DIRECTORY, &length);
+    if (payload == NULL || length < DIRECTORY_HEADER_SIZE) {
+        return -1;
+    }
+    memcpy(&count, payload, sizeof(count));
+    if ((uint64_t)count * sizeof(CaptureBlock) != length - DIRECTORY_HEADER_SIZE) {
+        return -1;
+    }
+    // Элементы выровнены на 8 байтов, отображение - на страницу
+    reader->blocks = (const CaptureBlock *)(const void *)(payload + DIRECTORY_HEADER_SIZE);
+    reader->block_count = count;
+    return 0;
+}
+
+#ifdef _WIN32
+static int map_file(CaptureReader *reader, const char *path) {
+    FILE *file = fopen(path, "rb");
+    long size;
+    unsigned char *data;
+    if (file == NULL) {
+        return -1;
+    }
+    if (fseek(file, 0, SEEK_END) != 0 || (size = ftell(file)) < 0 || fseek(file, 0, SEEK_SET) != 0) {
+        fclose(file);
+        return -1;
+    }
+    data = (unsigned char *)malloc(size > 0 ? (size_t)size : 1);
+    if (data == NULL || fread(data, 1, (size_t)size, file) != (size_t)size) {
+        free(data);
+        fclose(file);
+        return -1;
+    }
+    fclose(file);
+    reader->data = data;
+    reader->size = (size_t)size;
+    return 0;
+}
+
+static void unmap_file(CaptureReader *reader) {
+    free((void *)reader->data);
+}
+#else
+static int map_file(CaptureReader *reader, const char *path) {
+    struct stat st;
+    void *data;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return -1;
+    }
+    data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return -1;
+    }
+    reader->data = (const unsigned char *)data;
+    reader->size = (size_t)st.st_size;
+    return 0;
+}
+
+static void unmap_file(CaptureReader *reader) {
+    munmap((void *)reader->data, reader->size);
+}
+#endif
+
+int capture_reader_open(CaptureReader *reader, const char *path) {
+    uint32_t length;
+    uint32_t version;
+    const unsigned char *payload;
+    memset(reader, 0, sizeof(*reader));
+    if (map_file(reader, path) != 0) {
+        return -1;
+    }
+    payload = item_at(reader, 0, CAPTURE_TAG_FILE, &length);
+    if (payload == NULL || length < 8) {
+        capture_reader_close(reader);
+        return -1;
+    }
+    memcpy(&version, payload, sizeof(version));
+    if (version != CAPTURE_VERSION) {
+        capture_reader_close(reader);
+        return -1;
+    }
+    if (load_directory(reader) != 0 && recover_blocks(reader, item_span(length)) != 0) {
+        capture_reader_close(reader);
+        return -1;
+    }
+    return 0;
+}
+
+void capture_reader_close(CaptureReader *reader) {
+    if (reader->data != NULL) {
+        unmap_file(reader);
+    }
+    free(reader->owned_blocks);
+    memset(reader, 0, sizeof(*reader));
+}
+
+void capture_query_init(CaptureQuery *query, const CaptureReader *reader, unsigned int type,
+                        uint64_t from, uint64_t to) {
+    uint32_t low = 0;
+    uint32_t high = reader->block_count;
+    memset(query, 0, sizeof(*query));
+    query->reader = reader;
+    query->type = type;
+    query->from = from;
+    query->to = to;
+    // Первый блок, который может содержать время from (время не убывает)
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        if (reader->blocks[middle].last_time < from) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    query->block = low;
+}
+
+static CaptureIndexEntry entry_at(const CaptureQuery *query, uint32_t index) {
+    CaptureIndexEntry entry;
+    memcpy(&entry, query->entries + (size_t)index * sizeof(CaptureIndexEntry), sizeof(entry));
+    return entry;
+}
+
+// Первая запись индекса, не меньшая (type, timestamp)
+static uint32_t lower_bound(const CaptureQuery *query, uint32_t count, uint32_t type, uint64_t timestamp) {
+    uint32_t low = 0;
+    uint32_t high = count;
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        CaptureIndexEntry entry = entry_at(query, middle);
+        if (entry.type < type || (entry.type == type && entry.timestamp < timestamp)) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+// Индекс текущего блока и диапазон записей запроса в нём
+static int open_block(CaptureQuery *query) {
+    uint32_t length;
+    uint32_t count;
+    const CaptureBlock *block = &query->reader->blocks[query->block];
+    const unsigned char *payload = item_at(query->reader, block->index_offset, CAPTURE_TAG_INDEX, &length);
+    if (payload == NULL || length < INDEX_HEADER_SIZE) {
+        return -1;
+    }
+    count = (uint32_t)load_u64(payload + 24);
+    if ((uint64_t)count * sizeof(CaptureIndexEntry) != length - INDEX_HEADER_SIZE) {
+        return -1;
+    }
+    query->block_offset = load_u64(payload + 16);
+    query->entries = payload + INDEX_HEADER_SIZE;
+    if (query->type == CAPTURE_ANY_TYPE) {
+        query->entry = 0;
+        query->entry_end = count;
+        query->cursor = query->block_offset;
+    } else {
+        query->entry = lower_bound(query, count, query->type, query->from);
+        query->entry_end = query->to == UINT64_MAX ? lower_bound(query, count, query->type + 1, 0)
+                                                   : lower_bound(query, count, query->type, query->to + 1);
+    }
+    query->block_ready = 1;
+    return 0;
+}
+
+static int read_record(const CaptureReader *reader, uint64_t offset, CapturePacket *packet, uint64_t *next) {
+    uint32_t length;
+    uint64_t type_size;
+    const unsigned char *payload = item_at(reader, offset, CAPTURE_TAG_RECORD, &length);
+    if (payload == NULL || length < RECORD_HEADER_SIZE) {
+        return -1;
+    }
+    type_size = load_u64(payload + 8);
+    packet->timestamp = load_u64(payload);
+    packet->type = (unsigned int)(type_size & 0xFFFFFFFFu);
+    packet->size = (unsigned int)(type_size >> 32);
+    packet->data = payload + RECORD_HEADER_SIZE;
+    if (packet->size != length - RECORD_HEADER_SIZE) {
+        return -1;
+    }
+    *next = offset + item_span(length);
+    return 0;
+}
+
+int capture_query_next(CaptureQuery *query, CapturePacket *packet) {
+    const CaptureReader *reader = query->reader;
+    uint64_t next;
+    while (query->block < reader->block_count) {
+        if (!query->block_ready) {
+            if (reader->blocks[query->block].first_time > query->to) {
+                return 0;
+            }
+            if (open_block(query) != 0) {
+                return -1;
+            }
+        }
+        while (query->entry < query->entry_end) {
+            query->entry++;
+            if (query->type != CAPTURE_ANY_TYPE) {
+                CaptureIndexEntry entry = entry_at(query, query->entry - 1);
+                return read_record(reader, query->block_offset + entry.offset, packet, &next) == 0 ? 1 : -1;
+            }
+            // Любой тип: записи блока подряд, время в них не убывает
+            if (read_record(reader, query->cursor, packet, &next) != 0) {
+                return -1;
+            }
+            query->cursor = next;
+            if (packet->timestamp > query->to) {
+                return 0;
+            }
+            if (packet->timestamp >= query->from) {
+                return 1;
+            }
+        }
+        query->block++;
+        query->block_ready = 0;
+    }
+    return 0;
+}
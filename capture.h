@@ -0,0 +1,235 @@
+/**
+ * @file capture.h
+ * @brief Файл записи разобранных пакетов с индексом по времени и типу.
+ *
+ * Файл только дописывается и состоит из элементов с заголовком
+ * {тег, длина}, выровненных на 8 байтов:
+ * - CAPTURE_TAG_RECORD - пакет: время, тип, размер и тело;
+ * - CAPTURE_TAG_INDEX - индекс предыдущих записей блока: диапазон времени
+ *   и записи, отсортированные по (тип, время);
+ * - CAPTURE_TAG_DIRECTORY - список всех индексных блоков (пишется при закрытии);
+ * - CAPTURE_TAG_FOOTER - смещение списка блоков, последний элемент файла.
+ *
+ * Читатель отображает файл в память (mmap), находит блоки по времени
+ * двоичным поиском в списке и внутри блока - записи нужного типа двоичным
+ * поиском в индексе, поэтому запрос стоит пропорционально числу найденных
+ * пакетов и затронутых блоков, а не размеру файла. Если файл не был закрыт
+ * (нет списка блоков), читатель один раз проходит элементы подряд и собирает
+ * индексные блоки; записи после последнего индекса в запросы не попадают.
+ *
+ * Числа хранятся в порядке байтов записавшей машины.
+ */
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "monotonic_clock.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CAPTURE_VERSION 1                  /**< Версия формата */
+#define CAPTURE_DEFAULT_BLOCK_RECORDS 4096 /**< Записей в индексном блоке по умолчанию */
+#define CAPTURE_ANY_TYPE 0xFFFFFFFFu       /**< Запрос пакетов любого типа */
+
+#define CAPTURE_TAG_FILE      0x46504355u  /**< "UCPF": заголовок файла {версия, записей в блоке} */
+#define CAPTURE_TAG_RECORD    0x52504355u  /**< "UCPR": пакет */
+#define CAPTURE_TAG_INDEX     0x49504355u  /**< "UCPI": индексный блок */
+#define CAPTURE_TAG_DIRECTORY 0x44504355u  /**< "UCPD": список блоков */
+#define CAPTURE_TAG_FOOTER    0x5A504355u  /**< "UCPZ": смещение списка блоков */
+
+/**
+ * @struct CaptureIndexEntry
+ * @brief Запись индексного блока.
+ */
+typedef struct {
+    uint64_t timestamp; /**< Время пакета */
+    uint32_t type;      /**< Тип пакета */
+    uint32_t offset;    /**< Смещение записи от начала блока */
+} CaptureIndexEntry;
+
+/**
+ * @struct CaptureBlock
+ * @brief Описание индексного блока в списке блоков.
+ */
+typedef struct {
+    uint64_t first_time;   /**< Время первой записи блока */
+    uint64_t last_time;    /**< Время последней записи блока */
+    uint64_t index_offset; /**< Смещение элемента CAPTURE_TAG_INDEX в файле */
+} CaptureBlock;
+
+/**
+ * @struct CaptureWriter
+ * @brief Запись пакетов в файл.
+ */
+typedef struct {
+    FILE *file;                  /**< Открытый файл */
+    uint64_t offset;             /**< Текущий размер файла */
+    MonotonicClockFn clock;      /**< Источник времени для capture_packet_handler */
+    void *clock_context;         /**< Контекст источника времени */
+
+    uint32_t block_records;      /**< Записей в блоке */
+    uint64_t block_offset;       /**< Смещение первой записи текущего блока */
+    CaptureIndexEntry *entries;  /**< Записи текущего блока */
+    uint32_t entry_count;        /**< Число записей текущего блока */
+    uint64_t last_timestamp;     /**< Время последней записи */
+
+    CaptureBlock *blocks;        /**< Записанные блоки */
+    uint32_t block_count;        /**< Число записанных блоков */
+    uint32_t block_capacity;     /**< Ёмкость массива blocks */
+} CaptureWriter;
+
+/**
+ * @brief Создаёт файл записи.
+ *
+ * @param writer Указатель на структуру записи.
+ * @param path Путь к файлу (перезаписывается).
+ * @param block_records Записей в индексном блоке или 0 для CAPTURE_DEFAULT_BLOCK_RECORDS.
+ * @return Возвращает 0 при успехе или -1 при ошибке.
+ */
+int capture_writer_open(CaptureWriter *writer, const char *path, uint32_t block_records);
+
+/**
+ * @brief Задаёт источник времени для capture_packet_handler.
+ *
+ * По умолчанию используется monotonic_clock_ns.
+ *
+ * @param writer Указатель на структуру записи.
+ * @param clock Функция времени.
+ * @param context Контекст функции времени.
+ */
+void capture_writer_set_clock(CaptureWriter *writer, MonotonicClockFn clock, void *context);
+
+/**
+ * @brief Добавляет пакет.
+ *
+ * Время пакетов не должно убывать.
+ *
+ * @param writer Указатель на структуру записи.
+ * @param timestamp Время пакета в наносекундах.
+ * @param type Тип пакета.
+ * @param data Тело пакета.
+ * @param size Размер тела.
+ * @return Возвращает 0 при успехе или -1 при ошибке записи или убывающем времени.
+ */
+int capture_writer_append(CaptureWriter *writer, uint64_t timestamp, unsigned int type,
+                          const unsigned char *data, unsigned int size);
+
+/**
+ * @brief Записывает индекс незавершённого блока и сбрасывает буферы в файл.
+ *
+ * @param writer Указатель на структуру записи.
+ * @return Возвращает 0 при успехе или -1 при ошибке.
+ */
+int capture_writer_flush(CaptureWriter *writer);
+
+/**
+ * @brief Дописывает список блоков и закрывает файл.
+ *
+ * @param writer Указатель на структуру записи.
+ * @return Возвращает 0 при успехе или -1 при ошибке.
+ */
+int capture_writer_close(CaptureWriter *writer);
+
+/**
+ * @brief Обработчик пакетов для parser_set_handler.
+ *
+ * Записывает пакет с текущим временем источника writer.
+ *
+ * @param context Указатель на CaptureWriter.
+ * @param type Тип пакета.
+ * @param data Тело пакета.
+ * @param size Размер тела.
+ */
+void capture_packet_handler(void *context, unsigned int type, unsigned char *data, unsigned int size);
+
+/**
+ * @struct CaptureReader
+ * @brief Файл записи, отображённый в память.
+ */
+typedef struct {
+    const unsigned char *data;  /**< Содержимое файла */
+    size_t size;                /**< Размер файла */
+    const CaptureBlock *blocks; /**< Список блоков */
+    uint32_t block_count;       /**< Число блоков */
+    CaptureBlock *owned_blocks; /**< Список, собранный при восстановлении (иначе NULL) */
+} CaptureReader;
+
+/**
+ * @struct CapturePacket
+ * @brief Пакет, найденный запросом.
+ *
+ * data указывает внутрь отображения и действителен до capture_reader_close.
+ */
+typedef struct {
+    uint64_t timestamp;         /**< Время пакета */
+    unsigned int type;          /**< Тип пакета */
+    unsigned int size;          /**< Размер тела */
+    const unsigned char *data;  /**< Тело пакета */
+} CapturePacket;
+
+/**
+ * @struct CaptureQuery
+ * @brief Состояние запроса пакетов одного типа за интервал времени.
+ */
+typedef struct {
+    const CaptureReader *reader; /**< Файл */
+    uint32_t type;               /**< Тип или CAPTURE_ANY_TYPE */
+    uint64_t from;               /**< Начало интервала (включительно) */
+    uint64_t to;                 /**< Конец интервала (включительно) */
+    uint32_t block;              /**< Текущий блок */
+    int block_ready;             /**< Диапазон записей текущего блока найден */
+    const unsigned char *entries; /**< Индекс текущего блока */
+    uint64_t block_offset;       /**< Смещение первой записи текущего блока */
+    uint32_t entry;              /**< Текущая запись (индекса или подряд для CAPTURE_ANY_TYPE) */
+    uint32_t entry_end;          /**< Конец диапазона записей в блоке */
+    uint64_t cursor;             /**< Смещение следующей записи для CAPTURE_ANY_TYPE */
+} CaptureQuery;
+
+/**
+ * @brief Открывает файл записи на чтение.
+ *
+ * @param reader Указатель на структуру чтения.
+ * @param path Путь к файлу.
+ * @return Возвращает 0 при успехе или -1, если файл не открыт или повреждён.
+ */
+int capture_reader_open(CaptureReader *reader, const char *path);
+
+/**
+ * @brief Закрывает файл записи.
+ *
+ * @param reader Указатель на структуру чтения.
+ */
+void capture_reader_close(CaptureReader *reader);
+
+/**
+ * @brief Начинает запрос пакетов типа type со временем в [from, to].
+ *
+ * @param query Указатель на состояние запроса.
+ * @param reader Открытый файл.
+ * @param type Тип пакета или CAPTURE_ANY_TYPE.
+ * @param from Начало интервала.
+ * @param to Конец интервала.
+ */
+void capture_query_init(CaptureQuery *query, const CaptureReader *reader, unsigned int type,
+                        uint64_t from, uint64_t to);
+
+/**
+ * @brief Возвращает следующий пакет запроса.
+ *
+ * Пакеты одного блока выдаются по возрастанию времени, блоки - в порядке записи.
+ *
+ * @param query Указатель на состояние запроса.
+ * @param packet Найденный пакет.
+ * @return 1 - пакет найден, 0 - пакетов больше нет, -1 - файл повреждён.
+ */
+int capture_query_next(CaptureQuery *query, CapturePacket *packet);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CAPTURE_H
@@ -0,0 +1,90 @@
+// Запись и просмотр индексированных файлов пакетов (capture.h).
+//
+// Использование:
+//   capture_tool record <поток.bin> <файл.cap>             разобрать сырой поток parse_uart и записать пакеты
+//   capture_tool query <файл.cap> <тип|any> [от_нс] [до_нс]  вывести пакеты типа за интервал времени
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "capture.h"
+#include "parser.h"
+
+#define READ_CHUNK 256
+
+static int record(const char *stream_path, const char *capture_path) {
+    static FIFO_Buffer fifo;
+    static Parser parser;
+    CaptureWriter writer;
+    unsigned char chunk[READ_CHUNK];
+    size_t length;
+    FILE *input = fopen(stream_path, "rb");
+    if (input == NULL) {
+        perror(stream_path);
+        return EXIT_FAILURE;
+    }
+    if (capture_writer_open(&writer, capture_path, 0) != 0) {
+        perror(capture_path);
+        fclose(input);
+        return EXIT_FAILURE;
+    }
+    init_fifo(&fifo);
+    init_parser(&parser, &fifo, NULL);
+    parser_set_handler(&parser, capture_packet_handler, &writer);
+    parser_set_event_sink(&parser, NULL, NULL);
+    while ((length = fread(chunk, 1, sizeof(chunk), input)) > 0) {
+        write_fifo(&fifo, chunk, (int)length);
+        parse_uart(&parser);
+    }
+    fclose(input);
+    if (capture_writer_close(&writer) != 0) {
+        perror(capture_path);
+        return EXIT_FAILURE;
+    }
+    printf("recorded %llu packets\n", (unsigned long long)parser.stats.packets_delivered);
+    return EXIT_SUCCESS;
+}
+
+static int query(int argc, char **argv) {
+    CaptureReader reader;
+    CaptureQuery query;
+    CapturePacket packet;
+    unsigned long long count = 0;
+    unsigned int type = strcmp(argv[3], "any") == 0 ? CAPTURE_ANY_TYPE : (unsigned int)strtoul(argv[3], NULL, 0);
+    uint64_t from = argc > 4 ? strtoull(argv[4], NULL, 0) : 0;
+    uint64_t to = argc > 5 ? strtoull(argv[5], NULL, 0) : UINT64_MAX;
+    int result;
+    if (capture_reader_open(&reader, argv[2]) != 0) {
+        fprintf(stderr, "%s: cannot open capture\n", argv[2]);
+        return EXIT_FAILURE;
+    }
+    capture_query_init(&query, &reader, type, from, to);
+    while ((result = capture_query_next(&query, &packet)) == 1) {
+        printf("%llu type %u size %u:", (unsigned long long)packet.timestamp, packet.type, packet.size);
+        for (unsigned int i = 0; i < packet.size && i < 16; i++) {
+            printf(" %02X", packet.data[i]);
+        }
+        printf(packet.size > 16 ? " ...\n" : "\n");
+        count++;
+    }
+    printf("%llu packets, %u index blocks in capture\n", count, reader.block_count);
+    capture_reader_close(&reader);
+    if (result < 0) {
+        fprintf(stderr, "%s: capture is corrupted\n", argv[2]);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv) {
+    if (argc == 4 && strcmp(argv[1], "record") == 0) {
+        return record(argv[2], argv[3]);
+    }
+    if (argc >= 4 && strcmp(argv[1], "query") == 0) {
+        return query(argc, argv);
+    }
+    fprintf(stderr, "usage: %s record <stream.bin> <file.cap>\n"
+                    "       %s query <file.cap> <type|any> [from_ns] [to_ns]\n", argv[0], argv[0]);
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,154 @@
+// Масштабирование тяжёлых обработчиков в конвейере (pipeline.h) по числу
+// рабочих потоков: раздача через очереди типов с кражей очередей против
+// общей очереди без порядка.
+//
+// Размер тела пакета задаётся его номером среди пакетов того же типа
+// (8 + номер % 24), обработчик проверяет, что размеры одного типа идут по
+// этому циклу. Содержимое тела для проверки не годится: parse_uart сдвигает
+// тело на байт и может оставить в нём байты предыдущего пакета.
+//
+// Использование: dispatch_bench [max_workers] [packets] [work]
+//   work - итераций вычислений в обработчике на пакет
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "monotonic_clock.h"
+#include "pipeline.h"
+
+typedef struct {
+    const unsigned char *data;
+    size_t length;
+    size_t offset;
+} StreamSource;
+
+typedef struct {
+    unsigned int work;
+    uint32_t next[PARSER_TYPE_COUNT]; // номер следующего пакета каждого типа
+    uint64_t out_of_order;            // меняется только для проверки, гонка не важна
+    volatile uint64_t sink;
+} HeavyHandler;
+
+static int stream_read(void *context, unsigned char *buffer, int capacity) {
+    StreamSource *source = (StreamSource *)context;
+    size_t length = source->length - source->offset;
+    if (length == 0) {
+        return -1;
+    }
+    if (length > (size_t)capacity) {
+        length = (size_t)capacity;
+    }
+    memcpy(buffer, source->data + source->offset, length);
+    source->offset += length;
+    return (int)length;
+}
+
+static void heavy_packet(void *context, unsigned int type, unsigned char *data, unsigned int size) {
+    HeavyHandler *handler = (HeavyHandler *)context;
+    uint64_t x = type;
+    if (size != 8 + handler->next[type] % 24) {
+        handler->out_of_order++;
+    }
+    handler->next[type]++;
+    for (unsigned int i = 0; i < handler->work; i++) {
+        x = x * 6364136223846793005ull + data[i % size];
+    }
+    handler->sink = x;
+}
+
+// Поток со смещённым распределением типов: половина пакетов - 4 «горячих» типа.
+// Типы меньше 128: контрольная сумма parse_uart учитывает только младший байт типа
+static unsigned char *make_stream(int packets, size_t *length) {
+    static uint32_t counters[PARSER_TYPE_COUNT];
+    unsigned char *stream = malloc((size_t)packets * (SYNC_SEQUENCE_LENGTH + MAX_HEADER_SIZE + 33));
+    unsigned char body[32];
+    uint64_t rng = 88172645463325252ull;
+    *length = 0;
+    for (int i = 0; i < packets; i++) {
+        unsigned int packet_length;
+        unsigned int type;
+        unsigned int size;
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        type = (rng & 1) ? (unsigned int)(rng >> 8) % 4 : 4 + (unsigned int)(rng >> 8) % 124;
+        size = 8 + counters[type]++ % 24;
+        memset(body, (int)type, sizeof(body));
+        build_packet(stream + *length, &packet_length, size, type, body);
+        *length += packet_length;
+        stream[(*length)++] = 0x00; // parse_uart дочитывает байт после тела
+    }
+    return stream;
+}
+
+static double run(const unsigned char *stream, size_t length, int workers, int ordered, unsigned int work,
+                  PipelineStats *stats, uint64_t *out_of_order) {
+    static HeavyHandler handler;
+    static Pipeline pipeline;
+    StreamSource source = {stream, length, 0};
+    PipelineConfig config;
+    uint64_t start;
+    memset(&handler, 0, sizeof(handler));
+    handler.work = work;
+    pipeline_default_config(&config);
+    config.source = stream_read;
+    config.source_context = &source;
+    config.handler = heavy_packet;
+    config.handler_context = &handler;
+    config.worker_count = workers;
+    config.preserve_type_order = ordered;
+    config.chunk_size = 4096;
+    start = monotonic_clock_ns(NULL);
+    if (pipeline_start(&pipeline, &config) != 0) {
+        fprintf(stderr, "pipeline_start failed\n");
+        exit(EXIT_FAILURE);
+    }
+    pipeline_wait(&pipeline);
+    *stats = pipeline.stats;
+    *out_of_order = handler.out_of_order;
+    return (double)(monotonic_clock_ns(NULL) - start) * 1e-9;
+}
+
+int main(int argc, char **argv) {
+    int max_workers = argc > 1 ? atoi(argv[1]) : 4;
+    int packets = argc > 2 ? atoi(argv[2]) : 200000;
+    unsigned int work = argc > 3 ? (unsigned int)atoi(argv[3]) : 2000;
+    size_t length;
+    unsigned char *stream = make_stream(packets, &length);
+    double base = 0.0;
+    int failed = 0;
+
+    printf("%d packets, %u iterations per packet\n", packets, work);
+    printf("%-9s %7s %10s %8s %7s %7s %9s %8s\n", "mode", "workers", "packets/s", "speedup", "stolen",
+           "migr", "imbalance", "ordered");
+    for (int workers = 1; workers <= max_workers; workers *= 2) {
+        for (int ordered = 1; ordered >= 0; ordered--) {
+            PipelineStats stats;
+            uint64_t out_of_order;
+            double seconds = run(stream, length, workers, ordered, work, &stats, &out_of_order);
+            char imbalance[16] = "-";
+            if (ordered) {
+                snprintf(imbalance, sizeof(imbalance), "%.2f", stats.dispatch.imbalance);
+            }
+            if (ordered && workers == 1) {
+                base = seconds;
+            }
+            printf("%-9s %7d %10.0f %7.2fx %7llu %7llu %9s %8s\n", ordered ? "by-type" : "shared", workers,
+                   (double)stats.packets_handled / seconds, base / seconds,
+                   (unsigned long long)stats.dispatch.shards_stolen, (unsigned long long)stats.dispatch.migrations,
+                   imbalance,
+                   out_of_order == 0 ? "yes" : "no");
+            if (stats.packets_handled != (uint64_t)packets ||
+                (ordered && (out_of_order != 0 || stats.dispatch.order_violations != 0))) {
+                failed = 1;
+            }
+        }
+    }
+    free(stream);
+    if (failed) {
+        fprintf(stderr, "FAILED: lost packets or broken per-type order\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
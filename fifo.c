@@ -9,25 +9,307 @@
  * Этот файл содержит реализацию функций для работы с FIFO-буфером.
  */
 #include "fifo.h"
+
+#if defined(PARSER_PROFILE) && PARSER_PROFILE
+#include "parser_profile.h"
+#define PROFILE_WRITE_BEGIN() int profile_owner = parser_profile_begin(PARSER_PROFILE_CALL_FIFO_WRITE, PARSER_PROFILE_FIFO_WRITE)
+#define PROFILE_WRITE_END() parser_profile_end(profile_owner)
+#else
+#define PROFILE_WRITE_BEGIN() ((void)0)
+#define PROFILE_WRITE_END() ((void)0)
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+#define pool_yield() SwitchToThread()
+#else
+#include <sched.h>
+#define pool_yield() sched_yield()
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define pool_pause() _mm_pause()
+#elif defined(__GNUC__) && (defined(__aarch64__) || defined(__arm__))
+#define pool_pause() __asm__ __volatile__("yield")
+#else
+#define pool_pause() ((void)0)
+#endif
+
+#define POOL_LOCK_SPINS 64 // Проверок занятой блокировки с pause, дальше - с уступкой ядра
 // Инициализация буфера
 void init_fifo(FIFO_Buffer *fifo) {
     fifo->head = 0;
     fifo->tail = 0;
     fifo->size = 0;
-    memset(fifo->buffer, 0, MAX_FIFO_SIZE);
+    fifo->timestamps = NULL;
+    fifo->watermark = NULL;
+    fifo->pool = NULL;
+    fifo->overflow = NULL;
+    fifo->overflow_tail = NULL;
+    fifo->overflow_size = 0;
+    fifo->overflow_segments = 0;
+    fifo->max_segments = 0;
+}
+
+// Пул делят потоки разных каналов: спин-блокировка только на перестановку указателей.
+// Занятую блокировку ждём чтением (строка кэша остаётся общей), обмен - только когда она освободилась.
+static void pool_lock(FifoPool *pool) {
+    while (atomic_exchange_explicit(&pool->lock, 1, memory_order_acquire)) {
+        int spins = 0;
+        while (atomic_load_explicit(&pool->lock, memory_order_relaxed)) {
+            if (spins < POOL_LOCK_SPINS) {
+                spins++;
+                pool_pause();
+            } else {
+                pool_yield();
+            }
+        }
+    }
+}
+
+static void pool_unlock(FifoPool *pool) {
+    atomic_store_explicit(&pool->lock, 0, memory_order_release);
+}
+
+// Цепочка из count сегментов для буфера; NULL, если в пуле или в лимите буфера их не хватает
+static FifoSegment *take_segments(FIFO_Buffer *fifo, int count) {
+    FifoPool *pool = fifo->pool;
+    FifoSegment *first;
+    FifoSegment *last;
+    pool_lock(pool);
+    if (pool->segment_count - pool->in_use < count ||
+        (fifo->max_segments > 0 && fifo->overflow_segments + count > fifo->max_segments)) {
+        pool->exhausted++;
+        pool_unlock(pool);
+        return NULL;
+    }
+    first = pool->free_list;
+    last = first;
+    for (int i = 1; i < count; i++) {
+        last = last->next;
+    }
+    pool->free_list = last->next;
+    pool->in_use += count;
+    if (pool->in_use > pool->peak_in_use) {
+        pool->peak_in_use = pool->in_use;
+    }
+    pool_unlock(pool);
+    last->next = NULL;
+    for (FifoSegment *segment = first; segment != NULL; segment = segment->next) {
+        segment->length = 0;
+    }
+    fifo->overflow_segments += count;
+    return first;
+}
+
+static void put_segment(FIFO_Buffer *fifo, FifoSegment *segment) {
+    FifoPool *pool = fifo->pool;
+    fifo->overflow_segments--;
+    pool_lock(pool);
+    segment->next = pool->free_list;
+    pool->free_list = segment;
+    pool->in_use--;
+    pool_unlock(pool);
+}
+
+// Копирование в кольцо; место проверено вызывающим
+static void ring_put(FIFO_Buffer *fifo, const unsigned char *data, int length) {
+    int first = MAX_FIFO_SIZE - fifo->tail;
+    if (first > length) {
+        first = length;
+    }
+    memcpy(&fifo->buffer[fifo->tail], data, (size_t)first);
+    memcpy(fifo->buffer, data + first, (size_t)(length - first));
+    fifo->tail = (fifo->tail + length) % MAX_FIFO_SIZE;
+    fifo->size += length;
+}
+
+// Запись растущего буфера: сначала остаток кольца (если сегментов ещё нет), потом сегменты.
+// Сегменты берутся до записи, поэтому при их нехватке буфер не меняется
+static int write_overflow(FIFO_Buffer *fifo, const unsigned char *data, int length) {
+    FifoSegment *segment = fifo->overflow_tail;
+    FifoSegment *added = NULL;
+    int ring = fifo->overflow == NULL ? MAX_FIFO_SIZE - fifo->size : 0;
+    int spare = segment != NULL ? FIFO_SEGMENT_SIZE - segment->length : 0;
+    int rest;
+    if (ring > length) {
+        ring = length;
+    }
+    rest = length - ring;
+    if (rest > spare) {
+        added = take_segments(fifo, (rest - spare + FIFO_SEGMENT_SIZE - 1) / FIFO_SEGMENT_SIZE);
+        if (added == NULL) {
+            return -1;
+        }
+    }
+    ring_put(fifo, data, ring);
+    data += ring;
+    fifo->overflow_size += rest;
+    if (added != NULL) {
+        if (segment != NULL) {
+            segment->next = added;
+        } else {
+            fifo->overflow = added;
+            segment = added;
+        }
+    }
+    while (rest > 0) {
+        if (segment->length == FIFO_SEGMENT_SIZE) {
+            segment = segment->next;
+        }
+        int chunk = FIFO_SEGMENT_SIZE - segment->length < rest ? FIFO_SEGMENT_SIZE - segment->length : rest;
+        memcpy(segment->data + segment->length, data, (size_t)chunk);
+        segment->length += chunk;
+        data += chunk;
+        rest -= chunk;
+    }
+    if (segment != NULL) {
+        fifo->overflow_tail = segment;
+    }
+    return 0;
+}
+
+// Перенос головных сегментов в кольцо, пока каждый помещается целиком
+static void refill(FIFO_Buffer *fifo) {
+    FifoSegment *segment;
+    while ((segment = fifo->overflow) != NULL && segment->length <= MAX_FIFO_SIZE - fifo->size) {
+        ring_put(fifo, segment->data, segment->length);
+        fifo->overflow_size -= segment->length;
+        fifo->overflow = segment->next;
+        if (fifo->overflow == NULL) {
+            fifo->overflow_tail = NULL;
+        }
+        put_segment(fifo, segment);
+    }
+}
+
+// Отметка времени для только что записанных байтов
+static void note_write(FIFO_Buffer *fifo, int length) {
+    FifoTimestamps *ts = fifo->timestamps;
+    ts->written += (uint64_t)length;
+    if (ts->count == FIFO_TIMESTAMP_MARKS) {
+        // Нет места: продлеваем последнюю отметку, сохраняя её более раннее время
+        ts->end_offset[(ts->first + ts->count - 1) % FIFO_TIMESTAMP_MARKS] = ts->written;
+    } else {
+        int slot = (ts->first + ts->count) % FIFO_TIMESTAMP_MARKS;
+        ts->end_offset[slot] = ts->written;
+        ts->time[slot] = ts->clock(ts->clock_context);
+        ts->count++;
+    }
+}
+
+// Порог пробуждения: нужное потребителю, но не меньше уровня объединения
+static int watermark_threshold(const FifoWatermark *wm) {
+    int threshold = wm->need > wm->level ? wm->need : wm->level;
+    return threshold < MAX_FIFO_SIZE ? threshold : MAX_FIFO_SIZE;
+}
+
+// Пробуждение потребителя, если после записи набрался порог
+static void note_watermark(FIFO_Buffer *fifo) {
+    FifoWatermark *wm = fifo->watermark;
+    if (!wm->armed || fifo->size + fifo->overflow_size < watermark_threshold(wm)) {
+        return;
+    }
+    wm->armed = 0;
+    wm->wakeups++;
+    if (wm->clock != NULL) {
+        uint64_t now = wm->clock(wm->clock_context);
+        uint64_t interval = now - wm->last_wake;
+        if (interval < wm->target_interval_ns) {
+            wm->level = wm->level * 2 < wm->max_level ? wm->level * 2 : wm->max_level;
+        } else if (interval / 4 > wm->target_interval_ns) {
+            wm->level = wm->level / 2 > wm->min_level ? wm->level / 2 : wm->min_level;
+        }
+        wm->last_wake = now;
+    }
+    wm->wake(wm->wake_context);
 }
 
 // Запись значения в буфер
 int write_fifo(FIFO_Buffer *fifo, const unsigned char *data, int length) {
-    if (length > (MAX_FIFO_SIZE - fifo->size)) {
+    if (length > (MAX_FIFO_SIZE - fifo->size) && fifo->pool == NULL) {
         // Если длина новых данных length превышает доступное место, функция возвращает -1
         return -1;
     }
-    for (int i = 0; i < length; i++) {
-        fifo->buffer[fifo->tail] = data[i];
-        fifo->tail = (fifo->tail + 1) % MAX_FIFO_SIZE;
+    PROFILE_WRITE_BEGIN();
+    if (fifo->overflow == NULL && length <= MAX_FIFO_SIZE - fifo->size) {
+        for (int i = 0; i < length; i++) {
+            fifo->buffer[fifo->tail] = data[i];
+            fifo->tail = (fifo->tail + 1) % MAX_FIFO_SIZE;
+        }
+        fifo->size += length; // Изменение количесвта данных в буфере
+    } else if (write_overflow(fifo, data, length) != 0) {
+        // Растущему буферу не хватило сегментов
+        PROFILE_WRITE_END();
+        return -1;
+    }
+    if (fifo->timestamps != NULL && length > 0) {
+        note_write(fifo, length);
     }
-    fifo->size += length; // Изменение количесвта данных в буфере
+    if (fifo->watermark != NULL) {
+        note_watermark(fifo);
+    }
+    PROFILE_WRITE_END();
+    return 0;
+}
+
+// Свободное место в буфере в виде не более чем двух непрерывных участков
+int fifo_write_regions(FIFO_Buffer *fifo, unsigned char **first, int *first_length,
+                       unsigned char **second, int *second_length) {
+    int free_space = MAX_FIFO_SIZE - fifo->size;
+    int until_end = MAX_FIFO_SIZE - fifo->tail;
+    if (fifo->pool != NULL && (fifo->overflow != NULL || free_space == 0)) {
+        // Кольцо заполнено: место в последнем сегменте или в новом
+        FifoSegment *segment = fifo->overflow_tail;
+        if (segment == NULL || segment->length == FIFO_SEGMENT_SIZE) {
+            FifoSegment *added = take_segments(fifo, 1);
+            if (added != NULL) {
+                if (segment != NULL) {
+                    segment->next = added;
+                } else {
+                    fifo->overflow = added;
+                }
+                fifo->overflow_tail = added;
+            }
+            segment = added;
+        }
+        *first = segment != NULL ? segment->data + segment->length : NULL;
+        *first_length = segment != NULL ? FIFO_SEGMENT_SIZE - segment->length : 0;
+        *second = NULL;
+        *second_length = 0;
+        return *first_length;
+    }
+    *first = &fifo->buffer[fifo->tail];
+    *first_length = free_space < until_end ? free_space : until_end;
+    *second = fifo->buffer;
+    *second_length = free_space - *first_length;
+    return free_space;
+}
+
+// Фиксация байтов, записанных напрямую в участки из fifo_write_regions
+int fifo_commit_write(FIFO_Buffer *fifo, int length) {
+    FifoSegment *segment = fifo->overflow_tail;
+    int free_space = segment != NULL ? FIFO_SEGMENT_SIZE - segment->length : MAX_FIFO_SIZE - fifo->size;
+    if (length < 0 || length > free_space) {
+        return -1;
+    }
+    PROFILE_WRITE_BEGIN();
+    if (segment != NULL) {
+        // Участок из fifo_write_regions был в последнем сегменте
+        segment->length += length;
+        fifo->overflow_size += length;
+    } else {
+        fifo->tail = (fifo->tail + length) % MAX_FIFO_SIZE;
+        fifo->size += length;
+    }
+    if (fifo->timestamps != NULL && length > 0) {
+        note_write(fifo, length);
+    }
+    if (fifo->watermark != NULL) {
+        note_watermark(fifo);
+    }
+    PROFILE_WRITE_END();
     return 0;
 }
 
@@ -39,6 +321,37 @@ int read_fifo(FIFO_Buffer *fifo, unsigned char *byte) {
     *byte = fifo->buffer[fifo->head];
     fifo->head = (fifo->head + 1) % MAX_FIFO_SIZE;
     fifo->size--;
+    if (fifo->overflow != NULL) {
+        refill(fifo);
+    }
+    return 0;
+}
+
+// Пропуск байтов без копирования
+int fifo_skip(FIFO_Buffer *fifo, int count) {
+    if (count < 0 || count > fifo->size + fifo->overflow_size) {
+        return -1;
+    }
+    fifo->head = (fifo->head + (count < fifo->size ? count : fifo->size)) % MAX_FIFO_SIZE;
+    if (count <= fifo->size) {
+        fifo->size -= count;
+        if (fifo->overflow != NULL) {
+            refill(fifo);
+        }
+        return 0;
+    }
+    // Пропуск дальше кольца: остаток снимается с сегментов по мере их переноса
+    count -= fifo->size;
+    fifo->size = 0;
+    while (count > 0) {
+        int chunk;
+        refill(fifo);
+        chunk = count < fifo->size ? count : fifo->size;
+        fifo->head = (fifo->head + chunk) % MAX_FIFO_SIZE;
+        fifo->size -= chunk;
+        count -= chunk;
+    }
+    refill(fifo);
     return 0;
 }
 
@@ -51,3 +364,144 @@ int peek_fifo(FIFO_Buffer *fifo, int index, unsigned char *byte) {
     *byte = fifo->buffer[pos];
     return 0;
 }
+
+// Включение отметок времени поступления
+void fifo_enable_timestamps(FIFO_Buffer *fifo, FifoTimestamps *timestamps, MonotonicClockFn clock, void *context) {
+    fifo->timestamps = timestamps;
+    if (timestamps != NULL) {
+        memset(timestamps, 0, sizeof(*timestamps));
+        timestamps->clock = clock;
+        timestamps->clock_context = context;
+        timestamps->written = (uint64_t)fifo->size; // Уже лежащие в буфере байты считаем пришедшими сейчас
+        if (fifo->size > 0) {
+            timestamps->end_offset[0] = timestamps->written;
+            timestamps->time[0] = clock(context);
+            timestamps->count = 1;
+        }
+    }
+}
+
+// Включение пробуждения по уровню
+void fifo_set_watermark(FIFO_Buffer *fifo, FifoWatermark *watermark, FifoWakeFn wake, void *context) {
+    fifo->watermark = watermark;
+    if (watermark != NULL) {
+        memset(watermark, 0, sizeof(*watermark));
+        watermark->wake = wake;
+        watermark->wake_context = context;
+        watermark->level = 1;
+        watermark->min_level = 1;
+        watermark->max_level = 1;
+        watermark->need = 1;
+    }
+}
+
+// Адаптивное объединение пробуждений
+void fifo_watermark_coalesce(FifoWatermark *watermark, int min_level, int max_level, uint64_t target_interval_ns,
+                             MonotonicClockFn clock, void *context) {
+    watermark->min_level = min_level < 1 ? 1 : min_level;
+    watermark->max_level = max_level > MAX_FIFO_SIZE ? MAX_FIFO_SIZE : max_level;
+    if (watermark->max_level < watermark->min_level) {
+        watermark->max_level = watermark->min_level;
+    }
+    watermark->level = watermark->min_level;
+    watermark->target_interval_ns = target_interval_ns;
+    watermark->clock = clock;
+    watermark->clock_context = context;
+    watermark->last_wake = clock != NULL ? clock(context) : 0;
+}
+
+// Взведение пробуждения; 1 - ждать не нужно
+int fifo_watermark_arm(FIFO_Buffer *fifo, int need) {
+    FifoWatermark *wm = fifo->watermark;
+    wm->need = need < 1 ? 1 : need;
+    if (fifo->size + fifo->overflow_size >= watermark_threshold(wm)) {
+        wm->armed = 0;
+        return 1;
+    }
+    wm->armed = 1;
+    return 0;
+}
+
+// Таймаут потребителя: данных меньше уровня, поток реже ожидаемого
+void fifo_watermark_expire(FIFO_Buffer *fifo) {
+    FifoWatermark *wm = fifo->watermark;
+    wm->armed = 0;
+    wm->expirations++;
+    wm->level = wm->level / 2 > wm->min_level ? wm->level / 2 : wm->min_level;
+}
+
+// Время поступления байта с индексом index от головы
+uint64_t fifo_arrival_time(FIFO_Buffer *fifo, int index) {
+    FifoTimestamps *ts = fifo->timestamps;
+    if (ts == NULL || ts->count == 0) {
+        return 0;
+    }
+    uint64_t consumed = ts->written - (uint64_t)(fifo->size + fifo->overflow_size);
+    uint64_t offset = consumed + (uint64_t)index;
+    // Отметки, все байты которых уже прочитаны, больше не нужны
+    while (ts->count > 1 && ts->end_offset[ts->first] <= consumed) {
+        ts->first = (ts->first + 1) % FIFO_TIMESTAMP_MARKS;
+        ts->count--;
+    }
+    for (int i = 0; i < ts->count; i++) {
+        int slot = (ts->first + i) % FIFO_TIMESTAMP_MARKS;
+        if (ts->end_offset[slot] > offset) {
+            return ts->time[slot];
+        }
+    }
+    return ts->time[(ts->first + ts->count - 1) % FIFO_TIMESTAMP_MARKS];
+}
+
+// Пул сегментов: вся память выделяется сразу, сегменты только переходят между списками
+int fifo_pool_init(FifoPool *pool, int segment_count) {
+    memset(pool, 0, sizeof(*pool));
+    atomic_init(&pool->lock, 0);
+    if (segment_count < 0) {
+        return -1;
+    }
+    if (segment_count > 0) {
+        pool->segments = malloc((size_t)segment_count * sizeof(FifoSegment));
+        if (pool->segments == NULL) {
+            return -1;
+        }
+    }
+    for (int i = segment_count - 1; i >= 0; i--) {
+        pool->segments[i].next = pool->free_list;
+        pool->free_list = &pool->segments[i];
+    }
+    pool->segment_count = segment_count;
+    return 0;
+}
+
+void fifo_pool_destroy(FifoPool *pool) {
+    free(pool->segments);
+    memset(pool, 0, sizeof(*pool));
+}
+
+// Включение роста буфера за счёт пула
+int fifo_set_pool(FIFO_Buffer *fifo, FifoPool *pool, int max_segments) {
+    if (fifo->overflow != NULL) {
+        return -1;
+    }
+    fifo->pool = pool;
+    fifo->max_segments = max_segments < 0 ? 0 : max_segments;
+    return 0;
+}
+
+int fifo_total_size(const FIFO_Buffer *fifo) {
+    return fifo->size + fifo->overflow_size;
+}
+
+// Опустошение буфера с возвратом сегментов в пул
+void fifo_reset(FIFO_Buffer *fifo) {
+    while (fifo->overflow != NULL) {
+        FifoSegment *segment = fifo->overflow;
+        fifo->overflow = segment->next;
+        put_segment(fifo, segment);
+    }
+    fifo->overflow_tail = NULL;
+    fifo->overflow_size = 0;
+    fifo->head = 0;
+    fifo->tail = 0;
+    fifo->size = 0;
+}
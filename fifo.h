@@ -11,14 +11,17 @@
 #ifndef FIFO_H
 #define FIFO_H
 
-#ifdef __cplusplus
-extern "C" {
-#endif
-
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stddef.h>
+#include <stdint.h>
+#include "monotonic_clock.h"
+#include "parser_atomic.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 /**
  * @file fifo.h
@@ -28,8 +31,132 @@ extern "C" {
  * необходимых для инициализации и работы с FIFO-буфером.
  */
 
-/// Максимальный размер FIFO-буфера.
+/// Максимальный размер FIFO-буфера (можно переопределить при сборке через -DMAX_FIFO_SIZE).
+#ifndef MAX_FIFO_SIZE
 #define MAX_FIFO_SIZE 2048           /**< Максимальный размер FIFO буфера */
+#endif
+
+/// Компактная сборка (то же значение по умолчанию, что в parser_config.h: fifo.h подключается и без него).
+#ifndef PARSER_COMPACT
+#define PARSER_COMPACT 0
+#endif
+
+/**
+ * @brief Тип индексов и размера FIFO.
+ *
+ * В компактной сборке (PARSER_COMPACT) - 16 бит, поэтому MAX_FIFO_SIZE не больше 65535.
+ */
+#if PARSER_COMPACT
+#if MAX_FIFO_SIZE > 65535
+#error "В компактной сборке MAX_FIFO_SIZE не больше 65535"
+#endif
+typedef uint16_t FifoIndex;
+#else
+typedef int FifoIndex;
+#endif
+
+#ifndef FIFO_TIMESTAMP_MARKS
+#define FIFO_TIMESTAMP_MARKS 64      /**< Сколько последних записей в FIFO помнят своё время */
+#endif
+
+/**
+ * @struct FifoTimestamps
+ * @brief Время поступления данных в FIFO (для трассировки задержек).
+ *
+ * Каждый вызов write_fifo добавляет отметку "байты до смещения end_offset
+ * потока пришли в момент time". Если отметок больше FIFO_TIMESTAMP_MARKS,
+ * новая запись присоединяется к последней отметке с её (более ранним)
+ * временем, т.е. задержка оценивается с запасом.
+ */
+typedef struct {
+    MonotonicClockFn clock;                   /**< Источник времени */
+    void *clock_context;                      /**< Контекст источника времени */
+    uint64_t written;                         /**< Всего байтов записано в FIFO */
+    uint64_t end_offset[FIFO_TIMESTAMP_MARKS];/**< Смещение потока после каждой записи */
+    uint64_t time[FIFO_TIMESTAMP_MARKS];      /**< Время каждой записи, нс */
+    int first;                                /**< Индекс самой старой отметки */
+    int count;                                /**< Число отметок */
+} FifoTimestamps;
+
+/**
+ * @brief Функция пробуждения потребителя (например, запись в eventfd или futex).
+ *
+ * @param context Контекст, переданный в fifo_set_watermark.
+ */
+typedef void (*FifoWakeFn)(void *context);
+
+/**
+ * @struct FifoWatermark
+ * @brief Пробуждение потребителя по уровню заполнения FIFO.
+ *
+ * Потребитель после разбора взводит уровень (fifo_watermark_arm), указывая,
+ * сколько байтов нужно, чтобы разбор продвинулся (parser_bytes_needed), и
+ * засыпает. Запись, после которой в буфере набралось не меньше
+ * max(need, level) байтов, один раз вызывает wake. Пока потребитель не
+ * взвёл уровень снова, записи его не будят, а по пустому каналу никто не
+ * просыпается вовсе.
+ *
+ * При адаптивном объединении (fifo_watermark_coalesce) level растёт вдвое,
+ * если пробуждения идут чаще target_interval_ns, и уменьшается вдвое, если
+ * реже в 4 раза или потребитель проснулся по своему таймауту
+ * (fifo_watermark_expire). Так занятый канал будит потребителя пачками,
+ * а редкие пакеты не ждут накопления.
+ */
+typedef struct {
+    FifoWakeFn wake;                 /**< Функция пробуждения */
+    void *wake_context;              /**< Контекст функции пробуждения */
+    MonotonicClockFn clock;          /**< Источник времени для объединения (NULL - уровень постоянный) */
+    void *clock_context;             /**< Контекст источника времени */
+    int level;                       /**< Текущий уровень объединения, байт */
+    int min_level;                   /**< Наименьший уровень */
+    int max_level;                   /**< Наибольший уровень */
+    uint64_t target_interval_ns;     /**< Желаемый наименьший промежуток между пробуждениями */
+    int need;                        /**< Байтов, нужных потребителю для продвижения */
+    int armed;                       /**< Потребитель ждёт пробуждения */
+    uint64_t last_wake;              /**< Время последнего пробуждения */
+    uint64_t wakeups;                /**< Пробуждений */
+    uint64_t expirations;            /**< Таймаутов потребителя ниже уровня */
+} FifoWatermark;
+
+#ifndef FIFO_SEGMENT_SIZE
+/** Размер сегмента расширения FIFO (не больше MAX_FIFO_SIZE / 2) */
+#define FIFO_SEGMENT_SIZE (MAX_FIFO_SIZE / 8 < 256 ? MAX_FIFO_SIZE / 8 : 256)
+#endif
+
+#if FIFO_SEGMENT_SIZE < 1 || FIFO_SEGMENT_SIZE > MAX_FIFO_SIZE / 2
+#error "FIFO_SEGMENT_SIZE должен быть от 1 до MAX_FIFO_SIZE / 2"
+#endif
+
+/**
+ * @struct FifoSegment
+ * @brief Сегмент расширения FIFO: байты, не поместившиеся в кольцо.
+ *
+ * Сегмент заполняется с начала и переносится в кольцо целиком.
+ */
+typedef struct FifoSegment {
+    struct FifoSegment *next;              /**< Следующий сегмент (в FIFO или в списке свободных) */
+    int length;                            /**< Записано байтов */
+    unsigned char data[FIFO_SEGMENT_SIZE]; /**< Данные */
+} FifoSegment;
+
+/**
+ * @struct FifoPool
+ * @brief Общий запас сегментов расширения для многих FIFO.
+ *
+ * Все сегменты выделяются один раз в fifo_pool_init и дальше только
+ * переходят между списком свободных и FIFO, поэтому указатели на их данные
+ * не меняются. Пул можно делить между потоками: список свободных защищён
+ * спин-блокировкой (сами FIFO, как и раньше, однопоточные).
+ */
+typedef struct {
+    FifoSegment *segments;   /**< Память всех сегментов */
+    FifoSegment *free_list;  /**< Свободные сегменты */
+    int segment_count;       /**< Всего сегментов */
+    int in_use;              /**< Сегментов присоединено к FIFO */
+    int peak_in_use;         /**< Наибольшее in_use */
+    uint64_t exhausted;      /**< Записей, которым не хватило сегментов */
+    parser_atomic_int lock;  /**< Спин-блокировка: 1 - занята */
+} FifoPool;
 
 /**
  * @struct FIFO_Buffer
@@ -46,18 +173,44 @@ extern "C" {
  *
  * @var FIFO_Buffer::size
  * Текущее количество элементов в буфере.
+ *
+ * @var FIFO_Buffer::timestamps
+ * Отметки времени поступления данных или NULL, если они не ведутся.
+ *
+ * @var FIFO_Buffer::watermark
+ * Пробуждение потребителя по уровню заполнения или NULL.
+ *
+ * @var FIFO_Buffer::pool
+ * Пул сегментов расширения или NULL, если буфер фиксированного размера.
+ *
+ * Растущий буфер (fifo_set_pool): запись, не поместившаяся в кольцо,
+ * продолжается в сегментах из пула, присоединённых цепочкой за кольцом.
+ * Чтение (read_fifo, fifo_skip) по мере освобождения места переносит
+ * головной сегмент в кольцо целиком и возвращает его в пул, поэтому все
+ * читатели по-прежнему видят непрерывные данные в buffer: пока цепочка не
+ * пуста, в кольце не меньше MAX_FIFO_SIZE - FIFO_SEGMENT_SIZE байтов.
+ * size - байты в кольце, overflow_size - в сегментах.
  */
 typedef struct {
     unsigned char buffer[MAX_FIFO_SIZE]; /**< Массив для хранения данных буфера */
-    int head;                            /**< Индекс головы буфера */
-    int tail;                            /**< Индекс хвоста буфера */
-    int size;                            /**< Текущее количество элементов в буфере */
+    FifoIndex head;                      /**< Индекс головы буфера */
+    FifoIndex tail;                      /**< Индекс хвоста буфера */
+    FifoIndex size;                      /**< Текущее количество элементов в буфере */
+    FifoTimestamps *timestamps;          /**< Отметки времени поступления (NULL - выключены) */
+    FifoWatermark *watermark;            /**< Пробуждение по уровню (NULL - выключено) */
+    FifoPool *pool;                      /**< Пул сегментов расширения (NULL - размер фиксирован) */
+    FifoSegment *overflow;               /**< Первый сегмент с данными после кольца */
+    FifoSegment *overflow_tail;          /**< Последний сегмент */
+    int overflow_size;                   /**< Байтов в сегментах */
+    int overflow_segments;               /**< Присоединено сегментов */
+    int max_segments;                    /**< Наибольшее число сегментов (0 - без ограничения) */
 } FIFO_Buffer;
 
 /**
  * @brief Инициализирует FIFO-буфер.
  *
  * Устанавливает начальные значения для головы, хвоста и размера буфера.
+ * Сам массив не обнуляется: байты читаются только после записи.
  *
  * @param fifo Указатель на структуру FIFO_Buffer.
  */
@@ -67,6 +220,9 @@ void init_fifo(FIFO_Buffer *fifo);
  * @brief Записывает данные в FIFO-буфер.
  *
  * Добавляет указанное количество байтов из массива данных в буфер.
+ * Растущий буфер при нехватке места в кольце берёт сегменты из пула;
+ * запись либо выполняется целиком, либо (если сегментов не хватило) не
+ * выполняется вовсе.
  *
  * @param fifo Указатель на структуру FIFO_Buffer.
  * @param data Указатель на массив данных для записи.
@@ -75,6 +231,35 @@ void init_fifo(FIFO_Buffer *fifo);
  */
 int write_fifo(FIFO_Buffer *fifo, const unsigned char *data, int length);
 
+/**
+ * @brief Возвращает свободное место буфера для записи без копирования.
+ *
+ * Свободное место описывается двумя непрерывными участками: от хвоста до
+ * конца массива и от начала массива. Данные, записанные туда напрямую
+ * (например, вызовом readv), фиксируются через fifo_commit_write.
+ * У растущего буфера с заполненным кольцом участок один - свободное место
+ * последнего сегмента (при необходимости присоединяется новый); 0, если
+ * сегментов в пуле не осталось.
+ *
+ * @param fifo Указатель на структуру FIFO_Buffer.
+ * @param first Адрес первого участка.
+ * @param first_length Длина первого участка.
+ * @param second Адрес второго участка.
+ * @param second_length Длина второго участка (0, если участок один).
+ * @return Общий объём свободного места.
+ */
+int fifo_write_regions(FIFO_Buffer *fifo, unsigned char **first, int *first_length,
+                       unsigned char **second, int *second_length);
+
+/**
+ * @brief Фиксирует байты, записанные напрямую в свободное место буфера.
+ *
+ * @param fifo Указатель на структуру FIFO_Buffer.
+ * @param length Число записанных байтов.
+ * @return Возвращает 0 при успехе или -1, если length больше свободного места.
+ */
+int fifo_commit_write(FIFO_Buffer *fifo, int length);
+
 /**
  * @brief Читает один байт из FIFO-буфера.
  *
@@ -86,6 +271,15 @@ int write_fifo(FIFO_Buffer *fifo, const unsigned char *data, int length);
  */
 int read_fifo(FIFO_Buffer *fifo, unsigned char *byte);
 
+/**
+ * @brief Удаляет байты из головы FIFO-буфера без копирования.
+ *
+ * @param fifo Указатель на структуру FIFO_Buffer.
+ * @param count Число байтов.
+ * @return Возвращает 0 при успехе или -1, если в буфере меньше count байтов.
+ */
+int fifo_skip(FIFO_Buffer *fifo, int count);
+
 /**
  * @brief Просматривает байт в FIFO-буфере по индексу.
  *
@@ -98,6 +292,124 @@ int read_fifo(FIFO_Buffer *fifo, unsigned char *byte);
  */
 int peek_fifo(FIFO_Buffer *fifo, int index, unsigned char *byte);
 
+/**
+ * @brief Включает отметки времени поступления данных.
+ *
+ * После вызова каждая запись write_fifo запоминает время из clock.
+ *
+ * @param fifo Указатель на структуру FIFO_Buffer.
+ * @param timestamps Хранилище отметок (должно жить не меньше буфера) или NULL, чтобы выключить.
+ * @param clock Источник монотонного времени.
+ * @param context Контекст источника времени.
+ */
+void fifo_enable_timestamps(FIFO_Buffer *fifo, FifoTimestamps *timestamps, MonotonicClockFn clock, void *context);
+
+/**
+ * @brief Включает пробуждение потребителя по уровню заполнения.
+ *
+ * Сначала уровень объединения равен 1: потребитель просыпается, как только
+ * набралось нужное ему число байтов. Если запись и разбор идут в разных
+ * потоках, write_fifo, fifo_commit_write и функции уровня вызываются под
+ * общим мьютексом, а wake лишь сообщает о событии (eventfd, futex,
+ * условная переменная).
+ *
+ * @param fifo Указатель на структуру FIFO_Buffer.
+ * @param watermark Состояние уровня (должно жить не меньше буфера) или NULL, чтобы выключить.
+ * @param wake Функция пробуждения.
+ * @param context Контекст функции пробуждения.
+ */
+void fifo_set_watermark(FIFO_Buffer *fifo, FifoWatermark *watermark, FifoWakeFn wake, void *context);
+
+/**
+ * @brief Включает адаптивное объединение пробуждений.
+ *
+ * @param watermark Состояние уровня.
+ * @param min_level Наименьший уровень, байт (не меньше 1).
+ * @param max_level Наибольший уровень, байт (не больше MAX_FIFO_SIZE).
+ * @param target_interval_ns Желаемый наименьший промежуток между пробуждениями.
+ * @param clock Источник монотонного времени.
+ * @param context Контекст источника времени.
+ */
+void fifo_watermark_coalesce(FifoWatermark *watermark, int min_level, int max_level, uint64_t target_interval_ns,
+                             MonotonicClockFn clock, void *context);
+
+/**
+ * @brief Взводит пробуждение перед сном потребителя.
+ *
+ * @param fifo Указатель на структуру FIFO_Buffer.
+ * @param need Байтов, нужных для продвижения разбора (например, parser_bytes_needed).
+ * @return 1, если уровень уже достигнут и засыпать не нужно; иначе 0 (пробуждение взведено).
+ */
+int fifo_watermark_arm(FIFO_Buffer *fifo, int need);
+
+/**
+ * @brief Сообщает, что потребитель проснулся по таймауту, не дождавшись уровня.
+ *
+ * Снимает пробуждение и уменьшает уровень объединения. Таймаут нужен,
+ * только пока в буфере есть данные ниже уровня: с пустым буфером
+ * потребитель может спать без ограничения.
+ *
+ * @param fifo Указатель на структуру FIFO_Buffer.
+ */
+void fifo_watermark_expire(FIFO_Buffer *fifo);
+
+/**
+ * @brief Возвращает время поступления байта в FIFO.
+ *
+ * Заодно забывает отметки, все байты которых уже прочитаны.
+ *
+ * @param fifo Указатель на структуру FIFO_Buffer.
+ * @param index Индекс байта от текущей головы буфера.
+ * @return Время записи, в которой пришёл байт, или 0, если отметки выключены.
+ */
+uint64_t fifo_arrival_time(FIFO_Buffer *fifo, int index);
+
+/**
+ * @brief Создаёт пул сегментов расширения.
+ *
+ * @param pool Указатель на пул.
+ * @param segment_count Число сегментов по FIFO_SEGMENT_SIZE байтов.
+ * @return Возвращает 0 при успехе или -1 при ошибке выделения памяти.
+ */
+int fifo_pool_init(FifoPool *pool, int segment_count);
+
+/**
+ * @brief Освобождает память пула.
+ *
+ * Все FIFO, пользующиеся пулом, должны быть уже опустошены или больше не использоваться.
+ *
+ * @param pool Указатель на пул.
+ */
+void fifo_pool_destroy(FifoPool *pool);
+
+/**
+ * @brief Делает буфер растущим (или снова фиксированным при pool == NULL).
+ *
+ * @param fifo Указатель на структуру FIFO_Buffer.
+ * @param pool Пул сегментов или NULL.
+ * @param max_segments Наибольшее число сегментов у этого буфера (0 - без ограничения),
+ *                     чтобы один канал не забрал весь пул.
+ * @return Возвращает 0 при успехе или -1, если к буферу ещё присоединены сегменты.
+ */
+int fifo_set_pool(FIFO_Buffer *fifo, FifoPool *pool, int max_segments);
+
+/**
+ * @brief Число байтов в буфере вместе с сегментами расширения.
+ *
+ * @param fifo Указатель на структуру FIFO_Buffer.
+ * @return size + overflow_size.
+ */
+int fifo_total_size(const FIFO_Buffer *fifo);
+
+/**
+ * @brief Опустошает буфер и возвращает его сегменты в пул.
+ *
+ * Настройки (пул, отметки времени, пробуждение) сохраняются.
+ *
+ * @param fifo Указатель на структуру FIFO_Buffer.
+ */
+void fifo_reset(FIFO_Buffer *fifo);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,163 @@
+// Растущие FIFO на общем пуле сегментов против FIFO фиксированного размера.
+//
+// Сотни портов получают один и тот же поток пакетов: в каждом такте порт
+// принимает немного фонового трафика, а изредка - всплеск больше кольца
+// FIFO. Разбор всех портов идёт раз в такт, после записи, поэтому всплеск
+// должен целиком уместиться в буфере. Фиксированный FIFO теряет
+// непоместившиеся порции (как при переполнении приёмника UART), растущий
+// берёт сегменты из общего пула и возвращает их при разборе. Печатаются
+// отказы записи, принятые пакеты, пик занятых сегментов и память против
+// статического размера буфера под худший всплеск на каждом порту.
+//
+// Использование: fifo_pool_demo [ports] [pool_segments]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "parser.h"
+
+#define STREAM_PACKETS 400
+#define BURST_CHANCE 32                // всплеск в среднем раз в 32 такта на порт
+#define BURST_MAX (3 * MAX_FIFO_SIZE)  // наибольший всплеск за такт
+#define QUIET_BYTES 48                 // фоновый трафик за такт
+#define CHUNK 64                       // запись порциями, как из драйвера
+
+typedef struct {
+    FIFO_Buffer fifo;
+    Parser parser;
+    size_t offset;
+    unsigned long long packets;
+} Port;
+
+typedef struct {
+    unsigned long long failed_writes;
+    unsigned long long lost_bytes;
+    unsigned long long packets;
+    int ticks;
+} Result;
+
+static unsigned int next_random(unsigned int *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+static void count_packet(void *context, unsigned int type, unsigned char *data, unsigned int size) {
+    (void)type;
+    (void)data;
+    (void)size;
+    ((Port *)context)->packets++;
+}
+
+// Типы и размеры меньше 128: контрольная сумма parse_uart учитывает только младшие байты полей
+static unsigned char *make_stream(size_t *length) {
+    unsigned char *stream = malloc((size_t)STREAM_PACKETS * (SYNC_SEQUENCE_LENGTH + MAX_HEADER_SIZE + 128 + 1));
+    unsigned char body[128];
+    memset(body, 0x5A, sizeof(body));
+    *length = 0;
+    for (int i = 0; i < STREAM_PACKETS; i++) {
+        unsigned int packet_length;
+        build_packet(stream + *length, &packet_length, 16 + (unsigned int)(i * 37) % 100, (unsigned int)i % 100, body);
+        *length += packet_length;
+        stream[(*length)++] = 0x00; // parse_uart дочитывает байт после тела
+    }
+    return stream;
+}
+
+// pool == NULL - фиксированные FIFO
+static Result run(Port *ports, int port_count, FifoPool *pool, const unsigned char *stream, size_t length) {
+    Result result = {0, 0, 0, 0};
+    unsigned int seed = 0x2545F491u;
+    int active = port_count;
+    for (int p = 0; p < port_count; p++) {
+        init_fifo(&ports[p].fifo);
+        if (pool != NULL) {
+            fifo_set_pool(&ports[p].fifo, pool, 0);
+        }
+        init_parser(&ports[p].parser, &ports[p].fifo, NULL);
+        parser_set_handler(&ports[p].parser, count_packet, &ports[p]);
+        parser_set_event_sink(&ports[p].parser, NULL, NULL);
+        ports[p].offset = 0;
+        ports[p].packets = 0;
+    }
+    while (active > 0) {
+        for (int p = 0; p < port_count; p++) {
+            Port *port = &ports[p];
+            size_t burst = next_random(&seed) % BURST_CHANCE == 0
+                               ? MAX_FIFO_SIZE + next_random(&seed) % (BURST_MAX - MAX_FIFO_SIZE + 1)
+                               : QUIET_BYTES;
+            if (port->offset == length) {
+                continue;
+            }
+            if (burst > length - port->offset) {
+                burst = length - port->offset;
+            }
+            for (size_t done = 0; done < burst; done += CHUNK) {
+                int chunk = burst - done < CHUNK ? (int)(burst - done) : CHUNK;
+                if (write_fifo(&port->fifo, stream + port->offset + done, chunk) != 0) {
+                    // Приёмник переполнен: порция пропадает, поток идёт дальше
+                    result.failed_writes++;
+                    result.lost_bytes += (unsigned long long)chunk;
+                }
+            }
+            port->offset += burst;
+            if (port->offset == length) {
+                active--;
+            }
+        }
+        for (int p = 0; p < port_count; p++) {
+            parse_uart(&ports[p].parser);
+        }
+        result.ticks++;
+    }
+    for (int p = 0; p < port_count; p++) {
+        result.packets += ports[p].packets;
+    }
+    return result;
+}
+
+int main(int argc, char **argv) {
+    int port_count = argc > 1 ? atoi(argv[1]) : 256;
+    int segment_count = argc > 2 ? atoi(argv[2]) : port_count * 2;
+    size_t length;
+    unsigned char *stream = make_stream(&length);
+    unsigned long long expected = (unsigned long long)port_count * STREAM_PACKETS;
+    Port *ports = calloc((size_t)port_count, sizeof(Port));
+    FifoPool pool;
+    Result fixed;
+    Result growable;
+    int failed;
+    if (port_count <= 0 || ports == NULL || fifo_pool_init(&pool, segment_count) != 0) {
+        fprintf(stderr, "invalid arguments or out of memory\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("%d ports x %d packets (%zu bytes), bursts up to %d bytes, %d-byte FIFO ring, %d-byte segments\n",
+           port_count, STREAM_PACKETS, length, BURST_MAX, MAX_FIFO_SIZE, FIFO_SEGMENT_SIZE);
+    fixed = run(ports, port_count, NULL, stream, length);
+    growable = run(ports, port_count, &pool, stream, length);
+
+    printf("%-9s %8s %12s %12s %10s %10s\n", "mode", "ticks", "failed", "lost bytes", "packets", "expected");
+    printf("%-9s %8d %12llu %12llu %10llu %10llu\n", "fixed", fixed.ticks, fixed.failed_writes, fixed.lost_bytes,
+           fixed.packets, expected);
+    printf("%-9s %8d %12llu %12llu %10llu %10llu\n", "growable", growable.ticks, growable.failed_writes,
+           growable.lost_bytes, growable.packets, expected);
+    printf("pool: %d segments, peak %d in use, %llu refused\n", pool.segment_count, pool.peak_in_use,
+           (unsigned long long)pool.exhausted);
+    printf("memory: rings %zu KiB + pool peak %zu KiB (allocated %zu KiB); static sizing for the worst burst %zu KiB\n",
+           (size_t)port_count * MAX_FIFO_SIZE / 1024, (size_t)pool.peak_in_use * sizeof(FifoSegment) / 1024,
+           (size_t)pool.segment_count * sizeof(FifoSegment) / 1024,
+           (size_t)port_count * (MAX_FIFO_SIZE + BURST_MAX) / 1024);
+
+    failed = growable.failed_writes != 0 || growable.packets != expected || pool.in_use != 0;
+    fifo_pool_destroy(&pool);
+    free(ports);
+    free(stream);
+    if (failed) {
+        fprintf(stderr, "FAILED: growable FIFOs lost data\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,153 @@
+// Задержка управляющих пакетов за всплесками телеметрии в конвейере
+// (pipeline.h): одна общая полоса против классов приоритета.
+//
+// Поток состоит из всплесков крупной телеметрии (типы 16..31) с редкими
+// короткими управляющими пакетами (тип 1) между ними. Обработчик телеметрии
+// тяжёлый, управляющего - лёгкий. Для каждой полосы печатается время от
+// разбора пакета до выдачи его обработчику: с одной полосой управляющие
+// пакеты ждут всю очередь телеметрии, с приоритетами - только текущий пакет.
+//
+// Использование: lane_bench [workers] [bursts] [work]
+//   work - итераций вычислений в обработчике на пакет телеметрии
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "monotonic_clock.h"
+#include "pipeline.h"
+
+#define CONTROL_TYPE 1
+#define BURST_PACKETS 64   // пакетов телеметрии во всплеске
+#define CONTROL_PER_BURST 4
+
+typedef struct {
+    const unsigned char *data;
+    size_t length;
+    size_t offset;
+} StreamSource;
+
+typedef struct {
+    unsigned int work;
+    volatile uint64_t sink;
+} BenchHandler;
+
+static uint8_t g_priority[PARSER_TYPE_COUNT];
+
+static int stream_read(void *context, unsigned char *buffer, int capacity) {
+    StreamSource *source = (StreamSource *)context;
+    size_t length = source->length - source->offset;
+    if (length == 0) {
+        return -1;
+    }
+    if (length > (size_t)capacity) {
+        length = (size_t)capacity;
+    }
+    memcpy(buffer, source->data + source->offset, length);
+    source->offset += length;
+    return (int)length;
+}
+
+static void bench_packet(void *context, unsigned int type, unsigned char *data, unsigned int size) {
+    BenchHandler *handler = (BenchHandler *)context;
+    uint64_t x = type;
+    unsigned int rounds = type == CONTROL_TYPE ? 1 : handler->work;
+    for (unsigned int i = 0; i < rounds; i++) {
+        x = x * 6364136223846793005ull + data[i % size];
+    }
+    handler->sink = x;
+}
+
+// Управляющие пакеты равномерно вкраплены во всплеск телеметрии. Типы и
+// размеры меньше 128: контрольная сумма parse_uart учитывает только младшие байты полей
+static unsigned char *make_stream(int bursts, size_t *length, unsigned long long *control) {
+    size_t packet_max = SYNC_SEQUENCE_LENGTH + MAX_HEADER_SIZE + 128 + 1;
+    unsigned char *stream = malloc((size_t)bursts * (BURST_PACKETS + CONTROL_PER_BURST) * packet_max);
+    unsigned char body[128];
+    *length = 0;
+    *control = 0;
+    memset(body, 0x5A, sizeof(body));
+    for (int burst = 0; burst < bursts; burst++) {
+        for (int i = 0; i < BURST_PACKETS; i++) {
+            unsigned int packet_length;
+            if (i % (BURST_PACKETS / CONTROL_PER_BURST) == 0) {
+                build_packet(stream + *length, &packet_length, 8, CONTROL_TYPE, body);
+                *length += packet_length;
+                stream[(*length)++] = 0x00; // parse_uart дочитывает байт после тела
+                (*control)++;
+            }
+            build_packet(stream + *length, &packet_length, 64 + (unsigned int)i, 16 + (unsigned int)(i % 16),
+                         body);
+            *length += packet_length;
+            stream[(*length)++] = 0x00;
+        }
+    }
+    return stream;
+}
+
+static double run(const unsigned char *stream, size_t length, int workers, int classes, unsigned int work,
+                  PipelineStats *stats) {
+    static Pipeline pipeline;
+    BenchHandler handler = {work, 0};
+    StreamSource source = {stream, length, 0};
+    PipelineConfig config;
+    uint64_t start;
+    pipeline_default_config(&config);
+    config.source = stream_read;
+    config.source_context = &source;
+    config.handler = bench_packet;
+    config.handler_context = &handler;
+    config.worker_count = workers;
+    config.chunk_size = 4096;
+    config.priority_classes = classes;
+    config.type_priority = classes > 1 ? g_priority : NULL;
+    start = monotonic_clock_ns(NULL);
+    if (pipeline_start(&pipeline, &config) != 0) {
+        fprintf(stderr, "pipeline_start failed\n");
+        exit(EXIT_FAILURE);
+    }
+    pipeline_wait(&pipeline);
+    *stats = pipeline.stats;
+    return (double)(monotonic_clock_ns(NULL) - start) * 1e-9;
+}
+
+int main(int argc, char **argv) {
+    int workers = argc > 1 ? atoi(argv[1]) : 2;
+    int bursts = argc > 2 ? atoi(argv[2]) : 500;
+    unsigned int work = argc > 3 ? (unsigned int)atoi(argv[3]) : 20000;
+    unsigned long long control;
+    size_t length;
+    unsigned char *stream = make_stream(bursts, &length, &control);
+    unsigned long long expected = (unsigned long long)bursts * BURST_PACKETS + control;
+    int failed = 0;
+
+    memset(g_priority, 1, sizeof(g_priority));
+    g_priority[CONTROL_TYPE] = 0;
+    printf("%d workers, %llu packets (%llu control), %u iterations per telemetry packet\n", workers, expected,
+           control, work);
+    printf("%-8s %-9s %9s %12s %12s %10s %8s\n", "lanes", "lane", "packets", "avg wait us", "max wait us",
+           "full waits", "grants");
+    for (int classes = 1; classes <= 2; classes++) {
+        PipelineStats stats;
+        double seconds = run(stream, length, workers, classes, work, &stats);
+        for (int lane = 0; lane < classes; lane++) {
+            const PriorityLaneStats *s = &stats.lanes[lane];
+            const char *name = classes == 1 ? "all" : lane == 0 ? "control" : "telemetry";
+            printf("%-8s %-9s %9llu %12.1f %12.1f %10llu %8llu\n", classes == 1 ? "shared" : "priority", name,
+                   (unsigned long long)s->popped,
+                   s->popped > 0 ? (double)s->wait_total_ns / (double)s->popped * 1e-3 : 0.0,
+                   (double)s->wait_max_ns * 1e-3, (unsigned long long)s->full_waits,
+                   (unsigned long long)s->starvation_grants);
+        }
+        printf("%-8s %.0f packets/s\n", "", (double)stats.packets_handled / seconds);
+        if (stats.packets_handled != expected) {
+            failed = 1;
+        }
+    }
+    free(stream);
+    if (failed) {
+        fprintf(stderr, "FAILED: lost packets\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
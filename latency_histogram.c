@@ -0,0 +1,130 @@
+/**
+ * @file latency_histogram.c
+ * @brief Реализация лог-линейной гистограммы задержек.
+ */
+#include "latency_histogram.h"
+#include <string.h>
+
+#define SUB_BITS LATENCY_HISTOGRAM_SUB_BITS
+#define LINEAR_COUNT (1u << SUB_BITS)
+#define HALF_COUNT (1u << (SUB_BITS - 1))
+#define MAX_VALUE ((1ull << LATENCY_HISTOGRAM_MAX_BITS) - 1)
+
+// Номер старшего установленного бита (value > 0)
+static unsigned int highest_bit(uint64_t value) {
+#if defined(__GNUC__)
+    return 63u - (unsigned int)__builtin_clzll(value);
+#else
+    unsigned int bit = 0;
+    while (value >>= 1) {
+        bit++;
+    }
+    return bit;
+#endif
+}
+
+static unsigned int bucket_index(uint64_t value) {
+    if (value < LINEAR_COUNT) {
+        return (unsigned int)value;
+    }
+    unsigned int exponent = highest_bit(value);
+    unsigned int shift = exponent - SUB_BITS + 1;
+    return LINEAR_COUNT + (exponent - SUB_BITS) * HALF_COUNT + (unsigned int)(value >> shift) - HALF_COUNT;
+}
+
+// Наибольшее значение, попадающее в корзину
+static uint64_t bucket_upper_bound(unsigned int index) {
+    if (index < LINEAR_COUNT) {
+        return index;
+    }
+    unsigned int octave = (index - LINEAR_COUNT) / HALF_COUNT;
+    uint64_t sub = (index - LINEAR_COUNT) % HALF_COUNT + HALF_COUNT;
+    unsigned int shift = octave + 1;
+    return ((sub + 1) << shift) - 1;
+}
+
+void latency_histogram_init(LatencyHistogram *histogram) {
+    memset(histogram, 0, sizeof(*histogram));
+    histogram->min = UINT64_MAX;
+}
+
+void latency_histogram_record(LatencyHistogram *histogram, uint64_t value) {
+    if (value > MAX_VALUE) {
+        value = MAX_VALUE;
+    }
+    histogram->counts[bucket_index(value)]++;
+    histogram->total++;
+    histogram->sum += value;
+    if (value < histogram->min) {
+        histogram->min = value;
+    }
+    if (value > histogram->max) {
+        histogram->max = value;
+    }
+}
+
+void latency_histogram_merge(LatencyHistogram *destination, const LatencyHistogram *source) {
+    for (unsigned int i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+        destination->counts[i] += source->counts[i];
+    }
+    destination->total += source->total;
+    destination->sum += source->sum;
+    if (source->min < destination->min) {
+        destination->min = source->min;
+    }
+    if (source->max > destination->max) {
+        destination->max = source->max;
+    }
+}
+
+uint64_t latency_histogram_percentile(const LatencyHistogram *histogram, double percentile) {
+    if (histogram->total == 0) {
+        return 0;
+    }
+    if (percentile < 0.0) {
+        percentile = 0.0;
+    }
+    if (percentile > 100.0) {
+        percentile = 100.0;
+    }
+    uint64_t rank = (uint64_t)(percentile / 100.0 * (double)histogram->total + 0.5);
+    if (rank == 0) {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (unsigned int i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+        seen += histogram->counts[i];
+        if (seen >= rank) {
+            uint64_t upper = bucket_upper_bound(i);
+            return upper < histogram->max ? upper : histogram->max;
+        }
+    }
+    return histogram->max;
+}
+
+void latency_histogram_dump(const LatencyHistogram *histogram, const char *name, FILE *out) {
+    static const double percentiles[] = {50.0, 90.0, 99.0, 99.9, 99.99, 100.0};
+
+    fprintf(out, "# %s: count=%llu", name, (unsigned long long)histogram->total);
+    if (histogram->total == 0) {
+        fprintf(out, "\n");
+        return;
+    }
+    fprintf(out, " min=%llu mean=%.1f max=%llu (ns)\n", (unsigned long long)histogram->min,
+            (double)histogram->sum / (double)histogram->total, (unsigned long long)histogram->max);
+    for (size_t i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); i++) {
+        fprintf(out, "#   p%-6g %llu\n", percentiles[i],
+                (unsigned long long)latency_histogram_percentile(histogram, percentiles[i]));
+    }
+
+    fprintf(out, "#   %14s %12s %12s\n", "value(ns)", "percentile", "count");
+    uint64_t seen = 0;
+    for (unsigned int i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+        if (histogram->counts[i] == 0) {
+            continue;
+        }
+        seen += histogram->counts[i];
+        fprintf(out, "    %14llu %12.6f %12llu\n", (unsigned long long)bucket_upper_bound(i),
+                (double)seen / (double)histogram->total, (unsigned long long)histogram->counts[i]);
+    }
+}
@@ -0,0 +1,91 @@
+/**
+ * @file latency_histogram.h
+ * @brief Гистограмма задержек с лог-линейными корзинами (в духе HdrHistogram).
+ *
+ * Значения меньше 2^LATENCY_HISTOGRAM_SUB_BITS хранятся точно, каждая
+ * следующая октава [2^e, 2^(e+1)) делится на 2^(LATENCY_HISTOGRAM_SUB_BITS-1)
+ * равных корзин. Относительная погрешность не превышает 2^-(SUB_BITS-1),
+ * запись значения - несколько битовых операций без ветвлений по данным.
+ */
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef LATENCY_HISTOGRAM_SUB_BITS
+#define LATENCY_HISTOGRAM_SUB_BITS 6   /**< Точность: 32 корзины на октаву (~3%) */
+#endif
+
+#ifndef LATENCY_HISTOGRAM_MAX_BITS
+#define LATENCY_HISTOGRAM_MAX_BITS 36  /**< Верхняя граница значений 2^36 нс (~68 с), большие значения обрезаются */
+#endif
+
+#define LATENCY_HISTOGRAM_BUCKETS \
+    ((1 << LATENCY_HISTOGRAM_SUB_BITS) + \
+     (LATENCY_HISTOGRAM_MAX_BITS - LATENCY_HISTOGRAM_SUB_BITS) * (1 << (LATENCY_HISTOGRAM_SUB_BITS - 1))) /**< Число корзин */
+
+/**
+ * @struct LatencyHistogram
+ * @brief Гистограмма значений в наносекундах.
+ */
+typedef struct {
+    uint64_t counts[LATENCY_HISTOGRAM_BUCKETS]; /**< Счётчики корзин */
+    uint64_t total;                             /**< Число записанных значений */
+    uint64_t min;                               /**< Минимальное значение */
+    uint64_t max;                               /**< Максимальное значение */
+    uint64_t sum;                               /**< Сумма значений (для среднего) */
+} LatencyHistogram;
+
+/**
+ * @brief Очищает гистограмму.
+ *
+ * @param histogram Указатель на гистограмму.
+ */
+void latency_histogram_init(LatencyHistogram *histogram);
+
+/**
+ * @brief Записывает одно значение.
+ *
+ * @param histogram Указатель на гистограмму.
+ * @param value Значение в наносекундах.
+ */
+void latency_histogram_record(LatencyHistogram *histogram, uint64_t value);
+
+/**
+ * @brief Добавляет содержимое одной гистограммы к другой.
+ *
+ * @param destination Гистограмма-приёмник.
+ * @param source Гистограмма-источник.
+ */
+void latency_histogram_merge(LatencyHistogram *destination, const LatencyHistogram *source);
+
+/**
+ * @brief Возвращает значение заданного процентиля.
+ *
+ * @param histogram Указатель на гистограмму.
+ * @param percentile Процентиль от 0 до 100.
+ * @return Верхняя граница корзины, в которую попадает процентиль, или 0 для пустой гистограммы.
+ */
+uint64_t latency_histogram_percentile(const LatencyHistogram *histogram, double percentile);
+
+/**
+ * @brief Печатает сводку и распределение по процентилям.
+ *
+ * Формат близок к выводу HdrHistogram: строки "значение процентиль количество".
+ *
+ * @param histogram Указатель на гистограмму.
+ * @param name Название гистограммы для заголовка.
+ * @param out Поток вывода.
+ */
+void latency_histogram_dump(const LatencyHistogram *histogram, const char *name, FILE *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LATENCY_HISTOGRAM_H
@@ -3,6 +3,10 @@
 #include <string.h>
 #include "parser.h"
 
+// Watermark wake-up: the writer only flags the consumer, parsing happens in the main loop
+static void mark_ready(void *context) {
+    *(int *)context = 1;
+}
 
 // Main Function with Test Cases
 int main() {
@@ -14,6 +18,19 @@ int main() {
     Parser parser;
     init_parser(&parser, &fifo, packet_received_callback);
 
+    // Trace sync-to-callback latency with the system monotonic clock
+    static FifoTimestamps fifo_timestamps;
+    static ParserLatency latency;
+    fifo_enable_timestamps(&fifo, &fifo_timestamps, monotonic_clock_ns, NULL);
+    parser_latency_init(&latency, monotonic_clock_ns, NULL);
+    parser_set_latency(&parser, &latency);
+
+    // Parse only when enough bytes for a header or the rest of the body are buffered
+    static FifoWatermark watermark;
+    int ready = 0;
+    fifo_set_watermark(&fifo, &watermark, mark_ready, &ready);
+    fifo_watermark_arm(&fifo, parser_bytes_needed(&parser));
+
     // Example Data to Send
     unsigned char data1[] = {0x10, 0x20, 0x30, 0x40};
     unsigned char data2[] = {0x50, 0x60};
@@ -59,8 +76,15 @@ int main() {
         write_fifo(&fifo, &stream[current_pos], chunk_size);
         current_pos += chunk_size;
 
-        // Parse the current FIFO content
-        parse_uart(&parser);
+        // Parse the current FIFO content once the watermark fired, then re-arm it
+        while (ready) {
+            ready = 0;
+            parse_uart(&parser);
+            ready = fifo_watermark_arm(&fifo, parser_bytes_needed(&parser));
+        }
+
+        // Print what the parser reported (outside of the parsing path)
+        parser_event_ring_drain(parser_event_default_ring(), stdout);
     }
 
     // Write any remaining data
@@ -71,8 +95,23 @@ int main() {
         current_pos += remaining;
 
         // Final parse
-        parse_uart(&parser);
+        while (ready) {
+            ready = 0;
+            parse_uart(&parser);
+            ready = fifo_watermark_arm(&fifo, parser_bytes_needed(&parser));
+        }
+        parser_event_ring_drain(parser_event_default_ring(), stdout);
     }
 
+    // Parser statistics
+    ParserStats stats;
+    parser_stats_snapshot(&parser, &stats);
+    printf("Stats: delivered %llu packets (%llu bytes), sync hunt %llu bytes, resyncs %llu, checksum errors %llu, oversize %llu\n",
+           (unsigned long long)stats.packets_delivered, (unsigned long long)stats.bytes_delivered,
+           (unsigned long long)stats.sync_hunt_bytes, (unsigned long long)stats.resync_events,
+           (unsigned long long)stats.checksum_failures, (unsigned long long)stats.oversize_drops);
+    printf("Watermark wake-ups: %llu for %d writes\n", (unsigned long long)watermark.wakeups, num_chunks);
+    parser_latency_dump(&latency, stdout);
+
     return 0;
 }
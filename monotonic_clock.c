@@ -0,0 +1,30 @@
+/**
+ * @file monotonic_clock.c
+ * @brief Реализация системных монотонных часов.
+ */
+#include "monotonic_clock.h"
+
+#ifdef _WIN32
+#include <windows.h>
+
+uint64_t monotonic_clock_ns(void *context) {
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    (void)context;
+    if (frequency.QuadPart == 0) {
+        QueryPerformanceFrequency(&frequency);
+    }
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)(counter.QuadPart / frequency.QuadPart) * 1000000000ull +
+           (uint64_t)(counter.QuadPart % frequency.QuadPart) * 1000000000ull / (uint64_t)frequency.QuadPart;
+}
+#else
+#include <time.h>
+
+uint64_t monotonic_clock_ns(void *context) {
+    struct timespec ts;
+    (void)context;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+#endif
@@ -0,0 +1,38 @@
+/**
+ * @file monotonic_clock.h
+ * @brief Подключаемый источник монотонного времени.
+ *
+ * Компоненты, которым нужно время (трассировка задержек, таймауты),
+ * принимают пару "функция + контекст", чтобы в тестах и на встраиваемых
+ * целях можно было подставить собственные часы.
+ */
+#ifndef MONOTONIC_CLOCK_H
+#define MONOTONIC_CLOCK_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Тип функции, возвращающей монотонное время в наносекундах.
+ *
+ * @param context Контекст, переданный вместе с функцией.
+ * @return Текущее время в наносекундах от произвольной точки отсчёта.
+ */
+typedef uint64_t (*MonotonicClockFn)(void *context);
+
+/**
+ * @brief Системные монотонные часы (CLOCK_MONOTONIC или QueryPerformanceCounter).
+ *
+ * @param context Не используется.
+ * @return Текущее время в наносекундах.
+ */
+uint64_t monotonic_clock_ns(void *context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MONOTONIC_CLOCK_H
@@ -0,0 +1,380 @@
+/**
+ * @file multi_parser.c
+ * @brief Реализация многоканального парсера со структурой массивов.
+ */
+#include "multi_parser.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(MULTI_PARSER_SCALAR) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define MULTI_PARSER_SSE2 1
+#endif
+
+static const unsigned char SYNC_SEQUENCE[SYNC_SEQUENCE_LENGTH] = PARSER_SYNC_SEQUENCE;
+
+// Номер младшего установленного бита (mask != 0)
+static int lowest_bit(unsigned int mask) {
+#if defined(__GNUC__)
+    return __builtin_ctz(mask);
+#else
+    int bit = 0;
+    while ((mask & 1u) == 0) {
+        mask >>= 1;
+        bit++;
+    }
+    return bit;
+#endif
+}
+
+int multi_parser_init(MultiParser *parser, int channel_count, MultiPacketHandler handler, void *context) {
+    size_t lanes;
+    memset(parser, 0, sizeof(*parser));
+    if (channel_count <= 0) {
+        return -1;
+    }
+    lanes = ((size_t)channel_count + MULTI_PARSER_LANES - 1) / MULTI_PARSER_LANES * MULTI_PARSER_LANES;
+    parser->channel_count = channel_count;
+    parser->lane_count = (int)lanes;
+    parser->handler = handler;
+    parser->context = context;
+    parser->fifo = (FIFO_Buffer **)calloc(lanes, sizeof(FIFO_Buffer *));
+    parser->state = (uint8_t *)calloc(lanes, sizeof(uint8_t));
+    parser->sync_pos = (uint8_t *)calloc(lanes, sizeof(uint8_t));
+    parser->checksum = (uint8_t *)calloc(lanes, sizeof(uint8_t));
+    parser->size_length = (uint8_t *)calloc(lanes, sizeof(uint8_t));
+    parser->type_length = (uint8_t *)calloc(lanes, sizeof(uint8_t));
+    parser->data_size = (uint32_t *)calloc(lanes, sizeof(uint32_t));
+    parser->type = (uint32_t *)calloc(lanes, sizeof(uint32_t));
+    parser->body_bytes_read = (uint32_t *)calloc(lanes, sizeof(uint32_t));
+    parser->bodies = (unsigned char *)calloc(lanes, MAX_PACKET_SIZE);
+    parser->packets_delivered = (uint64_t *)calloc(lanes, sizeof(uint64_t));
+    parser->sync_hunt_bytes = (uint64_t *)calloc(lanes, sizeof(uint64_t));
+    parser->resync_events = (uint64_t *)calloc(lanes, sizeof(uint64_t));
+    if (parser->fifo == NULL || parser->state == NULL || parser->sync_pos == NULL || parser->checksum == NULL ||
+        parser->size_length == NULL || parser->type_length == NULL || parser->data_size == NULL ||
+        parser->type == NULL || parser->body_bytes_read == NULL || parser->bodies == NULL ||
+        parser->packets_delivered == NULL || parser->sync_hunt_bytes == NULL || parser->resync_events == NULL) {
+        multi_parser_destroy(parser);
+        return -1;
+    }
+    return 0;
+}
+
+void multi_parser_destroy(MultiParser *parser) {
+    free(parser->fifo);
+    free(parser->state);
+    free(parser->sync_pos);
+    free(parser->checksum);
+    free(parser->size_length);
+    free(parser->type_length);
+    free(parser->data_size);
+    free(parser->type);
+    free(parser->body_bytes_read);
+    free(parser->bodies);
+    free(parser->packets_delivered);
+    free(parser->sync_hunt_bytes);
+    free(parser->resync_events);
+    memset(parser, 0, sizeof(*parser));
+}
+
+int multi_parser_attach(MultiParser *parser, int channel, FIFO_Buffer *fifo) {
+    if (channel < 0 || channel >= parser->channel_count) {
+        return -1;
+    }
+    parser->fifo[channel] = fifo;
+    parser->state[channel] = STATE_SYNC;
+    parser->sync_pos[channel] = 0;
+    parser->checksum[channel] = 0;
+    parser->size_length[channel] = 0;
+    parser->type_length[channel] = 0;
+    parser->data_size[channel] = 0;
+    parser->type[channel] = 0;
+    parser->body_bytes_read[channel] = 0;
+    memset(parser->bodies + (size_t)channel * MAX_PACKET_SIZE, 0, MAX_PACKET_SIZE);
+    return 0;
+}
+
+// Байт FIFO со смещением от головы без вызова peek_fifo
+static inline unsigned char fifo_at(const FIFO_Buffer *fifo, int offset) {
+    return fifo->buffer[(unsigned int)(fifo->head + offset) % MAX_FIFO_SIZE];
+}
+
+// Копирование count байтов со смещения offset с учётом перехода через конец буфера
+static void fifo_copy(const FIFO_Buffer *fifo, int offset, unsigned char *out, int count) {
+    unsigned int start = (unsigned int)(fifo->head + offset) % MAX_FIFO_SIZE;
+    int first = MAX_FIFO_SIZE - (int)start;
+    if (first > count) {
+        first = count;
+    }
+    memcpy(out, &fifo->buffer[start], (size_t)first);
+    memcpy(out + first, fifo->buffer, (size_t)(count - first));
+}
+
+// Сколько байтов с головы не равны первому байту синхропоследовательности
+static int scan_sync_start(const FIFO_Buffer *fifo) {
+    int scanned = 0;
+    while (scanned < fifo->size) {
+        unsigned int start = (unsigned int)(fifo->head + scanned) % MAX_FIFO_SIZE;
+        int run = MAX_FIFO_SIZE - (int)start;
+        const unsigned char *data = &fifo->buffer[start];
+        int i = 0;
+        if (run > fifo->size - scanned) {
+            run = fifo->size - scanned;
+        }
+#ifdef MULTI_PARSER_SSE2
+        {
+            __m128i first = _mm_set1_epi8((char)SYNC_SEQUENCE[0]);
+            for (; i + 16 <= run; i += 16) {
+                unsigned int mask = (unsigned int)_mm_movemask_epi8(
+                    _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(data + i)), first));
+                if (mask != 0) {
+                    return scanned + i + lowest_bit(mask);
+                }
+            }
+        }
+#endif
+        for (; i < run; i++) {
+            if (data[i] == SYNC_SEQUENCE[0]) {
+                return scanned + i;
+            }
+        }
+        scanned += run;
+    }
+    return scanned;
+}
+
+// Поле переменной длины по смещению без извлечения (как в parser.c)
+static int peek_variable_length(const FIFO_Buffer *fifo, int offset, unsigned int *value) {
+    unsigned char byte1;
+    if (offset >= fifo->size) {
+        return 0;
+    }
+    byte1 = fifo_at(fifo, offset);
+    if (byte1 < 128) {
+        *value = byte1;
+        return 1;
+    }
+    if (offset + 1 >= fifo->size) {
+        return 0;
+    }
+    *value = (byte1 - 128u) + ((unsigned int)fifo_at(fifo, offset + 1) << 7);
+    return 2;
+}
+
+// Отвергнутый заголовок или несовпадение: отбросить один байт и искать снова
+static void resync(MultiParser *parser, int channel) {
+    fifo_skip(parser->fifo[channel], 1);
+    parser->sync_hunt_bytes[channel]++;
+    parser->sync_pos[channel] = 0;
+    parser->state[channel] = STATE_SYNC;
+}
+
+static void deliver(MultiParser *parser, int channel) {
+    parser->packets_delivered[channel]++;
+    parser->handler(parser->context, channel, parser->type[channel],
+                    parser->bodies + (size_t)channel * MAX_PACKET_SIZE, parser->body_bytes_read[channel]);
+}
+
+// Завершение синхронизации: переход к заголовку со сброшенными полями
+static void enter_header(MultiParser *parser, int channel) {
+    parser->state[channel] = STATE_HEADER_SIZE;
+    parser->sync_pos[channel] = SYNC_SEQUENCE_LENGTH;
+    parser->data_size[channel] = 0;
+    parser->type[channel] = 0;
+    parser->checksum[channel] = 0;
+    parser->size_length[channel] = 0;
+    parser->type_length[channel] = 0;
+}
+
+// Поиск синхронизации одного канала; 0 - нужно больше данных
+static int step_sync(MultiParser *parser, int channel) {
+    FIFO_Buffer *fifo = parser->fifo[channel];
+    int pos = parser->sync_pos[channel];
+    if (pos == 0) {
+        int skip = scan_sync_start(fifo);
+        if (skip > 0) {
+            fifo_skip(fifo, skip);
+            parser->sync_hunt_bytes[channel] += (uint64_t)skip;
+        }
+        if (fifo->size == 0) {
+            return 0;
+        }
+        pos = 1;
+    }
+    for (; pos < SYNC_SEQUENCE_LENGTH; pos++) {
+        if (pos >= fifo->size) {
+            parser->sync_pos[channel] = (uint8_t)pos;
+            return 0;
+        }
+        if (fifo_at(fifo, pos) != SYNC_SEQUENCE[pos]) {
+            resync(parser, channel);
+            return 1;
+        }
+    }
+    enter_header(parser, channel);
+    return 1;
+}
+
+// Заголовок проверяется целиком просмотром; 0 - нужно больше данных
+static int step_header(MultiParser *parser, int channel) {
+    FIFO_Buffer *fifo = parser->fifo[channel];
+    unsigned int size;
+    unsigned int type;
+    int size_length = peek_variable_length(fifo, SYNC_SEQUENCE_LENGTH, &size);
+    int type_length;
+    int header_length;
+    uint8_t checksum;
+    if (size_length == 0) {
+        return 0;
+    }
+    type_length = peek_variable_length(fifo, SYNC_SEQUENCE_LENGTH + size_length, &type);
+    if (type_length == 0) {
+        return 0;
+    }
+    header_length = SYNC_SEQUENCE_LENGTH + size_length + type_length;
+    if (header_length >= fifo->size) {
+        return 0;
+    }
+    checksum = (uint8_t)((size & 0xFF) + (type & 0xFF));
+    parser->data_size[channel] = size;
+    parser->type[channel] = type;
+    parser->size_length[channel] = (uint8_t)size_length;
+    parser->type_length[channel] = (uint8_t)type_length;
+    parser->checksum[channel] = checksum;
+    if (fifo_at(fifo, header_length) != checksum || size > MAX_PACKET_SIZE) {
+        parser->resync_events[channel]++;
+        resync(parser, channel);
+        return 1;
+    }
+    fifo_skip(fifo, header_length + 1);
+    parser->sync_pos[channel] = 0;
+    parser->body_bytes_read[channel] = 0;
+    if (size == 0) {
+        deliver(parser, channel);
+        parser->state[channel] = STATE_SYNC;
+    } else {
+        parser->state[channel] = STATE_BODY;
+    }
+    return 1;
+}
+
+// Тело с теми же особенностями, что в parse_uart
+static int step_body(MultiParser *parser, int channel) {
+    FIFO_Buffer *fifo = parser->fifo[channel];
+    unsigned char *body = parser->bodies + (size_t)channel * MAX_PACKET_SIZE;
+    int available = fifo->size;
+    int to_read = (int)(parser->data_size[channel] - parser->body_bytes_read[channel]);
+    if (available == 0) {
+        return 0;
+    }
+    if (available >= to_read) {
+        // parse_uart пропускает первый байт; если байтов ровно to_read, последний байт тела повторяется
+        int copied = to_read < available - 1 ? to_read : available - 1;
+        fifo_copy(fifo, 1, body, copied);
+        if (copied < to_read && fifo->overflow_size > 0) {
+            // Кольцо растущего FIFO кончилось на теле: последний байт берётся после переноса сегмента
+            fifo_skip(fifo, available);
+            body[to_read - 1] = fifo_at(fifo, 0);
+            fifo_skip(fifo, 1);
+        } else {
+            if (copied < to_read) {
+                body[to_read - 1] = fifo_at(fifo, available - 1);
+            }
+            fifo_skip(fifo, to_read < available ? to_read + 1 : available);
+        }
+        parser->body_bytes_read[channel] += (uint32_t)to_read;
+        deliver(parser, channel);
+        parser->state[channel] = STATE_SYNC;
+        return 1;
+    }
+    fifo_copy(fifo, 0, body + parser->body_bytes_read[channel], available);
+    fifo_skip(fifo, available);
+    parser->body_bytes_read[channel] += (uint32_t)available;
+    // Растущий FIFO мог перенести в кольцо следующий сегмент
+    return fifo->size > 0;
+}
+
+// Разбор одного канала до исчерпания данных (аналог parse_uart)
+static void run_channel(MultiParser *parser, int channel) {
+    FIFO_Buffer *fifo = parser->fifo[channel];
+    int progress = 1;
+    while (progress && fifo->size > 0) {
+        switch (parser->state[channel]) {
+            case STATE_SYNC:
+                progress = step_sync(parser, channel);
+                break;
+            case STATE_BODY:
+                progress = step_body(parser, channel);
+                break;
+            case STATE_HEADER_SIZE:
+            case STATE_HEADER_TYPE:
+            case STATE_HEADER_CHECKSUM:
+                progress = step_header(parser, channel);
+                break;
+            default:
+                parser->state[channel] = STATE_SYNC;
+                parser->sync_pos[channel] = 0;
+                break;
+        }
+    }
+}
+
+#if defined(MULTI_PARSER_SSE2) && SYNC_SEQUENCE_LENGTH <= 4
+// Синхропоследовательность в начале FIFO проверяется сразу для всей группы:
+// первые байты каналов собираются в 32-битные слова и сравниваются векторно.
+static void match_sync_group(MultiParser *parser, int base) {
+    uint32_t words[MULTI_PARSER_LANES];
+    uint32_t sync_word = 0;
+    uint32_t mask_word = SYNC_SEQUENCE_LENGTH == 4 ? 0xFFFFFFFFu : ((1u << (8 * SYNC_SEQUENCE_LENGTH)) - 1u);
+    unsigned int candidates = 0;
+    unsigned int matched = 0;
+    for (int i = 0; i < SYNC_SEQUENCE_LENGTH; i++) {
+        sync_word |= (uint32_t)SYNC_SEQUENCE[i] << (8 * i);
+    }
+    for (int lane = 0; lane < MULTI_PARSER_LANES; lane++) {
+        int channel = base + lane;
+        const FIFO_Buffer *fifo = parser->fifo[channel];
+        uint32_t word = ~sync_word;
+        if (fifo != NULL && parser->state[channel] == STATE_SYNC && parser->sync_pos[channel] == 0 &&
+            fifo->size >= SYNC_SEQUENCE_LENGTH) {
+            word = 0;
+            for (int i = 0; i < SYNC_SEQUENCE_LENGTH; i++) {
+                word |= (uint32_t)fifo_at(fifo, i) << (8 * i);
+            }
+            candidates |= 1u << lane;
+        }
+        words[lane] = word & mask_word;
+    }
+    if (candidates == 0) {
+        return;
+    }
+    {
+        __m128i expected = _mm_set1_epi32((int)sync_word);
+        for (int quad = 0; quad < MULTI_PARSER_LANES / 4; quad++) {
+            __m128i equal = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)&words[quad * 4]), expected);
+            matched |= (unsigned int)_mm_movemask_ps(_mm_castsi128_ps(equal)) << (quad * 4);
+        }
+    }
+    matched &= candidates;
+    while (matched != 0) {
+        enter_header(parser, base + lowest_bit(matched));
+        matched &= matched - 1;
+    }
+}
+#endif
+
+void multi_parser_poll(MultiParser *parser) {
+    for (int base = 0; base < parser->lane_count; base += MULTI_PARSER_LANES) {
+#if defined(MULTI_PARSER_SSE2) && SYNC_SEQUENCE_LENGTH <= 4
+        match_sync_group(parser, base);
+#endif
+        for (int lane = 0; lane < MULTI_PARSER_LANES; lane++) {
+            int channel = base + lane;
+            if (parser->fifo[channel] != NULL && parser->fifo[channel]->size > 0) {
+                run_channel(parser, channel);
+            }
+        }
+    }
+}
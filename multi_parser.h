@@ -0,0 +1,113 @@
+/**
+ * @file multi_parser.h
+ * @brief Многоканальный парсер с состоянием каналов в виде структуры массивов.
+ *
+ * Для сотен медленных каналов вызов parse_uart по очереди для каждого
+ * Parser обходит много крупных структур ради нескольких байтов. MultiParser
+ * хранит состояние автомата всех каналов в плотных массивах (состояние,
+ * позиция синхронизации, поля заголовка), а тела пакетов - в отдельной
+ * области, которая затрагивается только при приёме тела.
+ *
+ * Каналы обрабатываются группами по MULTI_PARSER_LANES. Сначала для всей
+ * группы одним сравнением векторов (SSE2) проверяется, начинается ли FIFO
+ * каждого канала с синхропоследовательности; затем каждый канал
+ * разбирается скалярно с прямым доступом к буферу FIFO: поиск первого байта
+ * синхронизации - векторным сканированием, заголовок - целиком, тело -
+ * копированием блоками. Без SSE2 (или с MULTI_PARSER_SCALAR) используются
+ * только скалярные циклы. Для каждого канала результат совпадает с
+ * parse_uart на том же FIFO, включая его особенности; события, задержки и
+ * фильтр типов не поддерживаются.
+ */
+#ifndef MULTI_PARSER_H
+#define MULTI_PARSER_H
+
+#include <stdint.h>
+#include "parser.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MULTI_PARSER_LANES 16 /**< Каналов в группе (ширина вектора SSE2 в байтах) */
+
+/**
+ * @brief Обработчик пакета многоканального парсера.
+ *
+ * @param context Контекст, переданный в multi_parser_init.
+ * @param channel Номер канала.
+ * @param type Тип пакета.
+ * @param data Тело пакета (действительно до возврата).
+ * @param size Размер тела.
+ */
+typedef void (*MultiPacketHandler)(void *context, int channel, unsigned int type, unsigned char *data, unsigned int size);
+
+/**
+ * @struct MultiParser
+ * @brief Состояние всех каналов.
+ *
+ * Массивы имеют длину, кратную MULTI_PARSER_LANES.
+ */
+typedef struct {
+    int channel_count;            /**< Число каналов */
+    int lane_count;               /**< Длина массивов (кратна MULTI_PARSER_LANES) */
+    MultiPacketHandler handler;   /**< Обработчик пакетов */
+    void *context;                /**< Контекст обработчика */
+
+    FIFO_Buffer **fifo;           /**< FIFO каналов (NULL - канал не подключён) */
+    uint8_t *state;               /**< Состояние автомата (ParserState) */
+    uint8_t *sync_pos;            /**< Число совпавших байтов синхропоследовательности */
+    uint8_t *checksum;            /**< Вычисленная контрольная сумма заголовка */
+    uint8_t *size_length;         /**< Байтов в поле размера */
+    uint8_t *type_length;         /**< Байтов в поле типа */
+    uint32_t *data_size;          /**< Размер тела */
+    uint32_t *type;               /**< Тип пакета */
+    uint32_t *body_bytes_read;    /**< Принято байтов тела */
+    unsigned char *bodies;        /**< Тела: MAX_PACKET_SIZE байтов на канал */
+
+    uint64_t *packets_delivered;  /**< Пакеты, переданные обработчику */
+    uint64_t *sync_hunt_bytes;    /**< Байты, отброшенные при поиске синхронизации */
+    uint64_t *resync_events;      /**< Отвергнутые заголовки */
+} MultiParser;
+
+/**
+ * @brief Создаёт многоканальный парсер.
+ *
+ * @param parser Указатель на структуру.
+ * @param channel_count Число каналов.
+ * @param handler Обработчик пакетов.
+ * @param context Контекст обработчика.
+ * @return Возвращает 0 при успехе или -1 при ошибке выделения памяти.
+ */
+int multi_parser_init(MultiParser *parser, int channel_count, MultiPacketHandler handler, void *context);
+
+/**
+ * @brief Освобождает память многоканального парсера.
+ *
+ * @param parser Указатель на структуру.
+ */
+void multi_parser_destroy(MultiParser *parser);
+
+/**
+ * @brief Подключает FIFO к каналу и сбрасывает состояние канала.
+ *
+ * @param parser Указатель на структуру.
+ * @param channel Номер канала.
+ * @param fifo FIFO канала или NULL, чтобы отключить канал.
+ * @return Возвращает 0 при успехе или -1, если номер канала вне диапазона.
+ */
+int multi_parser_attach(MultiParser *parser, int channel, FIFO_Buffer *fifo);
+
+/**
+ * @brief Разбирает данные всех каналов.
+ *
+ * Для каждого канала эквивалентно вызову parse_uart для его FIFO.
+ *
+ * @param parser Указатель на структуру.
+ */
+void multi_parser_poll(MultiParser *parser);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MULTI_PARSER_H
@@ -6,14 +6,28 @@
  */
 
 #include "parser.h"
-#include <stdio.h>
 #include <string.h>
-const unsigned char SYNC_SEQUENCE[SYNC_SEQUENCE_LENGTH] = {0xAA, 0xBB, 0xCC};
+
+#if PARSER_PROFILE
+#include "parser_profile.h"
+#define PROFILE_STAGE(stage) parser_profile_mark(stage)
+
+// Profiling stage of the current state machine position
+static inline int profile_stage(const Parser *parser) {
+    return parser->state == STATE_SYNC ? PARSER_PROFILE_SYNC
+         : parser->state == STATE_BODY ? PARSER_PROFILE_BODY : PARSER_PROFILE_HEADER;
+}
+#else
+#define PROFILE_STAGE(stage) ((void)0)
+#endif
+static const unsigned char SYNC_SEQUENCE[SYNC_SEQUENCE_LENGTH] = PARSER_SYNC_SEQUENCE;
 // Инициализация парсера
 void init_parser(Parser *parser, FIFO_Buffer *fifo, PacketCallback callback) {
     parser->state = STATE_SYNC;
     parser->fifo = fifo;
     parser->callback = callback;
+    parser->handler = NULL;
+    parser->handler_context = NULL;
     parser->sync_pos = 0;
     parser->data_size = 0;
     parser->type = 0;
@@ -22,7 +36,138 @@ void init_parser(Parser *parser, FIFO_Buffer *fifo, PacketCallback callback) {
     parser->size_bytes_read = 0;
     parser->type_bytes_read = 0;
     parser->body_bytes_read = 0;
+#if !PARSER_COMPACT
+    // Компактная сборка не обнуляет тело: до первого пакета его содержимое не определено
     memset(parser->body, 0, MAX_PACKET_SIZE);
+#endif
+    memset(&parser->stats, 0, sizeof(parser->stats));
+    parser->event_callback = parser_event_ring_post;
+    parser->event_context = parser_event_default_ring();
+    parser->latency = NULL;
+    parser->type_filter = NULL;
+    parser->timeout_clock = NULL;
+    parser->timeout_context = NULL;
+    parser->timeout_ns = 0;
+    parser->last_arrival = 0;
+    parser->pending_bytes = 0;
+}
+
+// Handler with context
+void parser_set_handler(Parser *parser, PacketHandler handler, void *context) {
+    parser->handler = handler;
+    parser->handler_context = context;
+}
+
+// Event sink setup
+void parser_set_event_sink(Parser *parser, ParserEventCallback callback, void *context) {
+    parser->event_callback = callback;
+    parser->event_context = context;
+}
+
+// Report an error record to the event sink (never blocks)
+static void report_event(Parser *parser, ParserEventCode code) {
+    if (parser->event_callback == NULL) {
+        return;
+    }
+    ParserEvent event;
+    memset(&event, 0, sizeof(event));
+    event.code = code;
+    event.source = parser;
+    event.type = parser->type;
+    event.size = parser->data_size;
+    event.expected = parser->calculated_header_checksum;
+    event.received = parser->header_checksum;
+    parser->event_callback(parser->event_context, &event);
+}
+
+// Latency tracing setup
+void parser_set_latency(Parser *parser, ParserLatency *latency) {
+    parser->latency = latency;
+}
+
+// Inter-byte timeout setup
+void parser_set_timeout(Parser *parser, uint64_t timeout_ns, MonotonicClockFn clock, void *context) {
+    if (timeout_ns == 0) {
+        clock = NULL;
+    }
+    parser->timeout_clock = clock;
+    parser->timeout_context = context;
+    parser->timeout_ns = timeout_ns;
+    parser->pending_bytes = fifo_total_size(parser->fifo);
+    parser->last_arrival = clock != NULL ? clock(context) : 0;
+}
+
+// Type filter setup
+void parser_type_filter_init(ParserTypeFilter *filter, int accept_all) {
+    memset(filter->accept, accept_all ? 0xFF : 0x00, sizeof(filter->accept));
+}
+
+int parser_type_filter_set(ParserTypeFilter *filter, unsigned int type, int accept) {
+    if (type >= PARSER_TYPE_COUNT) {
+        return -1;
+    }
+    if (accept) {
+        filter->accept[type >> 3] |= (uint8_t)(1u << (type & 7));
+    } else {
+        filter->accept[type >> 3] &= (uint8_t)~(1u << (type & 7));
+    }
+    return 0;
+}
+
+int parser_type_filter_accepts(const ParserTypeFilter *filter, unsigned int type) {
+    if (type >= PARSER_TYPE_COUNT) {
+        return 0;
+    }
+    return (filter->accept[type >> 3] >> (type & 7)) & 1;
+}
+
+void parser_set_type_filter(Parser *parser, const ParserTypeFilter *filter) {
+    parser->type_filter = filter;
+}
+
+// Whether the current packet is rejected by the type filter
+static int packet_filtered(const Parser *parser) {
+    return parser->type_filter != NULL && !parser_type_filter_accepts(parser->type_filter, parser->type);
+}
+
+// Count a rejected packet instead of delivering it
+static void drop_filtered(Parser *parser) {
+    parser->stats.packets_filtered++;
+    parser->stats.bytes_filtered += parser->body_bytes_read;
+}
+
+// Remember when the first sync byte of a packet entered the FIFO (it is still at the head)
+static void trace_arrival(Parser *parser) {
+    ParserLatency *latency = parser->latency;
+    if (parser->fifo->timestamps != NULL) {
+        latency->arrival_time = fifo_arrival_time(parser->fifo, 0);
+    } else {
+        latency->arrival_time = latency->clock(latency->clock_context);
+    }
+}
+
+// Count the packet in stats and latency histograms
+static void account_packet(Parser *parser) {
+    unsigned int bucket = parser->type & (PARSER_STATS_TYPE_BUCKETS - 1);
+    if (parser->latency != NULL) {
+        ParserLatency *latency = parser->latency;
+        uint64_t now = latency->clock(latency->clock_context);
+        latency_histogram_record(&latency->header_to_callback, now - latency->header_time);
+        latency_histogram_record(&latency->arrival_to_callback, now - latency->arrival_time);
+    }
+    parser->stats.packets_delivered++;
+    parser->stats.bytes_delivered += parser->body_bytes_read;
+    parser->stats.type_packets[bucket]++;
+    parser->stats.type_bytes[bucket] += parser->body_bytes_read;
+}
+
+// Hand the completed packet to the handler or callback
+static void dispatch_packet(Parser *parser) {
+    if (parser->handler != NULL) {
+        parser->handler(parser->handler_context, parser->type, parser->body, parser->body_bytes_read);
+    } else {
+        parser->callback(parser->type, parser->body, parser->body_bytes_read);
+    }
 }
 
 // Function to decode variable length field (Size or Type)
@@ -50,6 +195,32 @@ int decode_variable_length(FIFO_Buffer *fifo, Parser *parser, unsigned int *valu
     return 0;
 }
 
+// Decode a variable length field at FIFO offset without consuming it; returns its length or 0 if incomplete
+static int peek_variable_length(FIFO_Buffer *fifo, int offset, unsigned int *value) {
+    unsigned char byte1;
+    unsigned char byte2;
+    if (peek_fifo(fifo, offset, &byte1) != 0) {
+        return 0;
+    }
+    if (byte1 < 128) {
+        *value = byte1;
+        return 1;
+    }
+    if (peek_fifo(fifo, offset + 1, &byte2) != 0) {
+        return 0;
+    }
+    *value = (byte1 - 128) + (byte2 << 7);
+    return 2;
+}
+
+// False sync or bad header: drop only the first candidate byte and hunt again from the next one
+static void resync(Parser *parser) {
+    fifo_skip(parser->fifo, 1);
+    parser->stats.sync_hunt_bytes++;
+    parser->sync_pos = 0;
+    parser->state = STATE_SYNC;
+}
+
 // Calculate checksum (sum of bytes modulo 256)
 unsigned char calculate_checksum(unsigned char *data, int length) {
     unsigned int sum = 0;
@@ -60,49 +231,137 @@ unsigned char calculate_checksum(unsigned char *data, int length) {
     return (unsigned char)(sum % 256);
 }
 
-// Parse Function
-void parse_uart(Parser *parser) {
+// Validate the decoded header against its checksum byte; on success consume sync and header and start the body.
+// Returns 1 when a packet without body is complete.
+static int accept_header(Parser *parser, unsigned char checksum) {
+    parser->header_checksum = checksum;
+    if (parser->calculated_header_checksum != parser->header_checksum) {
+        report_event(parser, PARSER_EVENT_CHECKSUM_MISMATCH);
+        parser->stats.checksum_failures++;
+        parser->stats.resync_events++;
+        resync(parser);
+        return 0;
+    }
+    // Check data size limits
+    if (parser->data_size > MAX_PACKET_SIZE) {
+        report_event(parser, PARSER_EVENT_OVERSIZE);
+        parser->stats.oversize_drops++;
+        parser->stats.resync_events++;
+        resync(parser);
+        return 0;
+    }
+    // Header is valid: now consume sync and header
+    fifo_skip(parser->fifo, SYNC_SEQUENCE_LENGTH + parser->size_bytes_read + parser->type_bytes_read + 1);
+    parser->sync_pos = 0;
+    if (parser->latency != NULL) {
+        ParserLatency *latency = parser->latency;
+        latency->header_time = latency->clock(latency->clock_context);
+        latency_histogram_record(&latency->arrival_to_header, latency->header_time - latency->arrival_time);
+    }
+    // Initialize body reading
+    parser->body_bytes_read = 0;
+    if (parser->data_size != 0) {
+        parser->state = STATE_BODY;
+        return 0;
+    }
+    // No body, packet complete
+    parser->state = STATE_SYNC;
+    if (packet_filtered(parser)) {
+        drop_filtered(parser);
+        return 0;
+    }
+    account_packet(parser);
+    return 1;
+}
+
+#if PARSER_FAST_HEADER
+#define HEADER_FIELDS_MAX 5 // two-byte size, two-byte type and checksum
+
+// Decode size and type from a contiguous copy of the header fields; returns the checksum byte.
+// The caller guarantees HEADER_FIELDS_MAX bytes after the sync sequence.
+static unsigned char decode_header(Parser *parser) {
+    const FIFO_Buffer *fifo = parser->fifo;
+    int start = (fifo->head + SYNC_SEQUENCE_LENGTH) % MAX_FIFO_SIZE;
+    const unsigned char *h = &fifo->buffer[start];
+    unsigned char copy[HEADER_FIELDS_MAX];
+    if (start + HEADER_FIELDS_MAX > MAX_FIFO_SIZE) {
+        // Header wraps around the end of the ring
+        int first = MAX_FIFO_SIZE - start;
+        memcpy(copy, h, (size_t)first);
+        memcpy(copy + first, fifo->buffer, (size_t)(HEADER_FIELDS_MAX - first));
+        h = copy;
+    }
+    // A set high bit means a second byte carrying bits 7..14
+    unsigned int size_long = h[0] >> 7;
+    unsigned int size = (h[0] & 0x7Fu) + ((h[1] << 7) & (0u - size_long));
+    const unsigned char *t = h + 1 + size_long;
+    unsigned int type_long = t[0] >> 7;
+    unsigned int type = (t[0] & 0x7Fu) + ((t[1] << 7) & (0u - type_long));
+
+    parser->data_size = size;
+    parser->type = type;
+    parser->size_bytes_read = 1 + (int)size_long;
+    parser->type_bytes_read = 1 + (int)type_long;
+    parser->calculated_header_checksum = (unsigned char)((size & 0xFF) + (type & 0xFF));
+    parser->state = STATE_HEADER_CHECKSUM;
+    return t[1 + type_long];
+}
+#endif
+
+// Run the state machine until a packet is complete (returns 1) or more data is needed (returns 0)
+static int parse_until_packet(Parser *parser) {
     unsigned char byte;
     while (parser->fifo->size > 0) {
+        PROFILE_STAGE(profile_stage(parser));
         switch (parser->state) {
             case STATE_SYNC:
-                // Look for sync sequence
-                if (peek_fifo(parser->fifo, 0, &byte) == 0) {
-                    if (byte == SYNC_SEQUENCE[parser->sync_pos]) {
-                        parser->sync_pos++;
-                        // Remove the byte from FIFO
-                        read_fifo(parser->fifo, &byte);
-                        if (parser->sync_pos == SYNC_SEQUENCE_LENGTH) {
-                            parser->state = STATE_HEADER_SIZE;
-                            parser->sync_pos = 0;
-                            // Reset header fields
-                            parser->data_size = 0;
-                            parser->type = 0;
-                            parser->header_checksum = 0;
-                            parser->calculated_header_checksum = 0;
-                            parser->size_bytes_read = 0;
-                            parser->type_bytes_read = 0;
-                        }
-                    } else {
-                        // Mismatch, reset sync position
-                        parser->sync_pos = 0;
-                        // Remove the byte to prevent infinite loop
-                        read_fifo(parser->fifo, &byte);
+                // Look for sync sequence; matched bytes stay in the FIFO until the header is validated
+                if (peek_fifo(parser->fifo, parser->sync_pos, &byte) != 0) {
+                    // Wait for more data
+                    return 0;
+                }
+                if (byte == SYNC_SEQUENCE[parser->sync_pos]) {
+                    if (parser->sync_pos == 0 && parser->latency != NULL) {
+                        trace_arrival(parser);
                     }
+                    parser->sync_pos++;
+                    if (parser->sync_pos == SYNC_SEQUENCE_LENGTH) {
+                        parser->state = STATE_HEADER_SIZE;
+                        // Reset header fields
+                        parser->data_size = 0;
+                        parser->type = 0;
+                        parser->header_checksum = 0;
+                        parser->calculated_header_checksum = 0;
+                        parser->size_bytes_read = 0;
+                        parser->type_bytes_read = 0;
+                    }
+                } else {
+                    // Mismatch: drop one byte and restart the search right after it
+                    resync(parser);
                 }
                 break;
 
             case STATE_HEADER_SIZE:
             {
+#if PARSER_FAST_HEADER
+                if (parser->fifo->size >= SYNC_SEQUENCE_LENGTH + HEADER_FIELDS_MAX) {
+                    // Whole header is buffered: decode it in one step
+                    if (accept_header(parser, decode_header(parser))) {
+                        return 1;
+                    }
+                    break;
+                }
+#endif
                 unsigned int size;
-                int result = decode_variable_length(parser->fifo, parser, &size);
-                if (result == 0) {
+                int length = peek_variable_length(parser->fifo, SYNC_SEQUENCE_LENGTH, &size);
+                if (length > 0) {
                     parser->data_size = size;
+                    parser->size_bytes_read = length;
                     parser->calculated_header_checksum += (size & 0xFF);
                     parser->state = STATE_HEADER_TYPE;
                 } else {
                     // Wait for more data
-                    return;
+                    return 0;
                 }
             }
                 break;
@@ -110,48 +369,27 @@ void parse_uart(Parser *parser) {
             case STATE_HEADER_TYPE:
             {
                 unsigned int type;
-                int result = decode_variable_length(parser->fifo, parser, &type);
-                if (result == 0) {
+                int length = peek_variable_length(parser->fifo, SYNC_SEQUENCE_LENGTH + parser->size_bytes_read, &type);
+                if (length > 0) {
                     parser->type = type;
+                    parser->type_bytes_read = length;
                     parser->calculated_header_checksum += (type & 0xFF);
                     parser->state = STATE_HEADER_CHECKSUM;
                 } else {
                     // Wait for more data
-                    return;
+                    return 0;
                 }
             }
                 break;
 
             case STATE_HEADER_CHECKSUM:
-                if (read_fifo(parser->fifo, &byte) == 0) {
-                    parser->header_checksum = byte;
-                    unsigned char computed_checksum = calculate_checksum((unsigned char*)&parser->data_size, sizeof(unsigned int));
-                    // Alternatively, use the accumulated checksum
-                    computed_checksum = parser->calculated_header_checksum;
-                    if (computed_checksum == parser->header_checksum) {
-                        // Check data size limits
-                        if (parser->data_size > MAX_PACKET_SIZE) {
-                            printf("Error: Data size exceeds maximum limit.\n");
-                            parser->state = STATE_SYNC;
-                            break;
-                        }
-                        // Initialize body reading
-                        parser->body_bytes_read = 0;
-                        if (parser->data_size == 0) {
-                            // No body, packet complete
-                            parser->callback(parser->type, parser->body, parser->body_bytes_read);
-                            parser->state = STATE_SYNC;
-                        } else {
-                            parser->state = STATE_BODY;
-                        }
-                    } else {
-
-                        printf("Error: Header checksum mismatch. Expected: %02X, Received: %02X\n", computed_checksum, parser->header_checksum);
-                        parser->state = STATE_SYNC;
-                    }
-                } else {
+                if (peek_fifo(parser->fifo, SYNC_SEQUENCE_LENGTH + parser->size_bytes_read + parser->type_bytes_read,
+                              &byte) != 0) {
                     // Wait for more data
-                    return;
+                    return 0;
+                }
+                if (accept_header(parser, byte)) {
+                    return 1;
                 }
                 break;
 
@@ -159,6 +397,24 @@ void parse_uart(Parser *parser) {
             {
                 int bytes_available = parser->fifo->size;
                 int bytes_to_read = parser->data_size - parser->body_bytes_read;
+                if (packet_filtered(parser)) {
+                    // Rejected type: consume exactly what the copy path below would, without copying
+                    if (bytes_available >= bytes_to_read) {
+                        int total = bytes_available + parser->fifo->overflow_size;
+                        fifo_skip(parser->fifo, bytes_to_read + 1 <= total ? bytes_to_read + 1 : total);
+                        parser->body_bytes_read += bytes_to_read;
+                        drop_filtered(parser);
+                        parser->state = STATE_SYNC;
+                        break;
+                    }
+                    fifo_skip(parser->fifo, bytes_available);
+                    parser->body_bytes_read += bytes_available;
+                    // Wait for more data, unless a growable FIFO refilled the ring from its segments
+                    if (parser->fifo->size == 0) {
+                        return 0;
+                    }
+                    break;
+                }
                 if (bytes_available >= bytes_to_read) {
                     // Read all remaining body bytes
                     read_fifo(parser->fifo, &byte); // Just to consume the first byte
@@ -168,8 +424,9 @@ void parse_uart(Parser *parser) {
                     }
                     parser->body_bytes_read += bytes_to_read;
                     // Packet complete
-                    parser->callback(parser->type, parser->body, parser->body_bytes_read);
+                    account_packet(parser);
                     parser->state = STATE_SYNC;
+                    return 1;
                 } else {
                     // Read available bytes
                     for(int i =0; i < bytes_available; i++) {
@@ -177,13 +434,18 @@ void parse_uart(Parser *parser) {
                         if (parser->body_bytes_read < MAX_PACKET_SIZE) {
                             parser->body[parser->body_bytes_read++] = byte;
                         } else {
-                            printf("Error: Body buffer overflow.\n");
+                            report_event(parser, PARSER_EVENT_BODY_OVERFLOW);
+                            parser->stats.body_overflows++;
+                            parser->stats.resync_events++;
                             parser->state = STATE_SYNC;
                             break;
                         }
                     }
-                    // Wait for more data
-                    return;
+                    // Wait for more data, unless a growable FIFO refilled the ring from its segments
+                    if (parser->fifo->size == 0) {
+                        return 0;
+                    }
+                    break;
                 }
             }
                 break;
@@ -194,6 +456,245 @@ void parse_uart(Parser *parser) {
                 break;
         }
     }
+    return 0;
+}
+
+// Abandon a stalled partial packet once the gap since the last new bytes exceeds the timeout.
+// Bytes written after the previous parse are new; older ones still in the FIFO belong to the partial packet.
+static int check_gap(Parser *parser) {
+    uint64_t now = parser->timeout_clock(parser->timeout_context);
+    int abandoned = 0;
+    if ((parser->state != STATE_SYNC || parser->sync_pos > 0) && now - parser->last_arrival > parser->timeout_ns) {
+        int buffered = fifo_total_size(parser->fifo);
+        int stale = parser->pending_bytes < buffered ? parser->pending_bytes : buffered;
+        report_event(parser, PARSER_EVENT_TIMEOUT);
+        parser->stats.timeouts++;
+        parser->stats.resync_events++;
+        parser->stats.sync_hunt_bytes += (uint64_t)stale;
+        fifo_skip(parser->fifo, stale);
+        parser->sync_pos = 0;
+        parser->body_bytes_read = 0;
+        parser->state = STATE_SYNC;
+        parser->pending_bytes = 0;
+        abandoned = 1;
+    }
+    if (fifo_total_size(parser->fifo) > parser->pending_bytes) {
+        parser->last_arrival = now;
+    }
+    return abandoned;
+}
+
+// Parse Function
+void parse_uart(Parser *parser) {
+#if PARSER_PROFILE
+    int profile_owner = parser_profile_begin(PARSER_PROFILE_CALL_PARSE, profile_stage(parser));
+#endif
+    if (parser->timeout_clock != NULL) {
+        check_gap(parser);
+    }
+    while (parse_until_packet(parser)) {
+        PROFILE_STAGE(PARSER_PROFILE_CALLBACK);
+        dispatch_packet(parser);
+    }
+    parser->pending_bytes = fifo_total_size(parser->fifo);
+#if PARSER_PROFILE
+    parser_profile_end(profile_owner);
+#endif
+}
+
+// Pull-style parsing: the packet stays in parser->body until the next call
+int parser_next_packet(Parser *parser, PacketView *view) {
+    int complete;
+#if PARSER_PROFILE
+    int profile_owner = parser_profile_begin(PARSER_PROFILE_CALL_PARSE, profile_stage(parser));
+#endif
+    if (parser->timeout_clock != NULL) {
+        check_gap(parser);
+    }
+    complete = parse_until_packet(parser);
+    parser->pending_bytes = fifo_total_size(parser->fifo);
+#if PARSER_PROFILE
+    parser_profile_end(profile_owner);
+#endif
+    if (!complete) {
+        return 0;
+    }
+    view->type = parser->type;
+    view->data = parser->body;
+    view->size = parser->body_bytes_read;
+    return 1;
+}
+
+// Bytes the FIFO must hold before parsing can make progress: a minimal header (one-byte size and type
+// plus checksum) after the sync sequence, or the rest of the body plus the byte consumed after it
+int parser_bytes_needed(const Parser *parser) {
+    int needed;
+    switch (parser->state) {
+        case STATE_HEADER_TYPE:
+            needed = SYNC_SEQUENCE_LENGTH + parser->size_bytes_read + 2;
+            break;
+        case STATE_HEADER_CHECKSUM:
+            needed = SYNC_SEQUENCE_LENGTH + parser->size_bytes_read + parser->type_bytes_read + 1;
+            break;
+        case STATE_BODY:
+            needed = parser->data_size - parser->body_bytes_read + 1;
+            break;
+        default:
+            needed = SYNC_SEQUENCE_LENGTH + 3;
+            break;
+    }
+    return needed < MAX_FIFO_SIZE ? needed : MAX_FIFO_SIZE;
+}
+
+// Timeout check for idle links
+int parser_tick(Parser *parser) {
+    if (parser->timeout_clock == NULL) {
+        return 0;
+    }
+    return check_gap(parser);
+}
+
+// Statistics snapshot
+void parser_stats_snapshot(const Parser *parser, ParserStats *out) {
+    *out = parser->stats;
+}
+
+// Statistics reset
+void parser_stats_reset(Parser *parser) {
+    memset(&parser->stats, 0, sizeof(parser->stats));
+}
+
+// Checkpoint helpers: little-endian fields and CRC-32 (IEEE, reflected)
+static void put_u32(unsigned char *out, uint32_t value) {
+    out[0] = (unsigned char)value;
+    out[1] = (unsigned char)(value >> 8);
+    out[2] = (unsigned char)(value >> 16);
+    out[3] = (unsigned char)(value >> 24);
+}
+
+static uint32_t get_u32(const unsigned char *in) {
+    return (uint32_t)in[0] | (uint32_t)in[1] << 8 | (uint32_t)in[2] << 16 | (uint32_t)in[3] << 24;
+}
+
+static uint32_t checkpoint_crc(uint32_t crc, const unsigned char *data, size_t length) {
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+    return ~crc;
+}
+
+// Protocol signature: a snapshot is only valid for the same sync sequence and header limit
+static uint32_t checkpoint_config(void) {
+    static const unsigned char sync[SYNC_SEQUENCE_LENGTH] = PARSER_SYNC_SEQUENCE;
+    unsigned char header = MAX_HEADER_SIZE;
+    return checkpoint_crc(checkpoint_crc(0, sync, sizeof(sync)), &header, 1);
+}
+
+// Only the received part of the current body is saved (up to data_size, which covers the shifted tail)
+static size_t checkpoint_body_length(const Parser *parser) {
+    return parser->state == STATE_BODY ? (size_t)parser->data_size : 0;
+}
+
+size_t parser_checkpoint_size(const Parser *parser) {
+    return PARSER_CHECKPOINT_HEADER_SIZE + checkpoint_body_length(parser) + (size_t)parser->fifo->size + 4;
+}
+
+// Checkpoint layout: magic, version, flags, config, small fields, data_size, type, body_bytes_read,
+// body length, FIFO length, body, FIFO bytes from the read position, CRC-32 of everything before it
+int parser_checkpoint_save(const Parser *parser, unsigned char *blob, size_t capacity, size_t *length) {
+    size_t body_length = checkpoint_body_length(parser);
+    size_t total = parser_checkpoint_size(parser);
+    unsigned char *out = blob + PARSER_CHECKPOINT_HEADER_SIZE;
+    // Segments of a growable FIFO are not part of the format; parse_uart always drains them
+    if (capacity < total || parser->fifo->overflow != NULL) {
+        return -1;
+    }
+    put_u32(blob, PARSER_CHECKPOINT_MAGIC);
+    blob[4] = (unsigned char)PARSER_CHECKPOINT_VERSION;
+    blob[5] = 0;
+    blob[6] = 0;
+    blob[7] = 0;
+    put_u32(blob + 8, checkpoint_config());
+    blob[12] = (unsigned char)parser->state;
+    blob[13] = (unsigned char)parser->sync_pos;
+    blob[14] = (unsigned char)parser->size_bytes_read;
+    blob[15] = (unsigned char)parser->type_bytes_read;
+    blob[16] = parser->header_checksum;
+    blob[17] = parser->calculated_header_checksum;
+    blob[18] = 0;
+    blob[19] = 0;
+    put_u32(blob + 20, parser->data_size);
+    put_u32(blob + 24, parser->type);
+    put_u32(blob + 28, parser->body_bytes_read);
+    put_u32(blob + 32, (uint32_t)body_length);
+    put_u32(blob + 36, (uint32_t)parser->fifo->size);
+    memcpy(out, parser->body, body_length);
+    out += body_length;
+    for (int i = 0; i < parser->fifo->size; i++) {
+        peek_fifo(parser->fifo, i, out++);
+    }
+    put_u32(out, checkpoint_crc(0, blob, total - 4));
+    *length = total;
+    return 0;
+}
+
+int parser_checkpoint_restore(Parser *parser, const unsigned char *blob, size_t length) {
+    FIFO_Buffer *fifo = parser->fifo;
+    FifoTimestamps *timestamps = fifo->timestamps;
+    FifoWatermark *watermark = fifo->watermark;
+    uint32_t state;
+    uint32_t data_size;
+    uint32_t body_read;
+    uint32_t body_length;
+    uint32_t fifo_length;
+    if (length < PARSER_CHECKPOINT_HEADER_SIZE + 4 || get_u32(blob) != PARSER_CHECKPOINT_MAGIC ||
+        blob[4] != PARSER_CHECKPOINT_VERSION || get_u32(blob + 8) != checkpoint_config()) {
+        return -1;
+    }
+    state = blob[12];
+    data_size = get_u32(blob + 20);
+    body_read = get_u32(blob + 28);
+    body_length = get_u32(blob + 32);
+    fifo_length = get_u32(blob + 36);
+    if (state > STATE_BODY || blob[13] >= SYNC_SEQUENCE_LENGTH + (state != STATE_SYNC) ||
+        blob[14] > MAX_HEADER_SIZE || blob[15] > MAX_HEADER_SIZE || data_size >= PARSER_TYPE_COUNT ||
+        get_u32(blob + 24) >= PARSER_TYPE_COUNT || body_read > MAX_PACKET_SIZE || fifo_length > MAX_FIFO_SIZE ||
+        // Body fields are only meaningful inside a packet; elsewhere they keep the previous packet's values
+        (state == STATE_BODY ? data_size > MAX_PACKET_SIZE || body_read > data_size || body_length != data_size
+                             : body_length != 0) ||
+        length != (size_t)PARSER_CHECKPOINT_HEADER_SIZE + body_length + fifo_length + 4 ||
+        get_u32(blob + length - 4) != checkpoint_crc(0, blob, length - 4)) {
+        return -1;
+    }
+
+    parser->state = (ParserStateField)state;
+    parser->sync_pos = blob[13];
+    parser->size_bytes_read = blob[14];
+    parser->type_bytes_read = blob[15];
+    parser->header_checksum = blob[16];
+    parser->calculated_header_checksum = blob[17];
+    parser->data_size = (ParserFieldValue)data_size;
+    parser->type = (ParserFieldValue)get_u32(blob + 24);
+    parser->body_bytes_read = (ParserFieldValue)body_read;
+    memcpy(parser->body, blob + PARSER_CHECKPOINT_HEADER_SIZE, body_length);
+
+    fifo_reset(fifo);
+    fifo->timestamps = NULL;
+    fifo->watermark = NULL;
+    write_fifo(fifo, blob + PARSER_CHECKPOINT_HEADER_SIZE + body_length, (int)fifo_length);
+    fifo->watermark = watermark;
+    if (timestamps != NULL) {
+        fifo_enable_timestamps(fifo, timestamps, timestamps->clock, timestamps->clock_context);
+    }
+    parser->pending_bytes = fifo->size;
+    if (parser->timeout_clock != NULL) {
+        parser->last_arrival = parser->timeout_clock(parser->timeout_context);
+    }
+    return 0;
 }
 
 // Helper Function to Encode Variable Length Field
@@ -253,12 +754,12 @@ int build_packet(unsigned char *packet, unsigned int *packet_length, unsigned in
 
 // Example Callback Implementation
 void packet_received_callback(unsigned int type, unsigned char *data, unsigned int size) {
-    printf("Packet Received:\n");
-    printf("Type: %u\n", type);
-    printf("Size: %u bytes\n", size);
-    printf("Data: ");
-    for (unsigned int i = 0; i < size; i++) {
-        printf("%02X ", data[i]);
-    }
-    printf("\n\n");
+    ParserEvent event;
+    memset(&event, 0, sizeof(event));
+    event.code = PARSER_EVENT_PACKET;
+    event.type = type;
+    event.size = size;
+    event.preview_length = (unsigned char)(size < PARSER_EVENT_PREVIEW_SIZE ? size : PARSER_EVENT_PREVIEW_SIZE);
+    memcpy(event.preview, data, event.preview_length);
+    parser_event_ring_push(parser_event_default_ring(), &event);
 }
@@ -7,19 +7,16 @@
 #ifndef PARSER_H
 #define PARSER_H
 
-#ifdef __cplusplus
-extern "C" {
-#endif
-
 #include <stdint.h>
 #include <stddef.h>
 #include "fifo.h"
+#include "parser_config.h"
+#include "parser_events.h"
+#include "parser_latency.h"
 
-
-#define MAX_FIFO_SIZE 2048           /**< Максимальный размер FIFO буфера */
-#define MAX_PACKET_SIZE 1000         /**< Максимальный размер пакета данных */
-#define SYNC_SEQUENCE_LENGTH 3       /**< Длина последовательности синхронизации */
-#define MAX_HEADER_SIZE 7            /**< Максимальный размер заголовка пакета */
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 /**
  * @brief Тип функции обратного вызова при приеме пакета.
@@ -30,6 +27,52 @@ extern "C" {
  */
 typedef void (*PacketCallback)(unsigned int type, unsigned char *data, unsigned int size);
 
+/**
+ * @brief Тип обработчика пакета с пользовательским контекстом.
+ *
+ * Нужен, когда один обработчик обслуживает много парсеров (например, портов)
+ * и должен знать, от какого из них пришёл пакет.
+ *
+ * @param context Контекст, переданный в parser_set_handler.
+ * @param type Тип пакета.
+ * @param data Указатель на данные пакета.
+ * @param size Размер данных пакета.
+ */
+typedef void (*PacketHandler)(void *context, unsigned int type, unsigned char *data, unsigned int size);
+
+/**
+ * @struct PacketView
+ * @brief Пакет, возвращённый parser_next_packet.
+ *
+ * data указывает на Parser::body и действителен до следующего вызова
+ * parser_next_packet или parse_uart для того же парсера.
+ */
+typedef struct {
+    unsigned int type;          /**< Тип пакета */
+    const unsigned char *data;  /**< Тело пакета */
+    unsigned int size;          /**< Размер тела */
+} PacketView;
+
+/**
+ * @brief Число возможных типов пакета.
+ *
+ * Тип кодируется одним или двумя байтами (см. encode_variable_length),
+ * поэтому декодированное значение не превышает 32767.
+ */
+#define PARSER_TYPE_COUNT 32768
+
+/**
+ * @struct ParserTypeFilter
+ * @brief Битовая карта принимаемых типов пакетов.
+ *
+ * Бит type установлен - пакеты этого типа передаются обработчику, сброшен -
+ * тело пакета пропускается без копирования. Одну карту могут разделять
+ * несколько парсеров.
+ */
+typedef struct {
+    uint8_t accept[PARSER_TYPE_COUNT / 8]; /**< Бит на каждый тип */
+} ParserTypeFilter;
+
 /**
  * @enum ParserState
  * @brief Перечисление состояний парсера.
@@ -42,34 +85,91 @@ typedef enum {
     STATE_BODY            /**< Получение тела пакета */
 } ParserState;
 
+/**
+ * @brief Типы полей состояния парсера.
+ *
+ * В компактной сборке (PARSER_COMPACT) состояние и счётчики байтов заголовка
+ * хранятся в одном байте, размер, тип и счётчик тела - в 16 битах.
+ */
+#if PARSER_COMPACT
+typedef uint8_t ParserStateField;
+typedef uint8_t ParserHeaderCount;
+typedef uint16_t ParserFieldValue;
+#else
+typedef ParserState ParserStateField;
+typedef int ParserHeaderCount;
+typedef unsigned int ParserFieldValue;
+#endif
+
+/**
+ * @struct ParserStats
+ * @brief Счётчики работы парсера.
+ *
+ * Обновляются простыми инкрементами в основном цикле parse_uart.
+ * Пакеты и байты тела дополнительно разложены по корзинам типа:
+ * корзина = type & (PARSER_STATS_TYPE_BUCKETS - 1).
+ */
+typedef struct {
+    uint64_t sync_hunt_bytes;       /**< Байты, отброшенные при поиске синхропоследовательности */
+    uint64_t resync_events;         /**< Потери синхронизации после найденной синхропоследовательности */
+    uint64_t checksum_failures;     /**< Несовпадения контрольной суммы заголовка */
+    uint64_t oversize_drops;        /**< Пакеты с размером больше MAX_PACKET_SIZE */
+    uint64_t body_overflows;        /**< Переполнения буфера тела */
+    uint64_t packets_delivered;     /**< Пакеты, переданные в обработчик */
+    uint64_t bytes_delivered;       /**< Байты тела, переданные в обработчик */
+    uint64_t packets_filtered;      /**< Пакеты, отброшенные фильтром типов */
+    uint64_t bytes_filtered;        /**< Байты тела, пропущенные фильтром типов */
+    uint64_t timeouts;              /**< Недополученные пакеты, брошенные по таймауту */
+    uint64_t type_packets[PARSER_STATS_TYPE_BUCKETS]; /**< Пакеты по корзинам типа */
+    uint64_t type_bytes[PARSER_STATS_TYPE_BUCKETS];   /**< Байты тела по корзинам типа */
+} ParserStats;
+
 /**
  * @struct Parser
  * @brief Структура, представляющая парсер данных.
  */
 typedef struct {
-    ParserState state;                    /**< Текущее состояние парсера */
+    ParserStateField state;               /**< Текущее состояние парсера (ParserState) */
     FIFO_Buffer *fifo;                    /**< Указатель на FIFO буфер */
     PacketCallback callback;              /**< Функция обратного вызова при приеме пакета */
+    PacketHandler handler;                /**< Обработчик с контекстом (если задан, вызывается вместо callback) */
+    void *handler_context;                /**< Контекст обработчика */
 
-    int sync_pos;                         /**< Позиция поиска синхронизации */
+    ParserHeaderCount sync_pos;           /**< Число совпавших байтов синхропоследовательности (они ещё в FIFO) */
 
     // Поля Заголовка
-    unsigned int data_size;               /**< Размер данных в пакете */
-    unsigned int type;                    /**< Тип пакета */
+    ParserFieldValue data_size;           /**< Размер данных в пакете */
+    ParserFieldValue type;                /**< Тип пакета */
     unsigned char header_checksum;        /**< Контрольная сумма заголовка */
     unsigned char calculated_header_checksum; /**< Вычисленная контрольная сумма заголовка */
-    int size_bytes_read;                  /**< Количество байтов, прочитанных для размера данных */
-    int type_bytes_read;                  /**< Количество байтов, прочитанных для типа пакета */
+    ParserHeaderCount size_bytes_read;    /**< Количество байтов, которыми закодирован размер данных */
+    ParserHeaderCount type_bytes_read;    /**< Количество байтов, которыми закодирован тип пакета */
 
     // Поля Тела
     unsigned char body[MAX_PACKET_SIZE];  /**< Массив для хранения данных тела пакета */
-    unsigned int body_bytes_read;         /**< Количество байтов, прочитанных для тела пакета */
+    ParserFieldValue body_bytes_read;     /**< Количество байтов, прочитанных для тела пакета */
+
+    ParserStats stats;                    /**< Статистика парсера */
+
+    ParserEventCallback event_callback;   /**< Приёмник событий (NULL - события не сообщаются) */
+    void *event_context;                  /**< Контекст приёмника событий */
+
+    ParserLatency *latency;               /**< Трассировка задержек (NULL - выключена) */
+
+    const ParserTypeFilter *type_filter;  /**< Фильтр типов (NULL - принимаются все) */
+
+    MonotonicClockFn timeout_clock;       /**< Источник времени для таймаута (NULL - таймаут выключен) */
+    void *timeout_context;                /**< Контекст источника времени */
+    uint64_t timeout_ns;                  /**< Наибольший промежуток между поступлениями внутри пакета, нс */
+    uint64_t last_arrival;                /**< Время, когда парсер последний раз увидел новые байты */
+    int pending_bytes;                    /**< Байтов в FIFO после прошлого разбора (начало недоразобранного пакета) */
 } Parser;
 
 /**
  * @brief Инициализирует парсер.
  *
  * Устанавливает начальные значения для структуры парсера и устанавливает FIFO буфер и функцию обратного вызова.
+ * В компактной сборке (PARSER_COMPACT) тело пакета не обнуляется.
  *
  * @param parser Указатель на структуру парсера.
  * @param fifo Указатель на FIFO буфер.
@@ -77,6 +177,116 @@ typedef struct {
  */
 void init_parser(Parser *parser, FIFO_Buffer *fifo, PacketCallback callback);
 
+/**
+ * @brief Устанавливает обработчик пакетов с контекстом.
+ *
+ * Пока обработчик задан, он вызывается вместо callback из init_parser.
+ *
+ * @param parser Указатель на структуру парсера.
+ * @param handler Обработчик или NULL, чтобы вернуться к callback.
+ * @param context Контекст, передаваемый обработчику.
+ */
+void parser_set_handler(Parser *parser, PacketHandler handler, void *context);
+
+/**
+ * @brief Устанавливает приёмник событий парсера.
+ *
+ * По умолчанию init_parser направляет события в parser_event_default_ring().
+ * Обработчик вызывается из parse_uart и не должен блокироваться.
+ *
+ * @param parser Указатель на структуру парсера.
+ * @param callback Обработчик событий или NULL, чтобы отключить события.
+ * @param context Контекст, передаваемый обработчику.
+ */
+void parser_set_event_sink(Parser *parser, ParserEventCallback callback, void *context);
+
+/**
+ * @brief Включает трассировку задержек пакетов.
+ *
+ * Структура должна быть подготовлена parser_latency_init и жить не меньше парсера.
+ * Для точного момента поступления у FIFO нужно включить fifo_enable_timestamps
+ * с тем же источником времени.
+ *
+ * @param parser Указатель на структуру парсера.
+ * @param latency Структура трассировки или NULL, чтобы выключить.
+ */
+void parser_set_latency(Parser *parser, ParserLatency *latency);
+
+/**
+ * @brief Включает таймаут между поступлениями данных внутри пакета.
+ *
+ * Если парсер находится внутри пакета (совпала часть синхропоследовательности,
+ * разбирается заголовок или тело) и новые байты не поступали дольше
+ * timeout_ns, недополученный пакет бросается: байты его заголовка, ещё
+ * лежащие в FIFO, отбрасываются, тело забывается, и поиск синхронизации
+ * начинается с байтов, пришедших после перерыва. Проверка выполняется в
+ * начале parse_uart и parser_next_packet, а для канала без данных - в
+ * parser_tick. Время поступления определяется с точностью до вызова
+ * парсера, т.е. это таймаут между порциями.
+ *
+ * @param parser Указатель на структуру парсера.
+ * @param timeout_ns Наибольший промежуток, нс (0 - выключить).
+ * @param clock Источник монотонного времени (NULL - выключить).
+ * @param context Контекст источника времени.
+ */
+void parser_set_timeout(Parser *parser, uint64_t timeout_ns, MonotonicClockFn clock, void *context);
+
+/**
+ * @brief Проверяет таймаут для канала, по которому не приходят данные.
+ *
+ * Вызывается периодически (например, по таймеру цикла событий), чтобы
+ * застрявший пакет был брошен через timeout_ns, даже если следующие байты
+ * ещё не пришли.
+ *
+ * @param parser Указатель на структуру парсера.
+ * @return 1, если недополученный пакет брошен, иначе 0.
+ */
+int parser_tick(Parser *parser);
+
+/**
+ * @brief Заполняет фильтр типов.
+ *
+ * @param filter Указатель на фильтр.
+ * @param accept_all 1 - принимать все типы, 0 - не принимать ни один.
+ */
+void parser_type_filter_init(ParserTypeFilter *filter, int accept_all);
+
+/**
+ * @brief Разрешает или запрещает один тип пакета.
+ *
+ * @param filter Указатель на фильтр.
+ * @param type Тип пакета (меньше PARSER_TYPE_COUNT).
+ * @param accept 1 - принимать, 0 - пропускать.
+ * @return Возвращает 0 при успехе или -1, если тип вне диапазона.
+ */
+int parser_type_filter_set(ParserTypeFilter *filter, unsigned int type, int accept);
+
+/**
+ * @brief Проверяет, принимается ли тип пакета.
+ *
+ * @param filter Указатель на фильтр.
+ * @param type Тип пакета.
+ * @return 1, если тип принимается, иначе 0.
+ */
+int parser_type_filter_accepts(const ParserTypeFilter *filter, unsigned int type);
+
+/**
+ * @brief Подключает фильтр типов к парсеру.
+ *
+ * Тела пакетов отклонённых типов пропускаются сдвигом головы FIFO без
+ * копирования в body и без вызова обработчика; такие пакеты учитываются в
+ * stats.packets_filtered и stats.bytes_filtered. Пропускается ровно столько
+ * байтов, сколько извлёк бы обычный разбор тела, поэтому типы и размеры
+ * принятых пакетов совпадают с разбором без фильтра. Исключение - байты
+ * body, которые parse_uart при дочитывании тела оставляет от предыдущего
+ * пакета: у пропущенного пакета их нет. Фильтр должен жить не меньше
+ * парсера и может меняться между вызовами parse_uart.
+ *
+ * @param parser Указатель на структуру парсера.
+ * @param filter Фильтр или NULL, чтобы принимать все типы.
+ */
+void parser_set_type_filter(Parser *parser, const ParserTypeFilter *filter);
+
 /**
  * @brief Декодирует переменную длину из FIFO буфера.
  *
@@ -104,11 +314,126 @@ unsigned char calculate_checksum(unsigned char *data, int length);
  * @brief Парсит входящие данные из UART.
  *
  * Обрабатывает данные из FIFO буфера в соответствии с текущим состоянием парсера.
+ * Синхропоследовательность и заголовок проверяются просмотром (peek_fifo) и
+ * извлекаются из FIFO только после успешной проверки. При неверной
+ * контрольной сумме или недопустимом размере отбрасывается один байт, и
+ * поиск синхронизации продолжается со следующего, поэтому настоящий пакет,
+ * начавшийся внутри ложного заголовка, не теряется.
+ *
+ * Если после синхропоследовательности в FIFO уже лежит заголовок
+ * наибольшей длины, размер, тип и контрольная сумма разбираются за один шаг
+ * (отключается PARSER_FAST_HEADER=0); состояния заголовка используются
+ * только для неполного заголовка.
  *
  * @param parser Указатель на структуру парсера.
  */
 void parse_uart(Parser *parser);
 
+/**
+ * @brief Извлекает следующий пакет без обратного вызова.
+ *
+ * Продвигает тот же конечный автомат, что и parse_uart, пока не будет
+ * собран пакет или не кончатся данные в FIFO. Пакет учитывается в
+ * статистике и трассировке задержек, но callback и обработчик не
+ * вызываются. Пакеты, отклонённые фильтром типов, пропускаются.
+ *
+ * @code
+ * PacketView packet;
+ * while (parser_next_packet(&parser, &packet)) {
+ *     handle(packet.type, packet.data, packet.size);
+ * }
+ * @endcode
+ *
+ * @param parser Указатель на структуру парсера.
+ * @param view Куда записать пакет.
+ * @return 1, если пакет получен, 0 - данных для целого пакета пока нет.
+ */
+int parser_next_packet(Parser *parser, PacketView *view);
+
+/**
+ * @brief Сколько байтов должно быть в FIFO, чтобы разбор продвинулся.
+ *
+ * При поиске синхронизации и разборе заголовка - синхропоследовательность
+ * и наименьший заголовок (или уже известная его часть), внутри тела -
+ * остаток тела с байтом, который parse_uart дочитывает после него.
+ * Потребитель, который ждёт данных (fifo_watermark_arm,
+ * shared_fifo_wait_level), может не просыпаться раньше.
+ *
+ * @param parser Указатель на структуру парсера.
+ * @return Число байтов (не больше MAX_FIFO_SIZE).
+ */
+int parser_bytes_needed(const Parser *parser);
+
+/**
+ * @brief Копирует текущую статистику парсера.
+ *
+ * Вызывается из потока, который выполняет parse_uart, или между её вызовами.
+ *
+ * @param parser Указатель на структуру парсера.
+ * @param out Указатель на структуру, куда будет скопирована статистика.
+ */
+void parser_stats_snapshot(const Parser *parser, ParserStats *out);
+
+/**
+ * @brief Обнуляет статистику парсера.
+ *
+ * @param parser Указатель на структуру парсера.
+ */
+void parser_stats_reset(Parser *parser);
+
+#define PARSER_CHECKPOINT_MAGIC 0x4B435055u  /**< "UPCK": начало снимка состояния */
+#define PARSER_CHECKPOINT_VERSION 1          /**< Версия формата снимка */
+#define PARSER_CHECKPOINT_HEADER_SIZE 40     /**< Заголовок снимка до тела и байтов FIFO */
+/** Наибольший размер снимка: заголовок, тело, содержимое FIFO и CRC-32 */
+#define PARSER_CHECKPOINT_MAX_SIZE (PARSER_CHECKPOINT_HEADER_SIZE + MAX_PACKET_SIZE + MAX_FIFO_SIZE + 4)
+
+/**
+ * @brief Размер снимка текущего состояния парсера и его FIFO.
+ *
+ * @param parser Указатель на структуру парсера.
+ * @return Число байтов, которое запишет parser_checkpoint_save.
+ */
+size_t parser_checkpoint_size(const Parser *parser);
+
+/**
+ * @brief Сохраняет состояние разбора и непрочитанные байты FIFO в снимок.
+ *
+ * Снимок содержит положение конечного автомата, уже разобранные поля
+ * заголовка, принятую часть тела и байты FIFO, ещё не потреблённые
+ * парсером (в том числе синхропоследовательность и заголовок, просмотренные
+ * заранее). Числа записываются в порядке little-endian, в конце стоит CRC-32,
+ * поэтому снимок можно передать другому процессу или машине: через файл,
+ * разделяемую память или сокет. Обработчики, фильтр, трассировка, таймаут
+ * и статистика - настройки процесса и в снимок не входят. Сегменты
+ * растущего FIFO в формат не входят; после parse_uart их не бывает.
+ *
+ * @param parser Указатель на структуру парсера.
+ * @param blob Буфер для снимка (PARSER_CHECKPOINT_MAX_SIZE байт достаточно всегда).
+ * @param capacity Размер буфера.
+ * @param length Указатель, куда будет записан размер снимка.
+ * @return Возвращает 0 при успехе, -1 если буфер мал или к FIFO присоединены сегменты.
+ */
+int parser_checkpoint_save(const Parser *parser, unsigned char *blob, size_t capacity, size_t *length);
+
+/**
+ * @brief Восстанавливает состояние разбора и содержимое FIFO из снимка.
+ *
+ * Парсер должен быть инициализирован (init_parser) и настроен; заменяются
+ * только состояние разбора и содержимое parser->fifo, после чего разбор
+ * продолжается с середины пакета без потери байтов и без поиска
+ * синхронизации. Снимок проверяется целиком до изменения парсера: при
+ * неверной сигнатуре, версии, CRC, другой синхропоследовательности или
+ * размерах, не помещающихся в эту сборку, парсер и FIFO не меняются.
+ * Отметки времени FIFO, если ведутся, считают восстановленные байты
+ * пришедшими в момент восстановления.
+ *
+ * @param parser Указатель на структуру парсера.
+ * @param blob Снимок.
+ * @param length Размер снимка.
+ * @return Возвращает 0 при успехе, -1 при неверном снимке.
+ */
+int parser_checkpoint_restore(Parser *parser, const unsigned char *blob, size_t length);
+
 /**
  * @brief Кодирует значение переменной длины в байты.
  *
@@ -139,6 +464,8 @@ int build_packet(unsigned char *packet, unsigned int *packet_length, unsigned in
  * @brief Обратная функция при приеме пакета.
  *
  * Функция вызывается, когда весь пакет успешно принят и обработан.
+ * Не печатает пакет сама, а помещает запись PARSER_EVENT_PACKET в
+ * parser_event_default_ring(); вывод выполняет parser_event_ring_drain.
  *
  * @param type Тип принятого пакета.
  * @param data Указатель на данные принятого пакета.
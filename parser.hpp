@@ -0,0 +1,305 @@
+/**
+ * @file parser.hpp
+ * @brief Отдельная C++-реализация FIFO и парсера на шаблонах.
+ *
+ * Fifo<Capacity> и Parser<Config, Handler> - не обёртка над FIFO_Buffer и
+ * Parser, а собственная копия конечного автомата parse_uart: из parser.h
+ * берутся только параметры протокола (parser_config.h) и ParserState.
+ * Обработчик пакета передаётся как функтор или лямбда, а не как указатель
+ * PacketCallback, поэтому вызов обработчика и арифметика индексов FIFO
+ * встраиваются и специализируются компилятором под параметры протокола.
+ *
+ * Реализация покрывает только разбор потока. Статистики (ParserStats),
+ * событий, фильтра типов, таймаута между поступлениями, трассировки
+ * задержек, растущих FIFO, снимков состояния и parser_next_packet здесь
+ * нет; если они нужны, используется parser.h.
+ *
+ * Разбор должен совпадать с parse_uart байт в байт: parser_stress
+ * сравнивает оба пути на одних и тех же потоках (типы, размеры и тела
+ * пакетов). Изменение автомата в parser.c переносится сюда в том же
+ * изменении, иначе parser_stress сообщит о расхождении.
+ */
+#ifndef PARSER_HPP
+#define PARSER_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <utility>
+
+#include "parser.h"
+
+namespace uart {
+
+/**
+ * @brief Параметры протокола по умолчанию (из parser_config.h).
+ *
+ * Собственная конфигурация задаётся структурой с теми же статическими членами.
+ */
+struct DefaultConfig {
+    static constexpr unsigned char sync[SYNC_SEQUENCE_LENGTH] = PARSER_SYNC_SEQUENCE; /**< Синхропоследовательность */
+    static constexpr std::size_t sync_length = SYNC_SEQUENCE_LENGTH;                   /**< Длина синхропоследовательности */
+    static constexpr std::size_t max_packet_size = MAX_PACKET_SIZE;                    /**< Максимальный размер тела */
+    static constexpr std::size_t fifo_capacity = MAX_FIFO_SIZE;                        /**< Ёмкость FIFO */
+};
+
+/**
+ * @brief FIFO-буфер фиксированной ёмкости.
+ *
+ * Семантика совпадает с write_fifo/read_fifo/peek_fifo: функции возвращают 0
+ * при успехе и -1 при ошибке. Для ёмкости, равной степени двойки, взятие
+ * индекса по модулю заменяется маской.
+ *
+ * @tparam Capacity Ёмкость буфера в байтах.
+ */
+template <std::size_t Capacity>
+class Fifo {
+public:
+    static_assert(Capacity > 0, "Fifo capacity must be positive");
+    static constexpr std::size_t capacity = Capacity; /**< Ёмкость буфера */
+
+    /// Записывает length байтов целиком либо ничего (как write_fifo).
+    int write(const unsigned char *data, int length) noexcept {
+        if (length < 0 || static_cast<std::size_t>(length) > Capacity - size_) {
+            return -1;
+        }
+        std::size_t n = static_cast<std::size_t>(length);
+        if (n == 0) {
+            return 0;
+        }
+        std::size_t first = Capacity - tail_;
+        if (first > n) {
+            first = n;
+        }
+        std::memcpy(&buffer_[tail_], data, first);
+        std::memcpy(&buffer_[0], data + first, n - first);
+        tail_ = wrap(tail_ + n);
+        size_ += n;
+        return 0;
+    }
+
+    /// Извлекает один байт (как read_fifo).
+    int read(unsigned char &byte) noexcept {
+        if (size_ == 0) {
+            return -1;
+        }
+        byte = buffer_[head_];
+        head_ = wrap(head_ + 1);
+        size_--;
+        return 0;
+    }
+
+    /// Просматривает байт со смещением index от головы (как peek_fifo).
+    int peek(std::size_t index, unsigned char &byte) const noexcept {
+        if (index >= size_) {
+            return -1;
+        }
+        byte = buffer_[wrap(head_ + index)];
+        return 0;
+    }
+
+    /// Удаляет count байтов из головы без копирования (как fifo_skip).
+    int skip(std::size_t count) noexcept {
+        if (count > size_) {
+            return -1;
+        }
+        head_ = wrap(head_ + count);
+        size_ -= count;
+        return 0;
+    }
+
+    /// Возвращает прочитанный байт обратно в голову буфера.
+    void unread() noexcept {
+        head_ = wrap(head_ + Capacity - 1);
+        size_++;
+    }
+
+    std::size_t size() const noexcept { return size_; } /**< Число байтов в буфере */
+    bool empty() const noexcept { return size_ == 0; }  /**< Пуст ли буфер */
+
+private:
+    static constexpr std::size_t wrap(std::size_t index) noexcept {
+        if constexpr ((Capacity & (Capacity - 1)) == 0) {
+            return index & (Capacity - 1);
+        } else {
+            return index % Capacity;
+        }
+    }
+
+    unsigned char buffer_[Capacity] = {};
+    std::size_t head_ = 0;
+    std::size_t tail_ = 0;
+    std::size_t size_ = 0;
+};
+
+/**
+ * @brief Парсер пакетов с обработчиком-функтором.
+ *
+ * Конечный автомат повторяет parse_uart байт в байт, включая его
+ * особенности (лишний read_fifo при дочитывании тела, контрольную сумму
+ * по младшим байтам size и type, повторный поиск синхронизации со
+ * следующего байта после ложного заголовка), поэтому на одном и том же потоке оба
+ * пути выдают одинаковую последовательность пакетов.
+ *
+ * @tparam Config Параметры протокола (см. DefaultConfig).
+ * @tparam Handler Вызываемый объект с сигнатурой void(unsigned int type, unsigned char *data, unsigned int size).
+ */
+template <class Config, class Handler>
+class Parser {
+public:
+    using fifo_type = Fifo<Config::fifo_capacity>; /**< Тип FIFO для данной конфигурации */
+
+    Parser(fifo_type &fifo, Handler handler) : fifo_(fifo), handler_(std::move(handler)) {}
+
+    /// Обрабатывает все данные, накопленные в FIFO (аналог parse_uart).
+    void parse() {
+        unsigned char byte = 0;
+        while (fifo_.size() > 0) {
+            switch (state_) {
+                case STATE_SYNC:
+                    if (fifo_.peek(sync_pos_, byte) != 0) {
+                        return;
+                    }
+                    if (byte == Config::sync[sync_pos_]) {
+                        if (++sync_pos_ == Config::sync_length) {
+                            state_ = STATE_HEADER_SIZE;
+                            data_size_ = 0;
+                            type_ = 0;
+                            size_length_ = 0;
+                            type_length_ = 0;
+                            calculated_checksum_ = 0;
+                        }
+                    } else {
+                        resync();
+                    }
+                    break;
+
+                case STATE_HEADER_SIZE:
+                    size_length_ = decode(Config::sync_length, data_size_);
+                    if (size_length_ == 0) {
+                        return;
+                    }
+                    calculated_checksum_ = static_cast<unsigned char>(calculated_checksum_ + (data_size_ & 0xFF));
+                    state_ = STATE_HEADER_TYPE;
+                    break;
+
+                case STATE_HEADER_TYPE:
+                    type_length_ = decode(Config::sync_length + size_length_, type_);
+                    if (type_length_ == 0) {
+                        return;
+                    }
+                    calculated_checksum_ = static_cast<unsigned char>(calculated_checksum_ + (type_ & 0xFF));
+                    state_ = STATE_HEADER_CHECKSUM;
+                    break;
+
+                case STATE_HEADER_CHECKSUM: {
+                    std::size_t header_length = Config::sync_length + size_length_ + type_length_;
+                    if (fifo_.peek(header_length, byte) != 0) {
+                        return;
+                    }
+                    if (byte != calculated_checksum_ || data_size_ > Config::max_packet_size) {
+                        resync();
+                        break;
+                    }
+                    fifo_.skip(header_length + 1);
+                    sync_pos_ = 0;
+                    if (data_size_ == 0) {
+                        handler_(type_, body_, 0u);
+                        state_ = STATE_SYNC;
+                    } else {
+                        body_bytes_read_ = 0;
+                        state_ = STATE_BODY;
+                    }
+                    break;
+                }
+
+                case STATE_BODY: {
+                    std::size_t available = fifo_.size();
+                    std::size_t to_read = data_size_ - body_bytes_read_;
+                    if (available >= to_read) {
+                        fifo_.read(byte); // как в parse_uart: первый байт пропускается
+                        for (std::size_t i = 0; i < to_read; i++) {
+                            fifo_.read(byte);
+                            body_[i] = byte;
+                        }
+                        body_bytes_read_ += static_cast<unsigned int>(to_read);
+                        handler_(type_, body_, body_bytes_read_);
+                        state_ = STATE_SYNC;
+                    } else {
+                        for (std::size_t i = 0; i < available; i++) {
+                            fifo_.read(byte);
+                            if (body_bytes_read_ < Config::max_packet_size) {
+                                body_[body_bytes_read_++] = byte;
+                            } else {
+                                state_ = STATE_SYNC;
+                                break;
+                            }
+                        }
+                        return;
+                    }
+                    break;
+                }
+
+                default:
+                    state_ = STATE_SYNC;
+                    break;
+            }
+        }
+    }
+
+    Handler &handler() noexcept { return handler_; } /**< Доступ к обработчику */
+
+private:
+    // Разбор поля переменной длины со смещением offset без извлечения; 0 - данных пока не хватает.
+    std::size_t decode(std::size_t offset, unsigned int &value) const {
+        unsigned char first;
+        if (fifo_.peek(offset, first) != 0) {
+            return 0;
+        }
+        if (first < 128) {
+            value = first;
+            return 1;
+        }
+        unsigned char second;
+        if (fifo_.peek(offset + 1, second) != 0) {
+            return 0;
+        }
+        value = (first - 128u) + (static_cast<unsigned int>(second) << 7);
+        return 2;
+    }
+
+    // Ложная синхронизация: отбрасывается один байт, поиск продолжается со следующего.
+    void resync() noexcept {
+        fifo_.skip(1);
+        sync_pos_ = 0;
+        state_ = STATE_SYNC;
+    }
+
+    fifo_type &fifo_;
+    Handler handler_;
+    ParserState state_ = STATE_SYNC;
+    std::size_t sync_pos_ = 0;
+    unsigned int data_size_ = 0;
+    unsigned int type_ = 0;
+    std::size_t size_length_ = 0;
+    std::size_t type_length_ = 0;
+    unsigned char calculated_checksum_ = 0;
+    unsigned int body_bytes_read_ = 0;
+    unsigned char body_[Config::max_packet_size] = {};
+};
+
+/**
+ * @brief Создаёт парсер, выводя тип обработчика из аргумента.
+ *
+ * @code
+ * uart::Fifo<MAX_FIFO_SIZE> fifo;
+ * auto parser = uart::make_parser(fifo, [](unsigned int type, unsigned char *data, unsigned int size) { ... });
+ * @endcode
+ */
+template <class Config = DefaultConfig, class Handler>
+Parser<Config, Handler> make_parser(Fifo<Config::fifo_capacity> &fifo, Handler handler) {
+    return Parser<Config, Handler>(fifo, std::move(handler));
+}
+
+} // namespace uart
+
+#endif // PARSER_HPP
@@ -0,0 +1,41 @@
+/**
+ * @file parser_atomic.h
+ * @brief Атомарные типы для полей публичных структур, общие для C и C++.
+ *
+ * Структуры библиотеки собираются в C, но подключаются и из C++ (parser.hpp,
+ * parser_stress.cpp). Атомарные поля объявляются через эти typedef: в C это
+ * _Atomic-типы из <stdatomic.h>, в C++ - std::atomic. Раскладки совпадают,
+ * если оба типа имеют размер и выравнивание исходного целого; это проверяется
+ * при компиляции с обеих сторон.
+ *
+ * Заголовок подключается только вне блоков extern "C": стандартные заголовки
+ * внутри спецификации связывания не допускаются.
+ */
+#ifndef PARSER_ATOMIC_H
+#define PARSER_ATOMIC_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+#include <atomic>
+
+typedef std::atomic<size_t> parser_atomic_size_t; /**< Атомарный size_t */
+typedef std::atomic<int> parser_atomic_int;       /**< Атомарный int */
+
+static_assert(sizeof(parser_atomic_size_t) == sizeof(size_t) && alignof(parser_atomic_size_t) == alignof(size_t),
+              "std::atomic<size_t> must match atomic_size_t");
+static_assert(sizeof(parser_atomic_int) == sizeof(int) && alignof(parser_atomic_int) == alignof(int),
+              "std::atomic<int> must match atomic_int");
+#else
+#include <stdatomic.h>
+
+typedef atomic_size_t parser_atomic_size_t; /**< Атомарный size_t */
+typedef atomic_int parser_atomic_int;       /**< Атомарный int */
+
+_Static_assert(sizeof(parser_atomic_size_t) == sizeof(size_t) && _Alignof(parser_atomic_size_t) == _Alignof(size_t),
+               "atomic_size_t must match std::atomic<size_t>");
+_Static_assert(sizeof(parser_atomic_int) == sizeof(int) && _Alignof(parser_atomic_int) == _Alignof(int),
+               "atomic_int must match std::atomic<int>");
+#endif
+
+#endif // PARSER_ATOMIC_H
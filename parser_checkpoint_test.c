@@ -0,0 +1,216 @@
+// Проверка снимков состояния (parser_checkpoint_save / parser_checkpoint_restore).
+//
+// Поток пакетов режется на каждом байте: первая часть разбирается, снимок
+// восстанавливается в новый парсер с новым FIFO, и оба парсера получают
+// остаток. Восстановленный должен выдать ту же последовательность пакетов,
+// что и непрерванный; среди точек разреза обязаны быть середина заголовка
+// и середина тела. Затем испорченные снимки (любой изменённый байт, другая
+// версия с верной CRC, укороченная длина) должны отвергаться без изменения
+// парсера и FIFO.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "parser.h"
+
+#define PACKET_COUNT 24
+#define MAX_RECEIVED 64
+#define WRITE_CHUNK 64
+
+typedef struct {
+    unsigned int type[MAX_RECEIVED];
+    unsigned int size[MAX_RECEIVED];
+    uint32_t hash[MAX_RECEIVED];
+    int count;
+} Received;
+
+static int failures;
+
+static void record_packet(void *context, unsigned int type, unsigned char *data, unsigned int size) {
+    Received *received = (Received *)context;
+    if (received->count < MAX_RECEIVED) {
+        uint32_t hash = 2166136261u;
+        for (unsigned int i = 0; i < size; i++) {
+            hash = (hash ^ data[i]) * 16777619u;
+        }
+        received->type[received->count] = type;
+        received->size[received->count] = size;
+        received->hash[received->count] = hash;
+    }
+    received->count++;
+}
+
+static void check(int condition, const char *what, int cut) {
+    if (!condition) {
+        printf("FAILED: %s (cut at byte %d)\n", what, cut);
+        failures++;
+    }
+}
+
+// Типы и размеры меньше 128: контрольная сумма parse_uart учитывает только младшие байты полей
+static int make_stream(unsigned char *stream) {
+    unsigned char body[128];
+    int length = 0;
+    for (int i = 0; i < (int)sizeof(body); i++) {
+        body[i] = (unsigned char)(i * 31 + 1);
+    }
+    for (int i = 0; i < PACKET_COUNT; i++) {
+        unsigned int packet_length;
+        build_packet(stream + length, &packet_length, 1 + (unsigned int)(i * 23) % 120, (unsigned int)(i * 11) % 128,
+                     body);
+        length += (int)packet_length;
+        stream[length++] = 0x00; // parse_uart дочитывает байт после тела
+    }
+    return length;
+}
+
+static void setup(FIFO_Buffer *fifo, Parser *parser, Received *received) {
+    memset(received, 0, sizeof(*received));
+    init_fifo(fifo);
+    init_parser(parser, fifo, NULL);
+    parser_set_handler(parser, record_packet, received);
+    parser_set_event_sink(parser, NULL, NULL);
+}
+
+static void feed(Parser *parser, const unsigned char *data, int length) {
+    for (int offset = 0; offset < length; offset += WRITE_CHUNK) {
+        int chunk = length - offset < WRITE_CHUNK ? length - offset : WRITE_CHUNK;
+        write_fifo(parser->fifo, data + offset, chunk);
+        parse_uart(parser);
+    }
+}
+
+// with_body - сравнить и тело первого пакета: снимок сделан посреди него, начало тела
+// пришло из снимка. Дочитывая тело, parse_uart пишет с начала буфера, и в остальные
+// пакеты попадают остатки старых тел за пределами data_size, которые в снимок не входят.
+static int same_packets(const Received *expected, const Received *actual, int with_body) {
+    if (expected->count != actual->count ||
+        (with_body && expected->count > 0 && expected->hash[0] != actual->hash[0])) {
+        return 0;
+    }
+    for (int i = 0; i < expected->count && i < MAX_RECEIVED; i++) {
+        if (expected->type[i] != actual->type[i] || expected->size[i] != actual->size[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// CRC-32 (IEEE, отражённый) - как в конце снимка
+static uint32_t crc32(const unsigned char *data, size_t length) {
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+    return ~crc;
+}
+
+static void put_u32(unsigned char *out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+// Снимок отвергнут, а парсер и FIFO не изменились
+static void check_rejected(Parser *parser, const unsigned char *blob, size_t length, const char *what, int cut) {
+    static Parser parser_before;
+    static FIFO_Buffer fifo_before;
+    parser_before = *parser;
+    fifo_before = *parser->fifo;
+    check(parser_checkpoint_restore(parser, blob, length) == -1, what, cut);
+    check(memcmp(&parser_before, parser, sizeof(*parser)) == 0 &&
+              memcmp(&fifo_before, parser->fifo, sizeof(fifo_before)) == 0,
+          "rejected snapshot must leave the parser and FIFO untouched", cut);
+}
+
+static void check_corrupted(const unsigned char *blob, size_t length, int cut) {
+    static unsigned char bad[PARSER_CHECKPOINT_MAX_SIZE];
+    static FIFO_Buffer fifo;
+    static Parser parser;
+    Received received;
+    unsigned char partial[SYNC_SEQUENCE_LENGTH + MAX_HEADER_SIZE + 2];
+    unsigned int partial_length;
+    unsigned char body[2] = {0};
+    // Целевой парсер тоже в середине пакета, чтобы изменение было заметно
+    build_packet(partial, &partial_length, 2, 9, body);
+    setup(&fifo, &parser, &received);
+    feed(&parser, partial, SYNC_SEQUENCE_LENGTH + 1);
+
+    for (size_t i = 0; i < length; i++) {
+        memcpy(bad, blob, length);
+        bad[i] ^= 0x10;
+        check_rejected(&parser, bad, length, "snapshot with a flipped byte must be rejected", cut);
+    }
+    memcpy(bad, blob, length);
+    bad[4] = PARSER_CHECKPOINT_VERSION + 1;
+    put_u32(bad + length - 4, crc32(bad, length - 4));
+    check_rejected(&parser, bad, length, "snapshot of another version must be rejected", cut);
+    for (size_t shorter = 0; shorter < length; shorter += shorter < PARSER_CHECKPOINT_HEADER_SIZE + 8 ? 1 : 97) {
+        check_rejected(&parser, blob, shorter, "truncated snapshot must be rejected", cut);
+    }
+    check_rejected(&parser, blob, length - 1, "snapshot one byte short must be rejected", cut);
+}
+
+int main(void) {
+    static unsigned char stream[PACKET_COUNT * (SYNC_SEQUENCE_LENGTH + MAX_HEADER_SIZE + 128 + 1)];
+    static unsigned char blob[PARSER_CHECKPOINT_MAX_SIZE];
+    static FIFO_Buffer fifo;
+    static FIFO_Buffer restored_fifo;
+    static Parser parser;
+    static Parser restored;
+    int length = make_stream(stream);
+    int header_cuts = 0;
+    int body_cuts = 0;
+
+    for (int cut = 0; cut <= length; cut++) {
+        Received before;
+        Received expected;
+        Received actual;
+        size_t blob_length;
+        int in_body = 0;
+        int first_of_kind = 0;
+        setup(&fifo, &parser, &before);
+        feed(&parser, stream, cut);
+        in_body = parser.state == STATE_BODY;
+        if (in_body && parser.body_bytes_read > 0) {
+            first_of_kind = body_cuts++ == 0;
+        } else if (parser.state != STATE_SYNC) {
+            first_of_kind = header_cuts++ == 0;
+        }
+        if (parser_checkpoint_save(&parser, blob, sizeof(blob), &blob_length) != 0 ||
+            blob_length != parser_checkpoint_size(&parser)) {
+            check(0, "snapshot must be saved", cut);
+            continue;
+        }
+        check(parser_checkpoint_save(&parser, blob, blob_length - 1, &blob_length) == -1,
+              "saving into a short buffer must fail", cut);
+
+        // Остаток: непрерванный парсер и восстановленный в новый FIFO
+        memset(&expected, 0, sizeof(expected));
+        parser_set_handler(&parser, record_packet, &expected);
+        feed(&parser, stream + cut, length - cut);
+        setup(&restored_fifo, &restored, &actual);
+        check(parser_checkpoint_restore(&restored, blob, blob_length) == 0, "snapshot must be restored", cut);
+        feed(&restored, stream + cut, length - cut);
+        check(same_packets(&expected, &actual, in_body), "restored parser must deliver the same packets", cut);
+        check(before.count + actual.count == PACKET_COUNT, "no packet may be lost across the snapshot", cut);
+        check(restored.state == parser.state, "restored parser must end in the same state", cut);
+
+        // Испорченные снимки: первая точка внутри заголовка и первая внутри тела
+        if (first_of_kind) {
+            check_corrupted(blob, blob_length, cut);
+        }
+    }
+    check(header_cuts > 0, "some cuts must fall inside a header", -1);
+    check(body_cuts > 0, "some cuts must fall inside a body", -1);
+    if (failures != 0) {
+        return EXIT_FAILURE;
+    }
+    printf("parser checkpoint: %d cuts (%d in headers, %d in bodies), all checks passed\n", length + 1, header_cuts,
+           body_cuts);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,77 @@
+/**
+ * @file parser_config.h
+ * @brief Параметры протокола, задаваемые при сборке.
+ *
+ * Все значения можно переопределить через -D при компиляции (или через
+ * кэш-переменные CMake PARSER_*). Так компилятор видит их как константы
+ * и сворачивает сравнение синхропоследовательности и проверки размеров.
+ *
+ * PARSER_COMPACT включает компактную сборку для микроконтроллеров: узкие
+ * типы индексов FIFO и полей заголовка, тело пакета не обнуляется при
+ * init_parser, статистика не раскладывается по типам. Размеры буферов по-прежнему
+ * задаются MAX_FIFO_SIZE и MAX_PACKET_SIZE.
+ *
+ * Если определён PARSER_VARIANT, все внешние имена парсера получают
+ * префикс варианта (см. parser_names.h), что позволяет линковать
+ * несколько специализированных парсеров в один бинарный файл.
+ */
+#ifndef PARSER_CONFIG_H
+#define PARSER_CONFIG_H
+
+#ifndef PARSER_SYNC_SEQUENCE
+#define PARSER_SYNC_SEQUENCE {0xAA, 0xBB, 0xCC} /**< Байты синхропоследовательности */
+#endif
+
+#ifndef SYNC_SEQUENCE_LENGTH
+#define SYNC_SEQUENCE_LENGTH 3       /**< Длина последовательности синхронизации */
+#endif
+
+#ifndef MAX_PACKET_SIZE
+#define MAX_PACKET_SIZE 1000         /**< Максимальный размер пакета данных */
+#endif
+
+#ifndef MAX_HEADER_SIZE
+#define MAX_HEADER_SIZE 7            /**< Максимальный размер заголовка пакета */
+#endif
+
+#ifndef PARSER_COMPACT
+#define PARSER_COMPACT 0             /**< 1 - компактная сборка (узкие поля, без обнуления буферов) */
+#endif
+
+#ifndef PARSER_FAST_HEADER
+#define PARSER_FAST_HEADER 1         /**< 1 - разбирать заголовок за один шаг, если он целиком в FIFO */
+#endif
+
+#ifndef PARSER_PROFILE
+#define PARSER_PROFILE 0             /**< 1 - точки замера по стадиям (parser_profile.h) */
+#endif
+
+#ifndef PARSER_STATS_TYPE_BUCKETS
+#if PARSER_COMPACT
+#define PARSER_STATS_TYPE_BUCKETS 1  /**< В компактной сборке статистика по типам не раскладывается */
+#else
+#define PARSER_STATS_TYPE_BUCKETS 16 /**< Число корзин статистики по типу пакета (степень двойки) */
+#endif
+#endif
+
+#if SYNC_SEQUENCE_LENGTH < 1
+#error "SYNC_SEQUENCE_LENGTH должен быть не меньше 1"
+#endif
+
+#if MAX_PACKET_SIZE < 1
+#error "MAX_PACKET_SIZE должен быть положительным"
+#endif
+
+#if PARSER_COMPACT && MAX_PACKET_SIZE > 65535
+#error "В компактной сборке MAX_PACKET_SIZE не больше 65535"
+#endif
+
+#if PARSER_STATS_TYPE_BUCKETS < 1 || (PARSER_STATS_TYPE_BUCKETS & (PARSER_STATS_TYPE_BUCKETS - 1)) != 0
+#error "PARSER_STATS_TYPE_BUCKETS должен быть степенью двойки"
+#endif
+
+#ifdef PARSER_VARIANT
+#include "parser_names.h"
+#endif
+
+#endif // PARSER_CONFIG_H
@@ -0,0 +1,116 @@
+/**
+ * @file parser_events.c
+ * @brief Реализация кольца событий парсера.
+ *
+ * Ограниченная очередь Вьюкова: у каждой ячейки есть счётчик хода, писатели
+ * и читатели занимают позиции через compare-and-swap. Счётчик хранится со
+ * смещением на индекс ячейки, чтобы нулевая память уже была пустым кольцом.
+ */
+#include "parser_events.h"
+#include <string.h>
+
+#define RING_MASK (PARSER_EVENT_RING_CAPACITY - 1)
+
+static ParserEventRing default_ring;
+
+void parser_event_ring_init(ParserEventRing *ring) {
+    memset(ring, 0, sizeof(*ring));
+}
+
+int parser_event_ring_push(ParserEventRing *ring, const ParserEvent *event) {
+    size_t pos = atomic_load_explicit(&ring->enqueue_pos, memory_order_relaxed);
+    for (;;) {
+        size_t index = pos & RING_MASK;
+        size_t turn = atomic_load_explicit(&ring->cells[index].turn, memory_order_acquire) + index;
+        intptr_t diff = (intptr_t)turn - (intptr_t)pos;
+        if (diff == 0) {
+            // Ячейка свободна для этой позиции, пробуем её занять
+            if (atomic_compare_exchange_weak_explicit(&ring->enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                ring->cells[index].event = *event;
+                atomic_store_explicit(&ring->cells[index].turn, pos + 1 - index, memory_order_release);
+                return 0;
+            }
+        } else if (diff < 0) {
+            // Кольцо заполнено: запись отбрасывается, парсер не ждёт
+            atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+            return -1;
+        } else {
+            pos = atomic_load_explicit(&ring->enqueue_pos, memory_order_relaxed);
+        }
+    }
+}
+
+int parser_event_ring_pop(ParserEventRing *ring, ParserEvent *event) {
+    size_t pos = atomic_load_explicit(&ring->dequeue_pos, memory_order_relaxed);
+    for (;;) {
+        size_t index = pos & RING_MASK;
+        size_t turn = atomic_load_explicit(&ring->cells[index].turn, memory_order_acquire) + index;
+        intptr_t diff = (intptr_t)turn - (intptr_t)(pos + 1);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&ring->dequeue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                *event = ring->cells[index].event;
+                atomic_store_explicit(&ring->cells[index].turn, pos + PARSER_EVENT_RING_CAPACITY - index,
+                                      memory_order_release);
+                return 0;
+            }
+        } else if (diff < 0) {
+            return -1; // Пусто
+        } else {
+            pos = atomic_load_explicit(&ring->dequeue_pos, memory_order_relaxed);
+        }
+    }
+}
+
+void parser_event_ring_post(void *context, const ParserEvent *event) {
+    parser_event_ring_push((ParserEventRing *)context, event);
+}
+
+ParserEventRing *parser_event_default_ring(void) {
+    return &default_ring;
+}
+
+int parser_event_format(const ParserEvent *event, char *buffer, size_t capacity) {
+    switch (event->code) {
+        case PARSER_EVENT_CHECKSUM_MISMATCH:
+            return snprintf(buffer, capacity, "Error: Header checksum mismatch. Expected: %02X, Received: %02X",
+                            event->expected, event->received);
+        case PARSER_EVENT_OVERSIZE:
+            return snprintf(buffer, capacity, "Error: Data size exceeds maximum limit (%u bytes).", event->size);
+        case PARSER_EVENT_BODY_OVERFLOW:
+            return snprintf(buffer, capacity, "Error: Body buffer overflow.");
+        case PARSER_EVENT_PACKET: {
+            int length = snprintf(buffer, capacity, "Packet Received: type %u, size %u bytes, data:", event->type,
+                                  event->size);
+            for (unsigned int i = 0; i < event->preview_length && length >= 0 && (size_t)length < capacity; i++) {
+                length += snprintf(buffer + length, capacity - (size_t)length, " %02X", event->preview[i]);
+            }
+            if (event->preview_length < event->size && length >= 0 && (size_t)length < capacity) {
+                length += snprintf(buffer + length, capacity - (size_t)length, " ...");
+            }
+            return length;
+        }
+        case PARSER_EVENT_TIMEOUT:
+            return snprintf(buffer, capacity, "Error: Partial packet abandoned after inter-byte timeout (type %u, size %u).",
+                            event->type, event->size);
+        default:
+            return snprintf(buffer, capacity, "Unknown parser event %d", (int)event->code);
+    }
+}
+
+size_t parser_event_ring_drain(ParserEventRing *ring, FILE *out) {
+    ParserEvent event;
+    char line[128];
+    size_t count = 0;
+    while (parser_event_ring_pop(ring, &event) == 0) {
+        parser_event_format(&event, line, sizeof(line));
+        fprintf(out, "%s\n", line);
+        count++;
+    }
+    size_t dropped = atomic_exchange_explicit(&ring->dropped, 0, memory_order_relaxed);
+    if (dropped > 0) {
+        fprintf(out, "Warning: %zu parser events dropped\n", dropped);
+    }
+    return count;
+}
@@ -0,0 +1,150 @@
+/**
+ * @file parser_events.h
+ * @brief Неблокирующий канал событий и ошибок парсера.
+ *
+ * Парсер не выполняет ввод-вывод: об ошибках он сообщает структурированными
+ * записями ParserEvent через обратный вызов ParserEventCallback. По умолчанию
+ * записи складываются в общее lock-free кольцо, которое вычитывает и печатает
+ * отдельный поток (или основной цикл) вызовом parser_event_ring_drain.
+ */
+#ifndef PARSER_EVENTS_H
+#define PARSER_EVENTS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "parser_atomic.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef PARSER_EVENT_RING_CAPACITY
+#define PARSER_EVENT_RING_CAPACITY 256 /**< Ёмкость кольца событий (степень двойки) */
+#endif
+
+#if (PARSER_EVENT_RING_CAPACITY & (PARSER_EVENT_RING_CAPACITY - 1)) != 0
+#error "PARSER_EVENT_RING_CAPACITY должен быть степенью двойки"
+#endif
+
+#define PARSER_EVENT_PREVIEW_SIZE 8 /**< Сколько первых байтов тела сохраняется в записи */
+
+/**
+ * @enum ParserEventCode
+ * @brief Вид события.
+ */
+typedef enum {
+    PARSER_EVENT_CHECKSUM_MISMATCH, /**< Контрольная сумма заголовка не совпала */
+    PARSER_EVENT_OVERSIZE,          /**< Размер данных превышает MAX_PACKET_SIZE */
+    PARSER_EVENT_BODY_OVERFLOW,     /**< Переполнение буфера тела */
+    PARSER_EVENT_PACKET,            /**< Информационная запись о принятом пакете */
+    PARSER_EVENT_TIMEOUT            /**< Недополученный пакет брошен по таймауту между поступлениями */
+} ParserEventCode;
+
+/**
+ * @struct ParserEvent
+ * @brief Структурированная запись о событии парсера.
+ */
+typedef struct {
+    ParserEventCode code;        /**< Вид события */
+    const void *source;          /**< Парсер, породивший событие (только для идентификации) */
+    unsigned int type;           /**< Тип пакета */
+    unsigned int size;           /**< Размер данных пакета */
+    unsigned char expected;      /**< Вычисленная контрольная сумма */
+    unsigned char received;      /**< Принятая контрольная сумма */
+    unsigned char preview_length;                       /**< Число байтов в preview */
+    unsigned char preview[PARSER_EVENT_PREVIEW_SIZE];   /**< Первые байты тела */
+} ParserEvent;
+
+/**
+ * @brief Тип функции обратного вызова для событий.
+ *
+ * Вызывается прямо из parse_uart, поэтому не должна блокироваться.
+ *
+ * @param context Контекст, переданный при установке обработчика.
+ * @param event Указатель на запись события (действителен только во время вызова).
+ */
+typedef void (*ParserEventCallback)(void *context, const ParserEvent *event);
+
+/**
+ * @struct ParserEventRing
+ * @brief Ограниченная lock-free очередь записей (много писателей, много читателей).
+ *
+ * Нулевая инициализация даёт пустое кольцо, поэтому его можно объявить
+ * статически без вызова функции инициализации.
+ */
+typedef struct {
+    struct {
+        parser_atomic_size_t turn;  /**< Номер хода ячейки относительно её индекса */
+        ParserEvent event;       /**< Запись */
+    } cells[PARSER_EVENT_RING_CAPACITY];
+    parser_atomic_size_t enqueue_pos;   /**< Позиция следующей записи */
+    parser_atomic_size_t dequeue_pos;   /**< Позиция следующего чтения */
+    parser_atomic_size_t dropped;       /**< Записи, отброшенные из-за переполнения */
+} ParserEventRing;
+
+/**
+ * @brief Инициализирует кольцо событий.
+ *
+ * @param ring Указатель на кольцо.
+ */
+void parser_event_ring_init(ParserEventRing *ring);
+
+/**
+ * @brief Помещает запись в кольцо, не блокируясь.
+ *
+ * @param ring Указатель на кольцо.
+ * @param event Указатель на запись.
+ * @return Возвращает 0 при успехе, -1 если кольцо заполнено (запись отброшена и учтена в dropped).
+ */
+int parser_event_ring_push(ParserEventRing *ring, const ParserEvent *event);
+
+/**
+ * @brief Извлекает запись из кольца, не блокируясь.
+ *
+ * @param ring Указатель на кольцо.
+ * @param event Указатель на структуру для записи.
+ * @return Возвращает 0 при успехе, -1 если кольцо пусто.
+ */
+int parser_event_ring_pop(ParserEventRing *ring, ParserEvent *event);
+
+/**
+ * @brief Обработчик событий, помещающий их в кольцо.
+ *
+ * @param context Указатель на ParserEventRing.
+ * @param event Указатель на запись.
+ */
+void parser_event_ring_post(void *context, const ParserEvent *event);
+
+/**
+ * @brief Возвращает общее кольцо, используемое парсерами по умолчанию.
+ */
+ParserEventRing *parser_event_default_ring(void);
+
+/**
+ * @brief Форматирует запись в строку.
+ *
+ * @param event Указатель на запись.
+ * @param buffer Буфер для строки.
+ * @param capacity Размер буфера.
+ * @return Длина строки, как у snprintf.
+ */
+int parser_event_format(const ParserEvent *event, char *buffer, size_t capacity);
+
+/**
+ * @brief Вычитывает все накопленные записи и печатает их.
+ *
+ * Предназначена для отдельного потока или основного цикла; парсеры в это
+ * время могут продолжать писать в кольцо.
+ *
+ * @param ring Указатель на кольцо.
+ * @param out Поток вывода.
+ * @return Количество выведенных записей.
+ */
+size_t parser_event_ring_drain(ParserEventRing *ring, FILE *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PARSER_EVENTS_H
@@ -0,0 +1,21 @@
+/**
+ * @file parser_latency.c
+ * @brief Инициализация и вывод трассировки задержек парсера.
+ */
+#include "parser_latency.h"
+
+void parser_latency_init(ParserLatency *latency, MonotonicClockFn clock, void *context) {
+    latency->clock = clock;
+    latency->clock_context = context;
+    latency->arrival_time = 0;
+    latency->header_time = 0;
+    latency_histogram_init(&latency->arrival_to_header);
+    latency_histogram_init(&latency->header_to_callback);
+    latency_histogram_init(&latency->arrival_to_callback);
+}
+
+void parser_latency_dump(const ParserLatency *latency, FILE *out) {
+    latency_histogram_dump(&latency->arrival_to_header, "arrival -> header", out);
+    latency_histogram_dump(&latency->header_to_callback, "header -> callback", out);
+    latency_histogram_dump(&latency->arrival_to_callback, "arrival -> callback", out);
+}
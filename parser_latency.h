@@ -0,0 +1,60 @@
+/**
+ * @file parser_latency.h
+ * @brief Трассировка задержки пакета от поступления в FIFO до обработчика.
+ *
+ * Для каждого пакета фиксируются три момента: поступление первого байта
+ * синхропоследовательности в FIFO (по отметкам write_fifo, см.
+ * fifo_enable_timestamps), успешная проверка заголовка и вызов обработчика.
+ * Разности копятся в лог-линейных гистограммах.
+ */
+#ifndef PARSER_LATENCY_H
+#define PARSER_LATENCY_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "latency_histogram.h"
+#include "monotonic_clock.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @struct ParserLatency
+ * @brief Состояние трассировки задержек одного парсера.
+ */
+typedef struct {
+    MonotonicClockFn clock;                /**< Источник времени */
+    void *clock_context;                   /**< Контекст источника времени */
+    uint64_t arrival_time;                 /**< Поступление первого байта текущего пакета в FIFO */
+    uint64_t header_time;                  /**< Момент проверки заголовка текущего пакета */
+    LatencyHistogram arrival_to_header;    /**< Поступление -> заголовок проверен */
+    LatencyHistogram header_to_callback;   /**< Заголовок проверен -> вызов обработчика */
+    LatencyHistogram arrival_to_callback;  /**< Поступление -> вызов обработчика */
+} ParserLatency;
+
+/**
+ * @brief Инициализирует трассировку задержек.
+ *
+ * Если FIFO парсера не ведёт отметок времени, за момент поступления
+ * принимается момент, когда парсер увидел первый байт синхропоследовательности.
+ *
+ * @param latency Указатель на структуру трассировки.
+ * @param clock Источник монотонного времени (тот же, что у FIFO).
+ * @param context Контекст источника времени.
+ */
+void parser_latency_init(ParserLatency *latency, MonotonicClockFn clock, void *context);
+
+/**
+ * @brief Печатает все три гистограммы.
+ *
+ * @param latency Указатель на структуру трассировки.
+ * @param out Поток вывода.
+ */
+void parser_latency_dump(const ParserLatency *latency, FILE *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PARSER_LATENCY_H
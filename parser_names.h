@@ -0,0 +1,44 @@
+/**
+ * @file parser_names.h
+ * @brief Переименование внешних символов парсера для варианта PARSER_VARIANT.
+ *
+ * Подключается из parser_config.h. Например, при PARSER_VARIANT=family_b
+ * функция parse_uart становится family_b_parse_uart, а тип Parser -
+ * family_b_Parser. Код, написанный против обычного API, в единице
+ * трансляции варианта автоматически обращается к его символам.
+ *
+ * При добавлении новой внешней функции в parser.c её имя нужно добавить сюда.
+ */
+#ifndef PARSER_NAMES_H
+#define PARSER_NAMES_H
+
+#define PARSER_CAT_(a, b) a##_##b
+#define PARSER_CAT(a, b) PARSER_CAT_(a, b)
+#define PARSER_NAME(name) PARSER_CAT(PARSER_VARIANT, name)
+
+#define Parser                   PARSER_NAME(Parser)
+#define init_parser              PARSER_NAME(init_parser)
+#define decode_variable_length   PARSER_NAME(decode_variable_length)
+#define calculate_checksum       PARSER_NAME(calculate_checksum)
+#define parse_uart               PARSER_NAME(parse_uart)
+#define parser_next_packet       PARSER_NAME(parser_next_packet)
+#define parser_bytes_needed      PARSER_NAME(parser_bytes_needed)
+#define encode_variable_length   PARSER_NAME(encode_variable_length)
+#define build_packet             PARSER_NAME(build_packet)
+#define packet_received_callback PARSER_NAME(packet_received_callback)
+#define parser_stats_snapshot    PARSER_NAME(parser_stats_snapshot)
+#define parser_stats_reset       PARSER_NAME(parser_stats_reset)
+#define parser_set_handler       PARSER_NAME(parser_set_handler)
+#define parser_set_event_sink    PARSER_NAME(parser_set_event_sink)
+#define parser_set_latency       PARSER_NAME(parser_set_latency)
+#define parser_type_filter_init  PARSER_NAME(parser_type_filter_init)
+#define parser_type_filter_set   PARSER_NAME(parser_type_filter_set)
+#define parser_type_filter_accepts PARSER_NAME(parser_type_filter_accepts)
+#define parser_set_type_filter   PARSER_NAME(parser_set_type_filter)
+#define parser_set_timeout       PARSER_NAME(parser_set_timeout)
+#define parser_tick              PARSER_NAME(parser_tick)
+#define parser_checkpoint_size   PARSER_NAME(parser_checkpoint_size)
+#define parser_checkpoint_save   PARSER_NAME(parser_checkpoint_save)
+#define parser_checkpoint_restore PARSER_NAME(parser_checkpoint_restore)
+
+#endif // PARSER_NAMES_H
@@ -0,0 +1,278 @@
+/**
+ * @file parser_profile.c
+ * @brief Реестр счётчиков потоков и экспорт в формате Prometheus.
+ */
+#define _GNU_SOURCE
+#include "parser_profile.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "monotonic_clock.h"
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+_Thread_local ParserProfileSlot *parser_profile_active;
+
+static _Thread_local ParserProfileSlot *g_thread_slot;
+static ParserProfileSlot *g_slots;
+static int g_slot_count;
+static pthread_mutex_t g_registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static _Atomic unsigned int g_sample_every = 16;
+
+static const char *const g_stage_names[PARSER_PROFILE_STAGE_COUNT] = {
+    "sync", "header", "body", "callback", "fifo_write"
+};
+static const char *const g_call_names[PARSER_PROFILE_CALL_COUNT] = {"parse", "fifo_write"};
+
+// Счётчики потока создаются при первом вызове и живут до конца процесса
+static ParserProfileSlot *thread_slot(void) {
+    ParserProfileSlot *slot = g_thread_slot;
+    if (slot != NULL) {
+        return slot;
+    }
+    // Размер кратен строке кэша, чтобы соседние потоки не делили строки
+    size_t size = (sizeof(ParserProfileSlot) + 63) / 64 * 64;
+    slot = aligned_alloc(64, size);
+    if (slot == NULL) {
+        return NULL;
+    }
+    memset(slot, 0, size);
+    slot->stage = PARSER_PROFILE_IDLE;
+    pthread_mutex_lock(&g_registry_lock);
+    slot->index = g_slot_count++;
+    snprintf(slot->name, sizeof(slot->name), "thread-%d", slot->index);
+    slot->next = g_slots;
+    g_slots = slot;
+    pthread_mutex_unlock(&g_registry_lock);
+    g_thread_slot = slot;
+    return slot;
+}
+
+int parser_profile_begin(int call, int stage) {
+    ParserProfileSlot *slot;
+    unsigned int every;
+    if (parser_profile_active != NULL) {
+        parser_profile_mark(stage);
+        return 0;
+    }
+    slot = thread_slot();
+    if (slot == NULL) {
+        return 0;
+    }
+    parser_profile_add(&slot->calls[call], 1);
+    every = atomic_load_explicit(&g_sample_every, memory_order_relaxed);
+    if (every == 0 || slot->countdown[call]-- > 1) {
+        return 0;
+    }
+    slot->countdown[call] = every;
+    parser_profile_add(&slot->sampled[call], 1);
+    parser_profile_active = slot;
+    slot->stage = PARSER_PROFILE_IDLE;
+    parser_profile_mark(stage);
+    return 1;
+}
+
+void parser_profile_end(int owner) {
+    if (owner) {
+        parser_profile_mark(PARSER_PROFILE_IDLE);
+        parser_profile_active = NULL;
+    }
+}
+
+void parser_profile_set_sampling(unsigned int every) {
+    atomic_store(&g_sample_every, every);
+}
+
+void parser_profile_set_thread_name(const char *name) {
+    ParserProfileSlot *slot = thread_slot();
+    if (slot != NULL) {
+        strncpy(slot->name, name, sizeof(slot->name) - 1);
+        slot->name[sizeof(slot->name) - 1] = '\0';
+    }
+}
+
+void parser_profile_reset(void) {
+    pthread_mutex_lock(&g_registry_lock);
+    for (ParserProfileSlot *slot = g_slots; slot != NULL; slot = slot->next) {
+        for (int i = 0; i < PARSER_PROFILE_STAGE_COUNT; i++) {
+            atomic_store(&slot->ticks[i], 0);
+            atomic_store(&slot->entries[i], 0);
+        }
+        for (int i = 0; i < PARSER_PROFILE_CALL_COUNT; i++) {
+            atomic_store(&slot->calls[i], 0);
+            atomic_store(&slot->sampled[i], 0);
+        }
+    }
+    pthread_mutex_unlock(&g_registry_lock);
+}
+
+// Тактов в секунду: измеряется один раз по монотонным часам
+static double ticks_per_second(void) {
+    static double rate;
+    if (rate == 0.0) {
+        uint64_t start_ns = monotonic_clock_ns(NULL);
+        uint64_t start_ticks = parser_profile_ticks();
+        uint64_t elapsed_ns;
+        do {
+            elapsed_ns = monotonic_clock_ns(NULL) - start_ns;
+        } while (elapsed_ns < 10000000u);
+        rate = (double)(parser_profile_ticks() - start_ticks) * 1e9 / (double)elapsed_ns;
+    }
+    return rate;
+}
+
+static void write_family(FILE *out, const char *name, const char *type, const char *help) {
+    fprintf(out, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+int parser_profile_write_prometheus(FILE *out) {
+    ParserProfileSlot *slot;
+    double rate = ticks_per_second();
+    pthread_mutex_lock(&g_registry_lock);
+
+    write_family(out, "uart_parser_profile_ticks_total", "counter",
+                 "Ticks spent in each parser stage during sampled calls.");
+    for (slot = g_slots; slot != NULL; slot = slot->next) {
+        for (int i = 0; i < PARSER_PROFILE_STAGE_COUNT; i++) {
+            fprintf(out, "uart_parser_profile_ticks_total{thread=\"%s\",stage=\"%s\"} %llu\n", slot->name,
+                    g_stage_names[i], (unsigned long long)atomic_load_explicit(&slot->ticks[i], memory_order_relaxed));
+        }
+    }
+    write_family(out, "uart_parser_profile_stage_entries_total", "counter",
+                 "Entries into each parser stage during sampled calls.");
+    for (slot = g_slots; slot != NULL; slot = slot->next) {
+        for (int i = 0; i < PARSER_PROFILE_STAGE_COUNT; i++) {
+            fprintf(out, "uart_parser_profile_stage_entries_total{thread=\"%s\",stage=\"%s\"} %llu\n", slot->name,
+                    g_stage_names[i],
+                    (unsigned long long)atomic_load_explicit(&slot->entries[i], memory_order_relaxed));
+        }
+    }
+    write_family(out, "uart_parser_profile_calls_total", "counter", "Instrumented calls, sampled or not.");
+    for (slot = g_slots; slot != NULL; slot = slot->next) {
+        for (int i = 0; i < PARSER_PROFILE_CALL_COUNT; i++) {
+            fprintf(out, "uart_parser_profile_calls_total{thread=\"%s\",call=\"%s\"} %llu\n", slot->name,
+                    g_call_names[i], (unsigned long long)atomic_load_explicit(&slot->calls[i], memory_order_relaxed));
+        }
+    }
+    write_family(out, "uart_parser_profile_sampled_calls_total", "counter", "Instrumented calls that were timed.");
+    for (slot = g_slots; slot != NULL; slot = slot->next) {
+        for (int i = 0; i < PARSER_PROFILE_CALL_COUNT; i++) {
+            fprintf(out, "uart_parser_profile_sampled_calls_total{thread=\"%s\",call=\"%s\"} %llu\n", slot->name,
+                    g_call_names[i],
+                    (unsigned long long)atomic_load_explicit(&slot->sampled[i], memory_order_relaxed));
+        }
+    }
+    pthread_mutex_unlock(&g_registry_lock);
+
+    write_family(out, "uart_parser_profile_ticks_per_second", "gauge", "Tick counter frequency.");
+    fprintf(out, "uart_parser_profile_ticks_per_second %.0f\n", rate);
+    write_family(out, "uart_parser_profile_sample_every", "gauge", "One call in this many is timed (0 - none).");
+    fprintf(out, "uart_parser_profile_sample_every %u\n", atomic_load(&g_sample_every));
+    return ferror(out) ? -1 : 0;
+}
+
+int parser_profile_export_file(const char *path) {
+    char temporary[4096];
+    FILE *out;
+    int result;
+    if (snprintf(temporary, sizeof(temporary), "%s.tmp", path) >= (int)sizeof(temporary)) {
+        return -1;
+    }
+    out = fopen(temporary, "w");
+    if (out == NULL) {
+        return -1;
+    }
+    result = parser_profile_write_prometheus(out);
+    if (fclose(out) != 0 || result != 0 || rename(temporary, path) != 0) {
+        remove(temporary);
+        return -1;
+    }
+    return 0;
+}
+
+#ifndef _WIN32
+int parser_profile_listen(const char *path) {
+    struct sockaddr_un address;
+    int fd;
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        return -1;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    unlink(path);
+    if (bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(fd, 4) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int parser_profile_serve(int listen_fd) {
+    char request[1024];
+    char *body = NULL;
+    size_t length = 0;
+    FILE *out;
+    int client;
+    int result = 0;
+    struct timeval timeout;
+    client = accept(listen_fd, NULL, NULL);
+    if (client < 0) {
+        return -1;
+    }
+    // Молчащий или не читающий клиент не должен держать поток экспорта
+    timeout.tv_sec = PARSER_PROFILE_SERVE_TIMEOUT_MS / 1000;
+    timeout.tv_usec = (PARSER_PROFILE_SERVE_TIMEOUT_MS % 1000) * 1000;
+    if (setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) != 0 ||
+        setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout)) != 0) {
+        close(client);
+        return -1;
+    }
+    // Запрос не разбираем (на любой отдаётся снимок), но дочитываем заголовки:
+    // закрытие сокета с непрочитанными данными сбрасывает соединение у клиента
+    for (size_t received = 0; received < sizeof(request) - 1;) {
+        ssize_t count = recv(client, request + received, sizeof(request) - 1 - received, 0);
+        if (count <= 0) {
+            break;
+        }
+        received += (size_t)count;
+        request[received] = '\0';
+        if (strstr(request, "\r\n\r\n") != NULL || strstr(request, "\n\n") != NULL) {
+            break;
+        }
+    }
+    out = open_memstream(&body, &length);
+    if (out == NULL) {
+        close(client);
+        return -1;
+    }
+    fprintf(out, "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nConnection: close\r\n\r\n");
+    if (parser_profile_write_prometheus(out) != 0) {
+        result = -1;
+    }
+    fclose(out);
+    for (size_t sent = 0; result == 0 && sent < length;) {
+        ssize_t written = send(client, body + sent, length - sent, MSG_NOSIGNAL);
+        if (written <= 0) {
+            result = -1;
+            break;
+        }
+        sent += (size_t)written;
+    }
+    free(body);
+    close(client);
+    return result;
+}
+#endif
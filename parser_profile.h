@@ -0,0 +1,210 @@
+/**
+ * @file parser_profile.h
+ * @brief Профилирование горячего пути парсера по стадиям (сборка с PARSER_PROFILE).
+ *
+ * Точки замера стоят в parse_uart / parser_next_packet (поиск синхронизации,
+ * разбор заголовка, копирование тела, вызов обработчика) и в write_fifo /
+ * fifo_commit_write. Время байтовых функций чтения FIFO (read_fifo,
+ * peek_fifo, fifo_skip) входит в стадию, которая их вызывает: отдельный
+ * замер стоил бы дороже самих функций.
+ *
+ * Замеряется не каждый вызов, а каждый N-й (parser_profile_set_sampling):
+ * в незамеряемых вызовах стоимость - счётчик вызовов и одна проверка на
+ * точку. Время берётся из счётчика тактов (rdtsc на x86) или из
+ * monotonic_clock_ns на других архитектурах; число тактов в секунду
+ * экспортируется отдельной метрикой.
+ *
+ * Счётчики ведутся отдельно для каждого потока в собственных строках кэша
+ * и пишутся только им, поэтому потоки разбора не мешают друг другу.
+ * Снимок всех потоков выводится в текстовом формате Prometheus в файл
+ * (для textfile-коллектора node_exporter) или отдаётся через unix-сокет.
+ * Счётчики завершившихся потоков остаются в снимке.
+ *
+ * Заголовок только для C (C11: _Atomic, _Alignas, _Thread_local): его
+ * подключают реализация парсера и FIFO и инструменты на C, в публичные
+ * заголовки он не входит.
+ */
+#ifndef PARSER_PROFILE_H
+#define PARSER_PROFILE_H
+
+#ifdef __cplusplus
+#error "parser_profile.h - заголовок только для C"
+#endif
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include "monotonic_clock.h"
+#endif
+
+/**
+ * @enum ParserProfileStage
+ * @brief Стадии, между которыми делится время.
+ */
+typedef enum {
+    PARSER_PROFILE_SYNC,        /**< Поиск синхропоследовательности */
+    PARSER_PROFILE_HEADER,      /**< Разбор и проверка заголовка */
+    PARSER_PROFILE_BODY,        /**< Копирование (или пропуск) тела */
+    PARSER_PROFILE_CALLBACK,    /**< Вызов обработчика */
+    PARSER_PROFILE_FIFO_WRITE,  /**< Запись в FIFO */
+    PARSER_PROFILE_STAGE_COUNT,
+    PARSER_PROFILE_IDLE = PARSER_PROFILE_STAGE_COUNT /**< Вне замеряемого вызова */
+} ParserProfileStage;
+
+/**
+ * @enum ParserProfileCall
+ * @brief Замеряемые вызовы.
+ */
+typedef enum {
+    PARSER_PROFILE_CALL_PARSE,       /**< parse_uart и parser_next_packet */
+    PARSER_PROFILE_CALL_FIFO_WRITE,  /**< write_fifo и fifo_commit_write */
+    PARSER_PROFILE_CALL_COUNT
+} ParserProfileCall;
+
+/**
+ * @struct ParserProfileSlot
+ * @brief Счётчики одного потока.
+ *
+ * Пишет только поток-владелец (атомарные операции с relaxed-порядком
+ * компилируются в обычные mov), читает экспорт из любого потока.
+ */
+typedef struct ParserProfileSlot {
+    _Alignas(64) _Atomic uint64_t ticks[PARSER_PROFILE_STAGE_COUNT];   /**< Такты в стадиях (замеренные вызовы) */
+    _Atomic uint64_t entries[PARSER_PROFILE_STAGE_COUNT];              /**< Входы в стадии (замеренные вызовы) */
+    _Atomic uint64_t calls[PARSER_PROFILE_CALL_COUNT];                 /**< Все вызовы */
+    _Atomic uint64_t sampled[PARSER_PROFILE_CALL_COUNT];               /**< Замеренные вызовы */
+    uint64_t mark;                  /**< Такт начала текущей стадии */
+    int stage;                      /**< Текущая стадия (ParserProfileStage) */
+    unsigned int countdown[PARSER_PROFILE_CALL_COUNT]; /**< Вызовов до следующего замера по видам */
+    int index;                      /**< Порядковый номер потока */
+    char name[32];                  /**< Имя потока для метки thread */
+    struct ParserProfileSlot *next; /**< Следующий поток в реестре */
+} ParserProfileSlot;
+
+/** Счётчики потока, если текущий вызов замеряется, иначе NULL */
+extern _Thread_local ParserProfileSlot *parser_profile_active;
+
+/**
+ * @brief Текущее значение счётчика тактов.
+ */
+static inline uint64_t parser_profile_ticks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return monotonic_clock_ns(NULL);
+#endif
+}
+
+static inline void parser_profile_add(_Atomic uint64_t *counter, uint64_t value) {
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + value,
+                          memory_order_relaxed);
+}
+
+/**
+ * @brief Переключает стадию замеряемого вызова: время с прошлой отметки относится к прежней стадии.
+ *
+ * @param stage Новая стадия (ParserProfileStage).
+ */
+static inline void parser_profile_mark(int stage) {
+    ParserProfileSlot *slot = parser_profile_active;
+    if (slot != NULL && slot->stage != stage) {
+        uint64_t now = parser_profile_ticks();
+        if (slot->stage != PARSER_PROFILE_IDLE) {
+            parser_profile_add(&slot->ticks[slot->stage], now - slot->mark);
+        }
+        if (stage != PARSER_PROFILE_IDLE) {
+            parser_profile_add(&slot->entries[stage], 1);
+        }
+        slot->stage = stage;
+        slot->mark = now;
+    }
+}
+
+/**
+ * @brief Начало замеряемого вызова.
+ *
+ * Считает вызов и решает, замерять ли его. Вложенный вызов (например,
+ * write_fifo из кода, который сам замеряется) не начинает новый замер.
+ *
+ * @param call Вид вызова (ParserProfileCall).
+ * @param stage Стадия, с которой начинается вызов.
+ * @return 1, если вызов начал замер и должен закончить его parser_profile_end.
+ */
+int parser_profile_begin(int call, int stage);
+
+/**
+ * @brief Конец замеряемого вызова.
+ *
+ * @param owner Значение, которое вернул parser_profile_begin.
+ */
+void parser_profile_end(int owner);
+
+/**
+ * @brief Задаёт частоту замеров для всех потоков.
+ *
+ * @param every Замерять каждый every-й вызов (1 - все, 0 - не замерять). По умолчанию 16.
+ */
+void parser_profile_set_sampling(unsigned int every);
+
+/**
+ * @brief Задаёт имя текущего потока для метки thread (по умолчанию "thread-N").
+ *
+ * @param name Имя.
+ */
+void parser_profile_set_thread_name(const char *name);
+
+/**
+ * @brief Обнуляет счётчики всех потоков.
+ *
+ * Вызывать, когда потоки разбора не работают, иначе часть приращений может потеряться.
+ */
+void parser_profile_reset(void);
+
+/**
+ * @brief Выводит снимок счётчиков всех потоков в текстовом формате Prometheus.
+ *
+ * @param out Поток вывода.
+ * @return Возвращает 0 при успехе, -1 при ошибке вывода.
+ */
+int parser_profile_write_prometheus(FILE *out);
+
+/**
+ * @brief Записывает снимок в файл атомарно (через временный файл и rename).
+ *
+ * @param path Путь к файлу, например в каталоге textfile-коллектора.
+ * @return Возвращает 0 при успехе, -1 при ошибке.
+ */
+int parser_profile_export_file(const char *path);
+
+#ifndef _WIN32
+#ifndef PARSER_PROFILE_SERVE_TIMEOUT_MS
+#define PARSER_PROFILE_SERVE_TIMEOUT_MS 1000 /**< Ожидание запроса и отправки ответа в parser_profile_serve */
+#endif
+
+/**
+ * @brief Создаёт слушающий unix-сокет для экспорта.
+ *
+ * @param path Путь сокета (существующий файл заменяется).
+ * @return Дескриптор сокета или -1 при ошибке.
+ */
+int parser_profile_listen(const char *path);
+
+/**
+ * @brief Принимает одно подключение и отдаёт снимок как HTTP-ответ.
+ *
+ * Подходит для curl --unix-socket и прокси Prometheus; блокируется до
+ * подключения, поэтому вызывается из отдельного потока или после poll.
+ * Чтение запроса и отправка ответа ограничены PARSER_PROFILE_SERVE_TIMEOUT_MS:
+ * клиент, который подключился и молчит, не держит поток экспорта.
+ *
+ * @param listen_fd Дескриптор из parser_profile_listen.
+ * @return Возвращает 0 при успехе, -1 при ошибке.
+ */
+int parser_profile_serve(int listen_fd);
+#endif
+
+#endif // PARSER_PROFILE_H
@@ -0,0 +1,649 @@
+// Дифференциальная проверка быстрых путей разбора против эталона
+// (parser_stress_reference.h): parse_uart с разбором заголовка за один шаг,
+// запись через fifo_write_regions, parser_next_packet, фильтр типов,
+// uart::Parser из parser.hpp и MultiParser. Все пути получают один и тот же
+// случайный поток (traffic_gen.h) одними и теми же случайными порциями и
+// должны выдать ту же последовательность типов и размеров, что и эталон,
+// включая особенности parse_uart: лишний read_fifo при дочитывании тела и
+// контрольную сумму по младшим байтам size и type. Для parse_uart
+// сравниваются и счётчики ParserStats. Отдельно decode_variable_length
+// сверяется с форматом поля на всех парах байтов при разных положениях
+// головы FIFO.
+//
+// Растущий FIFO (fifo_set_pool) получает поток всплесками из нескольких
+// порций между вызовами parse_uart, больше кольца; эталон для него -
+// uart::Parser с FIFO на 64 КиБ, получающий те же всплески. Записи не
+// должны отказывать, а после разбора все сегменты должны вернуться в пул.
+//
+// Профили потока: чистый, широкие типы и размеры (заголовки с контрольной
+// суммой, не совпадающей из-за особенности, и слишком длинные тела), шум с
+// ложными синхропоследовательностями, поток без заполнителя. В конце
+// печатается пропускная способность каждого пути, чтобы ускорение было
+// видно вместе с доказательством совпадения.
+//
+// Компактная сборка и сборка с PARSER_FAST_HEADER=0 проверяются этим же
+// тестом в сборке с соответствующими параметрами CMake.
+//
+// Использование: parser_stress [rounds] [bytes] [seed]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "multi_parser.h"
+#include "parser.hpp"
+#include "parser_stress_reference.h"
+#include "traffic_gen.h"
+
+namespace {
+
+constexpr int kChannels = 19; // не кратно MULTI_PARSER_LANES: последняя группа неполная
+constexpr size_t kMaxChunk = MAX_FIFO_SIZE / 4 < 512 ? MAX_FIFO_SIZE / 4 : 512;
+constexpr size_t kMaxBurst = 64; // порций между вызовами parse_uart для растущего FIFO
+constexpr int kPoolSegments = static_cast<int>(kMaxBurst * kMaxChunk / FIFO_SEGMENT_SIZE) + 4;
+
+// Эталон для растущего FIFO: тот же автомат с FIFO, в который помещается любой всплеск
+struct BurstConfig : uart::DefaultConfig {
+    static constexpr std::size_t fifo_capacity = 1 << 16;
+};
+
+struct StreamProfile {
+    const char *name;
+    unsigned int type_max;
+    unsigned int size_max;
+    int padding;
+    double bit_error_rate;
+    double drop_rate;
+    double false_sync_rate;
+};
+
+const StreamProfile kProfiles[] = {
+    {"clean", 127, 64, 1, 0.0, 0.0, 0.0},
+    {"wide", 32767, MAX_PACKET_SIZE, 1, 0.0, 0.0, 0.0},
+    {"noisy", 255, 200, 1, 0.002, 0.001, 0.2},
+    {"no padding", 127, 64, 0, 0.0005, 0.0, 0.1},
+};
+
+struct Rng {
+    unsigned long long state;
+
+    unsigned long long next() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 2685821657736338717ull;
+    }
+
+    size_t below(size_t limit) { return static_cast<size_t>(next() % limit); }
+};
+
+struct PathTotals {
+    const char *name;
+    double seconds = 0.0;
+    size_t bytes = 0;
+    unsigned long long packets = 0;
+};
+
+enum Path { kReference, kParseUart, kRegions, kNextPacket, kFiltered, kCpp, kMulti, kGrowable, kPathCount };
+
+PathTotals g_totals[kPathCount] = {{"reference (byte-wise)"}, {"parse_uart"},      {"parse_uart, regions"},
+                                   {"parser_next_packet"},    {"parse_uart, filter"}, {"uart::Parser"},
+                                   {"MultiParser"},           {"parse_uart, growable"}};
+
+using Packets = std::vector<StressPacket>;
+
+StressPacket make_packet(unsigned int type, const unsigned char *data, unsigned int size) {
+    return StressPacket{type, size, stress_packet_hash(data, size)};
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void account(Path path, double seconds, size_t bytes, size_t packets) {
+    g_totals[path].seconds += seconds;
+    g_totals[path].bytes += bytes;
+    g_totals[path].packets += packets;
+}
+
+// Порции: четверть по одному байту, половина мелких, остальные до kMaxChunk
+std::vector<size_t> make_chunks(Rng &rng, size_t length) {
+    std::vector<size_t> chunks;
+    for (size_t offset = 0; offset < length;) {
+        size_t roll = rng.below(4);
+        size_t chunk = roll == 0 ? 1 : roll == 3 ? 1 + rng.below(kMaxChunk) : 1 + rng.below(16);
+        if (chunk > length - offset) {
+            chunk = length - offset;
+        }
+        chunks.push_back(chunk);
+        offset += chunk;
+    }
+    return chunks;
+}
+
+// body == false - тела не сравниваются (только тип и размер)
+bool same_packets(const char *path, const char *what, const Packets &expected, const Packets &actual,
+                  bool body = true) {
+    size_t n = expected.size() < actual.size() ? expected.size() : actual.size();
+    for (size_t i = 0; i < n; i++) {
+        if (expected[i].type != actual[i].type || expected[i].size != actual[i].size ||
+            (body && expected[i].hash != actual[i].hash)) {
+            std::printf("MISMATCH %s (%s): packet %zu: expected type %u size %u body %08x, "
+                        "got type %u size %u body %08x\n",
+                        path, what, i, expected[i].type, expected[i].size, static_cast<unsigned int>(expected[i].hash),
+                        actual[i].type, actual[i].size, static_cast<unsigned int>(actual[i].hash));
+            return false;
+        }
+    }
+    if (expected.size() != actual.size()) {
+        std::printf("MISMATCH %s (%s): expected %zu packets, got %zu\n", path, what, expected.size(), actual.size());
+        return false;
+    }
+    return true;
+}
+
+bool reference_run(const std::vector<unsigned char> &stream, const std::vector<size_t> &chunks, Packets &out,
+                   ParserStats &stats, const ParserTypeFilter *filter = nullptr) {
+    out.resize(stream.size() / (SYNC_SEQUENCE_LENGTH + 3) + 1);
+    StressPackets packets = {out.data(), 0, out.size()};
+    if (stress_reference_run(stream.data(), chunks.data(), chunks.size(), filter, &packets, &stats) != 0) {
+        std::printf("reference run failed\n");
+        return false;
+    }
+    out.resize(packets.count);
+    return true;
+}
+
+void record_packet(void *context, unsigned int type, unsigned char *data, unsigned int size) {
+    static_cast<Packets *>(context)->push_back(make_packet(type, data, size));
+}
+
+// Запись порции напрямую в свободные участки буфера, как при приёме через readv
+int write_regions(FIFO_Buffer *fifo, const unsigned char *data, int length) {
+    unsigned char *first;
+    unsigned char *second;
+    int first_length;
+    int second_length;
+    if (fifo_write_regions(fifo, &first, &first_length, &second, &second_length) < length) {
+        return -1;
+    }
+    int head = length < first_length ? length : first_length;
+    std::memcpy(first, data, static_cast<size_t>(head));
+    std::memcpy(second, data + head, static_cast<size_t>(length - head));
+    return fifo_commit_write(fifo, length);
+}
+
+bool run_parse_uart(const std::vector<unsigned char> &stream, const std::vector<size_t> &chunks, bool regions,
+                    const ParserTypeFilter *filter, Packets &out, ParserStats &stats) {
+    static FIFO_Buffer fifo;
+    static ::Parser parser;
+    size_t offset = 0;
+    std::memset(&parser, 0, sizeof(parser)); // В PARSER_COMPACT init_parser не очищает body прошлого прогона
+    init_fifo(&fifo);
+    init_parser(&parser, &fifo, nullptr);
+    parser_set_handler(&parser, record_packet, &out);
+    parser_set_event_sink(&parser, nullptr, nullptr);
+    parser_set_type_filter(&parser, filter);
+    out.clear();
+    for (size_t chunk : chunks) {
+        int length = static_cast<int>(chunk);
+        int result = regions ? write_regions(&fifo, &stream[offset], length)
+                             : write_fifo(&fifo, &stream[offset], length);
+        if (result != 0) {
+            std::printf("FIFO overflow at offset %zu\n", offset);
+            return false;
+        }
+        offset += chunk;
+        parse_uart(&parser);
+    }
+    stats = parser.stats;
+    return true;
+}
+
+bool run_next_packet(const std::vector<unsigned char> &stream, const std::vector<size_t> &chunks, Packets &out) {
+    static FIFO_Buffer fifo;
+    static ::Parser parser;
+    size_t offset = 0;
+    std::memset(&parser, 0, sizeof(parser)); // В PARSER_COMPACT init_parser не очищает body прошлого прогона
+    init_fifo(&fifo);
+    init_parser(&parser, &fifo, nullptr);
+    parser_set_event_sink(&parser, nullptr, nullptr);
+    out.clear();
+    for (size_t chunk : chunks) {
+        if (write_fifo(&fifo, &stream[offset], static_cast<int>(chunk)) != 0) {
+            std::printf("FIFO overflow at offset %zu\n", offset);
+            return false;
+        }
+        offset += chunk;
+        PacketView view;
+        while (parser_next_packet(&parser, &view)) {
+            out.push_back(make_packet(view.type, view.data, view.size));
+        }
+    }
+    return true;
+}
+
+bool run_cpp(const std::vector<unsigned char> &stream, const std::vector<size_t> &chunks, Packets &out) {
+    static uart::Fifo<MAX_FIFO_SIZE> fifo;
+    size_t offset = 0;
+    fifo = uart::Fifo<MAX_FIFO_SIZE>();
+    out.clear();
+    auto parser = uart::make_parser(fifo, [&out](unsigned int type, unsigned char *data, unsigned int size) {
+        out.push_back(make_packet(type, data, size));
+    });
+    for (size_t chunk : chunks) {
+        if (fifo.write(&stream[offset], static_cast<int>(chunk)) != 0) {
+            std::printf("FIFO overflow at offset %zu\n", offset);
+            return false;
+        }
+        offset += chunk;
+        parser.parse();
+    }
+    return true;
+}
+
+// Всплески: число порций, записываемых между вызовами разбора
+std::vector<size_t> make_bursts(Rng &rng, size_t chunk_count) {
+    std::vector<size_t> bursts;
+    for (size_t done = 0; done < chunk_count;) {
+        size_t burst = 1 + rng.below(kMaxBurst);
+        if (burst > chunk_count - done) {
+            burst = chunk_count - done;
+        }
+        bursts.push_back(burst);
+        done += burst;
+    }
+    return bursts;
+}
+
+bool run_cpp_bursts(const std::vector<unsigned char> &stream, const std::vector<size_t> &chunks,
+                    const std::vector<size_t> &bursts, Packets &out) {
+    static uart::Fifo<BurstConfig::fifo_capacity> fifo;
+    size_t offset = 0;
+    size_t next = 0;
+    fifo = uart::Fifo<BurstConfig::fifo_capacity>();
+    out.clear();
+    auto parser = uart::make_parser<BurstConfig>(fifo, [&out](unsigned int type, unsigned char *data, unsigned int size) {
+        out.push_back(make_packet(type, data, size));
+    });
+    for (size_t burst : bursts) {
+        for (size_t i = 0; i < burst; i++, next++) {
+            if (fifo.write(&stream[offset], static_cast<int>(chunks[next])) != 0) {
+                std::printf("FIFO overflow at offset %zu\n", offset);
+                return false;
+            }
+            offset += chunks[next];
+        }
+        parser.parse();
+    }
+    return true;
+}
+
+// Запись через участки растущего буфера: за кольцом участок - остаток последнего сегмента,
+// поэтому порция может занять несколько пар fifo_write_regions/fifo_commit_write
+int write_regions_growable(FIFO_Buffer *fifo, const unsigned char *data, int length) {
+    while (length > 0) {
+        unsigned char *first;
+        unsigned char *second;
+        int first_length;
+        int second_length;
+        int available = fifo_write_regions(fifo, &first, &first_length, &second, &second_length);
+        if (available == 0) {
+            return -1;
+        }
+        int count = length < available ? length : available;
+        int head = count < first_length ? count : first_length;
+        std::memcpy(first, data, static_cast<size_t>(head));
+        if (count > head) {
+            std::memcpy(second, data + head, static_cast<size_t>(count - head));
+        }
+        if (fifo_commit_write(fifo, count) != 0) {
+            return -1;
+        }
+        data += count;
+        length -= count;
+    }
+    return 0;
+}
+
+// Нечётные порции пишутся через участки, чётные - write_fifo
+bool run_growable(const std::vector<unsigned char> &stream, const std::vector<size_t> &chunks,
+                  const std::vector<size_t> &bursts, FifoPool *pool, Packets &out) {
+    static FIFO_Buffer fifo;
+    static ::Parser parser;
+    size_t offset = 0;
+    size_t next = 0;
+    std::memset(&parser, 0, sizeof(parser)); // В PARSER_COMPACT init_parser не очищает body прошлого прогона
+    init_fifo(&fifo);
+    fifo_set_pool(&fifo, pool, 0);
+    init_parser(&parser, &fifo, nullptr);
+    parser_set_handler(&parser, record_packet, &out);
+    parser_set_event_sink(&parser, nullptr, nullptr);
+    out.clear();
+    for (size_t burst : bursts) {
+        for (size_t i = 0; i < burst; i++, next++) {
+            int length = static_cast<int>(chunks[next]);
+            int result = next % 2 ? write_regions_growable(&fifo, &stream[offset], length)
+                                  : write_fifo(&fifo, &stream[offset], length);
+            if (result != 0) {
+                std::printf("growable FIFO write failed at offset %zu (%d segments in use)\n", offset, pool->in_use);
+                return false;
+            }
+            offset += chunks[next];
+        }
+        parse_uart(&parser);
+        if (pool->in_use != 0 || fifo.overflow != nullptr) {
+            std::printf("growable FIFO kept %d segments after parse_uart\n", pool->in_use);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Растущий FIFO на исчерпанном пуле: запись целиком или никак, байты не теряются и не дублируются
+bool check_pool_exhaustion() {
+    static FIFO_Buffer fifo;
+    FifoPool pool;
+    std::vector<unsigned char> data(MAX_FIFO_SIZE + 3 * FIFO_SEGMENT_SIZE);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = static_cast<unsigned char>(i * 131 + 7);
+    }
+    if (fifo_pool_init(&pool, 2) != 0) {
+        std::printf("fifo_pool_init failed\n");
+        return false;
+    }
+    init_fifo(&fifo);
+    fifo_set_pool(&fifo, &pool, 0);
+    bool ok = write_fifo(&fifo, data.data(), MAX_FIFO_SIZE - 1) == 0 &&
+              // Не хватает сегментов: кольцо не дописывается
+              write_fifo(&fifo, &data[MAX_FIFO_SIZE - 1], 2 + 2 * FIFO_SEGMENT_SIZE) == -1 &&
+              fifo.size == MAX_FIFO_SIZE - 1 && pool.in_use == 0 && pool.exhausted == 1 &&
+              write_fifo(&fifo, &data[MAX_FIFO_SIZE - 1], 1 + 2 * FIFO_SEGMENT_SIZE - 1) == 0 &&
+              fifo_total_size(&fifo) == MAX_FIFO_SIZE + 2 * FIFO_SEGMENT_SIZE - 1 && pool.in_use == 2 &&
+              write_fifo(&fifo, &data[MAX_FIFO_SIZE + 2 * FIFO_SEGMENT_SIZE - 1], 2) == -1 &&
+              write_fifo(&fifo, &data[MAX_FIFO_SIZE + 2 * FIFO_SEGMENT_SIZE - 1], 1) == 0 && pool.exhausted == 2 &&
+              fifo_set_pool(&fifo, nullptr, 0) == -1;
+    // Пропуск через границу кольца и сегментов, затем побайтовое чтение остатка
+    size_t position = 5;
+    ok = ok && fifo_skip(&fifo, 5) == 0;
+    ok = ok && fifo_skip(&fifo, MAX_FIFO_SIZE + FIFO_SEGMENT_SIZE / 2) == 0;
+    position += MAX_FIFO_SIZE + FIFO_SEGMENT_SIZE / 2;
+    for (unsigned char byte; ok && read_fifo(&fifo, &byte) == 0; position++) {
+        ok = byte == data[position];
+    }
+    ok = ok && position == MAX_FIFO_SIZE + 2 * FIFO_SEGMENT_SIZE && pool.in_use == 0 && fifo_total_size(&fifo) == 0;
+    // fifo_reset возвращает сегменты в пул
+    ok = ok && write_fifo(&fifo, data.data(), MAX_FIFO_SIZE + 1) == 0 && pool.in_use == 1;
+    fifo_reset(&fifo);
+    ok = ok && pool.in_use == 0 && fifo_total_size(&fifo) == 0 && pool.peak_in_use == 2;
+    fifo_pool_destroy(&pool);
+    if (!ok) {
+        std::printf("GROWABLE FIFO MISMATCH: exhausted pool check failed at byte %zu\n", position);
+    }
+    return ok;
+}
+
+void record_channel_packet(void *context, int channel, unsigned int type, unsigned char *data, unsigned int size) {
+    (*static_cast<std::vector<Packets> *>(context))[channel].push_back(make_packet(type, data, size));
+}
+
+// Поток делится на kChannels частей; каждый канал получает свою часть своими порциями,
+// за один опрос - не больше одной порции на канал
+bool check_multi(const std::vector<unsigned char> &stream, Rng &rng, const char *what) {
+    static FIFO_Buffer fifos[kChannels];
+    std::vector<std::vector<unsigned char>> slices(kChannels);
+    std::vector<std::vector<size_t>> chunks(kChannels);
+    std::vector<Packets> expected(kChannels);
+    std::vector<Packets> actual(kChannels);
+    size_t per_channel = stream.size() / kChannels;
+    size_t longest = 0;
+    for (int c = 0; c < kChannels; c++) {
+        ParserStats stats;
+        slices[c].assign(stream.begin() + static_cast<long>(c * per_channel),
+                         stream.begin() + static_cast<long>((c + 1) * per_channel));
+        chunks[c] = make_chunks(rng, per_channel);
+        if (!reference_run(slices[c], chunks[c], expected[c], stats)) {
+            return false;
+        }
+        longest = chunks[c].size() > longest ? chunks[c].size() : longest;
+    }
+
+    MultiParser multi;
+    if (multi_parser_init(&multi, kChannels, record_channel_packet, &actual) != 0) {
+        std::printf("multi_parser_init failed\n");
+        return false;
+    }
+    std::vector<size_t> offsets(kChannels, 0);
+    for (int c = 0; c < kChannels; c++) {
+        init_fifo(&fifos[c]);
+        multi_parser_attach(&multi, c, &fifos[c]);
+    }
+    auto start = std::chrono::steady_clock::now();
+    bool ok = true;
+    for (size_t step = 0; step < longest && ok; step++) {
+        for (int c = 0; c < kChannels; c++) {
+            if (step < chunks[c].size()) {
+                if (write_fifo(&fifos[c], &slices[c][offsets[c]], static_cast<int>(chunks[c][step])) != 0) {
+                    std::printf("FIFO overflow in channel %d\n", c);
+                    ok = false;
+                    break;
+                }
+                offsets[c] += chunks[c][step];
+            }
+        }
+        multi_parser_poll(&multi);
+    }
+    double seconds = seconds_since(start);
+    multi_parser_destroy(&multi);
+    size_t packets = 0;
+    for (int c = 0; c < kChannels && ok; c++) {
+        ok = same_packets(g_totals[kMulti].name, what, expected[c], actual[c]);
+        packets += actual[c].size();
+    }
+    account(kMulti, seconds, per_channel * kChannels, packets);
+    return ok;
+}
+
+bool check_round(const StreamProfile &profile, unsigned long long seed, size_t bytes) {
+    TrafficConfig config;
+    static TrafficGenerator generator;
+    traffic_default_config(&config);
+    config.seed = seed;
+    config.types.max = profile.type_max;
+    config.sizes.max = profile.size_max;
+    config.padding = profile.padding;
+    config.bit_error_rate = profile.bit_error_rate;
+    config.drop_rate = profile.drop_rate;
+    config.false_sync_rate = profile.false_sync_rate;
+    if (traffic_gen_init(&generator, &config) != 0) {
+        std::printf("invalid generator configuration for profile %s\n", profile.name);
+        return false;
+    }
+    std::vector<unsigned char> stream(bytes);
+    stream.resize(traffic_gen_fill(&generator, stream.data(), stream.size()));
+    Rng rng{seed * 0x9E3779B97F4A7C15ull + 1};
+    std::vector<size_t> chunks = make_chunks(rng, stream.size());
+    char what[64];
+    std::snprintf(what, sizeof(what), "%s, seed %llu", profile.name, seed);
+
+    Packets expected;
+    ParserStats expected_stats;
+    auto start = std::chrono::steady_clock::now();
+    if (!reference_run(stream, chunks, expected, expected_stats)) {
+        return false;
+    }
+    account(kReference, seconds_since(start), stream.size(), expected.size());
+    // Без искажений теряется не больше одного пакета, обрезанного концом потока
+    if (profile.bit_error_rate == 0.0 && profile.drop_rate == 0.0 && profile.false_sync_rate == 0.0 &&
+        profile.type_max < 128 && profile.size_max < 128 && expected.size() + 1 < generator.stats.packets) {
+        std::printf("REFERENCE LOST PACKETS (%s): %zu of %llu\n", what, expected.size(),
+                    static_cast<unsigned long long>(generator.stats.packets));
+        return false;
+    }
+
+    Packets actual;
+    ParserStats stats;
+    for (int regions = 0; regions <= 1; regions++) {
+        Path path = regions ? kRegions : kParseUart;
+        start = std::chrono::steady_clock::now();
+        if (!run_parse_uart(stream, chunks, regions, nullptr, actual, stats)) {
+            return false;
+        }
+        account(path, seconds_since(start), stream.size(), actual.size());
+        if (!same_packets(g_totals[path].name, what, expected, actual)) {
+            return false;
+        }
+        if (std::memcmp(&stats, &expected_stats, sizeof(stats)) != 0) {
+            std::printf("STATS MISMATCH %s (%s): resync %llu/%llu, sync hunt %llu/%llu, checksum %llu/%llu\n",
+                        g_totals[path].name, what, static_cast<unsigned long long>(expected_stats.resync_events),
+                        static_cast<unsigned long long>(stats.resync_events),
+                        static_cast<unsigned long long>(expected_stats.sync_hunt_bytes),
+                        static_cast<unsigned long long>(stats.sync_hunt_bytes),
+                        static_cast<unsigned long long>(expected_stats.checksum_failures),
+                        static_cast<unsigned long long>(stats.checksum_failures));
+            return false;
+        }
+    }
+
+    start = std::chrono::steady_clock::now();
+    if (!run_next_packet(stream, chunks, actual)) {
+        return false;
+    }
+    account(kNextPacket, seconds_since(start), stream.size(), actual.size());
+    if (!same_packets(g_totals[kNextPacket].name, what, expected, actual)) {
+        return false;
+    }
+
+    // Фильтр пропускает типы, не кратные трём: эталон с фильтром выдаёт ровно такие пакеты эталона
+    // без фильтра. Тела сверяются только с эталоном с фильтром: отброшенные пакеты не пишут в
+    // Parser::body, поэтому старые байты в телах следующих пакетов другие.
+    static ParserTypeFilter filter;
+    parser_type_filter_init(&filter, 1);
+    for (unsigned int type = 0; type < PARSER_TYPE_COUNT; type += 3) {
+        parser_type_filter_set(&filter, type, 0);
+    }
+    Packets accepted;
+    for (const StressPacket &packet : expected) {
+        if (parser_type_filter_accepts(&filter, packet.type)) {
+            accepted.push_back(packet);
+        }
+    }
+    Packets kept;
+    ParserStats kept_stats;
+    if (!reference_run(stream, chunks, kept, kept_stats, &filter) ||
+        !same_packets("reference, filter", what, accepted, kept, false)) {
+        return false;
+    }
+    start = std::chrono::steady_clock::now();
+    if (!run_parse_uart(stream, chunks, false, &filter, actual, stats)) {
+        return false;
+    }
+    account(kFiltered, seconds_since(start), stream.size(), actual.size());
+    if (!same_packets(g_totals[kFiltered].name, what, kept, actual)) {
+        return false;
+    }
+
+    start = std::chrono::steady_clock::now();
+    if (!run_cpp(stream, chunks, actual)) {
+        return false;
+    }
+    account(kCpp, seconds_since(start), stream.size(), actual.size());
+    if (!same_packets(g_totals[kCpp].name, what, expected, actual)) {
+        return false;
+    }
+
+    if (!check_multi(stream, rng, what)) {
+        return false;
+    }
+
+    static FifoPool pool;
+    if (pool.segments == nullptr && fifo_pool_init(&pool, kPoolSegments) != 0) {
+        std::printf("fifo_pool_init failed\n");
+        return false;
+    }
+    std::vector<size_t> bursts = make_bursts(rng, chunks.size());
+    if (!run_cpp_bursts(stream, chunks, bursts, expected)) {
+        return false;
+    }
+    start = std::chrono::steady_clock::now();
+    if (!run_growable(stream, chunks, bursts, &pool, actual)) {
+        return false;
+    }
+    account(kGrowable, seconds_since(start), stream.size(), actual.size());
+    return same_packets(g_totals[kGrowable].name, what, expected, actual);
+}
+
+// decode_variable_length против формата поля: все пары байтов, разные положения головы FIFO
+// (в том числе поле на стыке кольца) и неполное двухбайтовое поле, которое должно остаться в FIFO.
+// encode_variable_length для эталона не годится: при value >= 128 он не ставит старший бит
+// первого байта, и такие поля разбираются как однобайтовые (та же особенность у build_packet).
+bool check_decode() {
+    static FIFO_Buffer fifo;
+    static ::Parser parser;
+    init_fifo(&fifo);
+    init_parser(&parser, &fifo, nullptr);
+    for (unsigned int first = 0; first < 256; first++) {
+        for (unsigned int second = 0; second < (first < 128 ? 1u : 256u); second++) {
+            unsigned char field[2] = {static_cast<unsigned char>(first), static_cast<unsigned char>(second)};
+            int length = first < 128 ? 1 : 2;
+            unsigned int value = first < 128 ? first : (first - 128) + (second << 7);
+            unsigned int decoded = ~0u;
+            int head = static_cast<int>((first * 257u + second) % MAX_FIFO_SIZE);
+            init_fifo(&fifo);
+            fifo.head = head;
+            fifo.tail = head;
+            write_fifo(&fifo, field, length);
+            if (decode_variable_length(&fifo, &parser, &decoded) != 0 || decoded != value || fifo.size != 0) {
+                std::printf("DECODE MISMATCH: bytes %02X %02X at head %d decoded as %u, expected %u\n", first,
+                            second, head, decoded, value);
+                return false;
+            }
+            if (length == 2) {
+                unsigned char byte = 0;
+                init_fifo(&fifo);
+                fifo.head = head;
+                fifo.tail = head;
+                write_fifo(&fifo, field, 1);
+                if (decode_variable_length(&fifo, &parser, &decoded) != -1 || fifo.size != 1 || fifo.head != head ||
+                    peek_fifo(&fifo, 0, &byte) != 0 || byte != field[0]) {
+                    std::printf("DECODE MISMATCH: truncated field %02X at head %d was consumed\n", first, head);
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    int rounds = argc > 1 ? std::atoi(argv[1]) : 12;
+    size_t bytes = argc > 2 ? static_cast<size_t>(std::strtoull(argv[2], nullptr, 0)) : 256 * 1024;
+    unsigned long long seed = argc > 3 ? std::strtoull(argv[3], nullptr, 0) : 1;
+    const int profile_count = static_cast<int>(sizeof(kProfiles) / sizeof(kProfiles[0]));
+
+    if (!check_decode() || !check_pool_exhaustion()) {
+        return EXIT_FAILURE;
+    }
+    for (int round = 0; round < rounds; round++) {
+        if (!check_round(kProfiles[round % profile_count], seed + static_cast<unsigned long long>(round), bytes)) {
+            return EXIT_FAILURE;
+        }
+    }
+
+#if PARSER_COMPACT
+    const char *build = "compact";
+#else
+    const char *build = "default";
+#endif
+    std::printf("%d rounds x %zu bytes, seed %llu, %s build, fast header %s: all paths match the reference\n", rounds,
+                bytes, seed, build, PARSER_FAST_HEADER ? "on" : "off");
+    for (const PathTotals &path : g_totals) {
+        std::printf("%-22s %8.1f MB/s  %9llu packets\n", path.name,
+                    path.seconds > 0.0 ? static_cast<double>(path.bytes) / path.seconds / 1e6 : 0.0, path.packets);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,57 @@
+// Эталон для parser_stress: parser.c, собранный ещё раз с побайтовым разбором
+// заголовка (PARSER_FAST_HEADER=0) и без точек замера. Символы получают
+// префикс stress_reference_ так же, как у вариантов add_parser_variant,
+// поэтому эталон линкуется в один файл с основной библиотекой.
+
+#define PARSER_VARIANT stress_reference
+#undef PARSER_FAST_HEADER
+#define PARSER_FAST_HEADER 0
+#undef PARSER_PROFILE
+#define PARSER_PROFILE 0
+#include "parser.c"
+
+#include "parser_stress_reference.h"
+
+uint32_t stress_packet_hash(const unsigned char *data, unsigned int size) {
+    uint32_t hash = 2166136261u;
+    for (unsigned int i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static void record_packet(void *context, unsigned int type, unsigned char *data, unsigned int size) {
+    StressPackets *packets = (StressPackets *)context;
+    if (packets->count < packets->capacity) {
+        packets->items[packets->count].type = type;
+        packets->items[packets->count].size = size;
+        packets->items[packets->count].hash = stress_packet_hash(data, size);
+    }
+    packets->count++;
+}
+
+int stress_reference_run(const unsigned char *stream, const size_t *chunks, size_t chunk_count,
+                         const ParserTypeFilter *filter, StressPackets *packets, ParserStats *stats) {
+    static FIFO_Buffer fifo;
+    static Parser parser;
+    size_t offset = 0;
+    memset(&parser, 0, sizeof(parser)); // В PARSER_COMPACT init_parser не очищает body прошлого прогона
+    init_fifo(&fifo);
+    init_parser(&parser, &fifo, NULL);
+    parser_set_handler(&parser, record_packet, packets);
+    parser_set_event_sink(&parser, NULL, NULL);
+    parser_set_type_filter(&parser, filter);
+    packets->count = 0;
+    for (size_t i = 0; i < chunk_count; i++) {
+        // Запись по байту: эталон и для write_fifo порциями, и для fifo_write_regions
+        for (size_t j = 0; j < chunks[i]; j++) {
+            if (write_fifo(&fifo, stream + offset + j, 1) != 0) {
+                return -1;
+            }
+        }
+        offset += chunks[i];
+        parse_uart(&parser);
+    }
+    *stats = parser.stats;
+    return packets->count <= packets->capacity ? 0 : -1;
+}
@@ -0,0 +1,69 @@
+/**
+ * @file parser_stress_reference.h
+ * @brief Эталонный разбор для дифференциальной проверки parser_stress.
+ *
+ * Эталон - parser.c с побайтовым разбором заголовка (PARSER_FAST_HEADER=0),
+ * в который поток пишется по одному байту. Быстрые пути должны выдавать ту
+ * же последовательность пакетов на том же потоке с теми же точками разбора.
+ */
+#ifndef PARSER_STRESS_REFERENCE_H
+#define PARSER_STRESS_REFERENCE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "parser.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @struct StressPacket
+ * @brief Разобранный пакет: тип, размер и хеш тела.
+ */
+typedef struct {
+    unsigned int type; /**< Тип пакета */
+    unsigned int size; /**< Размер тела */
+    uint32_t hash;     /**< stress_packet_hash тела */
+} StressPacket;
+
+/**
+ * @struct StressPackets
+ * @brief Последовательность разобранных пакетов.
+ */
+typedef struct {
+    StressPacket *items; /**< Пакеты */
+    size_t count;        /**< Число пакетов (может превысить capacity) */
+    size_t capacity;     /**< Размер массива items */
+} StressPackets;
+
+/**
+ * @brief Хеш тела пакета (FNV-1a) для сравнения путей разбора.
+ *
+ * @param data Тело.
+ * @param size Размер тела.
+ * @return Хеш.
+ */
+uint32_t stress_packet_hash(const unsigned char *data, unsigned int size);
+
+/**
+ * @brief Разбирает поток эталоном.
+ *
+ * После каждой порции chunks[i] вызывается parse_uart.
+ *
+ * @param stream Поток.
+ * @param chunks Размеры порций (в сумме - длина потока).
+ * @param chunk_count Число порций.
+ * @param filter Фильтр типов (NULL - без фильтра).
+ * @param packets Результат.
+ * @param stats Счётчики эталонного парсера.
+ * @return Возвращает 0 при успехе или -1, если порция не поместилась в FIFO или пакетов больше capacity.
+ */
+int stress_reference_run(const unsigned char *stream, const size_t *chunks, size_t chunk_count,
+                         const ParserTypeFilter *filter, StressPackets *packets, ParserStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PARSER_STRESS_REFERENCE_H
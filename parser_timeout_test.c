@@ -0,0 +1,151 @@
+// Проверка таймаута между поступлениями (parser_set_timeout, parser_tick)
+// на поддельных часах: время двигает сам тест.
+//
+// - тело пакета оборвалось, перерыв длиннее порога: parser_tick бросает
+//   пакет, следующий целый пакет доставляется;
+// - перерывы короче порога: пакет не бросается и дописывается;
+// - перерыв длиннее порога, а проверка случилась в parse_uart вместе с
+//   новыми байтами: брошен только старый хвост, новый пакет доставляется.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "parser.h"
+
+#define TIMEOUT_NS 1000000u
+
+typedef struct {
+    unsigned int type[8];
+    unsigned int size[8];
+    int count;
+} Received;
+
+static uint64_t fake_now;
+static int failures;
+
+static uint64_t fake_clock(void *context) {
+    (void)context;
+    return fake_now;
+}
+
+static void record_packet(void *context, unsigned int type, unsigned char *data, unsigned int size) {
+    Received *received = (Received *)context;
+    (void)data;
+    if (received->count < 8) {
+        received->type[received->count] = type;
+        received->size[received->count] = size;
+    }
+    received->count++;
+}
+
+static void check(int condition, const char *what) {
+    if (!condition) {
+        printf("FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+// Пакет с байтом-заполнителем после тела: parse_uart дочитывает его
+static unsigned int make_packet(unsigned char *out, unsigned int size, unsigned int type) {
+    unsigned char body[MAX_PACKET_SIZE];
+    unsigned int length;
+    memset(body, 0x42, size);
+    build_packet(out, &length, size, type, body);
+    out[length] = 0x00;
+    return length + 1;
+}
+
+static void setup(FIFO_Buffer *fifo, Parser *parser, Received *received) {
+    memset(received, 0, sizeof(*received));
+    fake_now = 1000000000u;
+    init_fifo(fifo);
+    init_parser(parser, fifo, NULL);
+    parser_set_handler(parser, record_packet, received);
+    parser_set_event_sink(parser, NULL, NULL);
+    parser_set_timeout(parser, TIMEOUT_NS, fake_clock, NULL);
+}
+
+static void test_abandon_on_tick(void) {
+    static FIFO_Buffer fifo;
+    static Parser parser;
+    Received received;
+    unsigned char first[MAX_PACKET_SIZE + 16];
+    unsigned char second[MAX_PACKET_SIZE + 16];
+    unsigned int first_length = make_packet(first, 40, 5);
+    unsigned int second_length = make_packet(second, 30, 7);
+    setup(&fifo, &parser, &received);
+
+    write_fifo(&fifo, first, (int)first_length - 20);
+    parse_uart(&parser);
+    check(received.count == 0, "partial packet must not be delivered");
+    fake_now += TIMEOUT_NS / 2;
+    check(parser_tick(&parser) == 0, "tick before the threshold must not abandon");
+    fake_now += TIMEOUT_NS;
+    check(parser_tick(&parser) == 1, "tick after a long gap must abandon the partial packet");
+    check(parser.stats.timeouts == 1, "abandoned packet must be counted in stats.timeouts");
+    check(parser_tick(&parser) == 0, "idle parser in sync search must not time out again");
+
+    write_fifo(&fifo, second, (int)second_length);
+    parse_uart(&parser);
+    check(received.count == 1 && received.type[0] == 7 && received.size[0] == 30,
+          "packet after the abandoned one must be delivered");
+}
+
+static void test_short_gap(void) {
+    static FIFO_Buffer fifo;
+    static Parser parser;
+    Received received;
+    unsigned char packet[MAX_PACKET_SIZE + 16];
+    unsigned int length = make_packet(packet, 40, 5);
+    unsigned int first_split = length - 30;
+    unsigned int second_split = length - 10;
+    setup(&fifo, &parser, &received);
+
+    // Три части с перерывами чуть короче порога: каждый отсчитывается от разбора предыдущей
+    write_fifo(&fifo, packet, (int)first_split);
+    parse_uart(&parser);
+    fake_now += TIMEOUT_NS - 1;
+    check(parser_tick(&parser) == 0, "gap shorter than the threshold must not abandon");
+    write_fifo(&fifo, packet + first_split, (int)(second_split - first_split));
+    parse_uart(&parser);
+    fake_now += TIMEOUT_NS - 1;
+    check(parser_tick(&parser) == 0, "gap measured from the last arrival must not abandon");
+    write_fifo(&fifo, packet + second_split, (int)(length - second_split));
+    parse_uart(&parser);
+    check(received.count == 1 && received.type[0] == 5 && received.size[0] == 40,
+          "packet interrupted by short gaps must be delivered");
+    check(parser.stats.timeouts == 0, "short gaps must not count as timeouts");
+}
+
+static void test_abandon_on_arrival(void) {
+    static FIFO_Buffer fifo;
+    static Parser parser;
+    Received received;
+    unsigned char first[MAX_PACKET_SIZE + 16];
+    unsigned char second[MAX_PACKET_SIZE + 16];
+    unsigned int second_length = make_packet(second, 30, 7);
+    make_packet(first, 40, 5);
+    setup(&fifo, &parser, &received);
+
+    // Обрыв внутри заголовка: синхропоследовательность и байт размера
+    write_fifo(&fifo, first, SYNC_SEQUENCE_LENGTH + 1);
+    parse_uart(&parser);
+    fake_now += 2 * TIMEOUT_NS;
+    write_fifo(&fifo, second, (int)second_length);
+    parse_uart(&parser);
+    check(parser.stats.timeouts == 1, "late bytes must abandon the stalled header");
+    check(received.count == 1 && received.type[0] == 7 && received.size[0] == 30,
+          "packet arriving after the gap must be delivered");
+}
+
+int main(void) {
+    test_abandon_on_tick();
+    test_short_gap();
+    test_abandon_on_arrival();
+    if (failures != 0) {
+        return EXIT_FAILURE;
+    }
+    printf("parser timeout: all checks passed\n");
+    return EXIT_SUCCESS;
+}
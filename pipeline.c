@@ -0,0 +1,345 @@
+/**
+ * @file pipeline.c
+ * @brief Реализация конвейера приём -> разбор -> обработчики.
+ */
+#define _GNU_SOURCE
+#include "pipeline.h"
+
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Блок приёма: длина и данные
+typedef struct {
+    int length;
+    unsigned char data[];
+} Chunk;
+
+typedef struct {
+    Pipeline *pipeline;
+    int index;
+} WorkerArgs;
+
+#define WORKER_BATCH 16 // Пакетов, которые рабочий поток берёт из очереди типа за раз
+#define RX_IDLE_YIELDS 64 // Пустых чтений подряд с sched_yield, дальше - с паузой
+#define RX_IDLE_SLEEP_NS 100000
+
+static Chunk *chunk_at(Pipeline *pipeline, int index) {
+    size_t stride = sizeof(Chunk) + (size_t)pipeline->config.chunk_size;
+    return (Chunk *)(pipeline->chunk_memory + stride * (size_t)index);
+}
+
+// Закрепление потока за ядром (только Linux)
+static void pin_thread(pthread_t thread, int cpu) {
+#ifdef __linux__
+    if (cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        pthread_setaffinity_np(thread, sizeof(set), &set);
+    }
+#else
+    (void)thread;
+    (void)cpu;
+#endif
+}
+
+void pipeline_default_config(PipelineConfig *config) {
+    memset(config, 0, sizeof(*config));
+    config->worker_count = 2;
+    config->chunk_size = 256;
+    config->chunk_count = 64;
+    config->packet_count = 256;
+    config->preserve_type_order = 1;
+    config->shard_count = 0;
+    config->priority_classes = 0;
+    config->type_priority = NULL;
+    config->starvation_limit = 8;
+    config->rx_cpu = -1;
+    config->parse_cpu = -1;
+    config->worker_cpus = NULL;
+}
+
+static void *rx_main(void *arg) {
+    Pipeline *pipeline = (Pipeline *)arg;
+    for (;;) {
+        void *item;
+        if (bounded_queue_try_pop(&pipeline->free_chunks, &item) != 0) {
+            pipeline->stats.rx_waits++;
+            if (bounded_queue_pop(&pipeline->free_chunks, &item) != 0) {
+                break;
+            }
+        }
+        Chunk *chunk = (Chunk *)item;
+        int length = 0;
+        int idle = 0;
+        while (!atomic_load_explicit(&pipeline->stop, memory_order_relaxed)) {
+            length = pipeline->config.source(pipeline->config.source_context, chunk->data, pipeline->config.chunk_size);
+            if (length != 0) {
+                break;
+            }
+            // Неблокирующий источник без данных: уступаем ядро, а при долгом простое спим
+            if (idle++ < RX_IDLE_YIELDS) {
+                sched_yield();
+            } else {
+                nanosleep(&(struct timespec){0, RX_IDLE_SLEEP_NS}, NULL);
+            }
+        }
+        if (length <= 0 || atomic_load_explicit(&pipeline->stop, memory_order_relaxed)) {
+            bounded_queue_push(&pipeline->free_chunks, chunk);
+            break;
+        }
+        chunk->length = length;
+        pipeline->stats.rx_bytes += (uint64_t)length;
+        pipeline->stats.rx_chunks++;
+        bounded_queue_push(&pipeline->full_chunks, chunk);
+    }
+    bounded_queue_close(&pipeline->full_chunks);
+    return NULL;
+}
+
+// Обработчик парсера: копирует пакет в свободный слот и отдаёт рабочему потоку
+static void enqueue_packet(void *context, unsigned int type, unsigned char *data, unsigned int size) {
+    Pipeline *pipeline = (Pipeline *)context;
+    void *item;
+    if (bounded_queue_try_pop(&pipeline->free_packets, &item) != 0) {
+        pipeline->stats.parse_waits++;
+        bounded_queue_pop(&pipeline->free_packets, &item);
+    }
+    PipelinePacket *packet = (PipelinePacket *)item;
+    packet->type = type;
+    packet->size = size;
+    memcpy(packet->data, data, size);
+    pipeline->stats.packets_parsed++;
+
+    if (pipeline->config.priority_classes > 0) {
+        // Полная полоса задерживает разбор, но не пакеты других классов, уже стоящие в очередях
+        priority_lanes_push(&pipeline->lanes, type, packet);
+    } else if (pipeline->config.preserve_type_order) {
+        // Ёмкость очередей типов равна числу слотов, поэтому push не отказывает
+        type_dispatcher_push(&pipeline->dispatcher, type, packet);
+    } else {
+        bounded_queue_push(&pipeline->work_queue, packet);
+    }
+}
+
+// Очереди от разбора к рабочим потокам: закрытие завершает рабочие потоки
+static void close_work(Pipeline *pipeline) {
+    if (pipeline->config.priority_classes > 0) {
+        priority_lanes_close(&pipeline->lanes);
+    } else if (pipeline->config.preserve_type_order) {
+        type_dispatcher_close(&pipeline->dispatcher);
+    } else {
+        bounded_queue_close(&pipeline->work_queue);
+    }
+}
+
+static void destroy_work(Pipeline *pipeline) {
+    if (pipeline->config.priority_classes > 0) {
+        priority_lanes_destroy(&pipeline->lanes);
+    } else if (pipeline->config.preserve_type_order) {
+        type_dispatcher_destroy(&pipeline->dispatcher);
+    } else {
+        bounded_queue_destroy(&pipeline->work_queue);
+    }
+}
+
+static void *parse_main(void *arg) {
+    Pipeline *pipeline = (Pipeline *)arg;
+    void *item;
+    while (bounded_queue_pop(&pipeline->full_chunks, &item) == 0) {
+        Chunk *chunk = (Chunk *)item;
+        int offset = 0;
+        while (offset < chunk->length) {
+            // Пишем только в свободное место, поэтому write_fifo не отказывает
+            int free_space = MAX_FIFO_SIZE - pipeline->fifo.size;
+            int length = chunk->length - offset < free_space ? chunk->length - offset : free_space;
+            write_fifo(&pipeline->fifo, chunk->data + offset, length);
+            offset += length;
+            parse_uart(&pipeline->parser);
+        }
+        bounded_queue_push(&pipeline->free_chunks, chunk);
+    }
+    close_work(pipeline);
+    bounded_queue_close(&pipeline->free_chunks);
+    return NULL;
+}
+
+static void *worker_main(void *arg) {
+    WorkerArgs *args = (WorkerArgs *)arg;
+    Pipeline *pipeline = args->pipeline;
+    int index = args->index;
+    free(args);
+
+    void *items[WORKER_BATCH];
+    for (;;) {
+        int count;
+        if (pipeline->config.priority_classes > 0) {
+            // По одному пакету: приоритет пересматривается перед каждым
+            count = priority_lanes_pop(&pipeline->lanes, &items[0]) >= 0 ? 1 : 0;
+        } else if (pipeline->config.preserve_type_order) {
+            count = type_dispatcher_pop(&pipeline->dispatcher, index, items, WORKER_BATCH);
+        } else {
+            count = bounded_queue_pop(&pipeline->work_queue, &items[0]) == 0 ? 1 : 0;
+        }
+        if (count == 0) {
+            break;
+        }
+        for (int i = 0; i < count; i++) {
+            PipelinePacket *packet = (PipelinePacket *)items[i];
+            pipeline->config.handler(pipeline->config.handler_context, packet->type, packet->data, packet->size);
+            pipeline->worker_handled[index]++;
+            bounded_queue_push(&pipeline->free_packets, packet);
+        }
+    }
+    return NULL;
+}
+
+int pipeline_start(Pipeline *pipeline, const PipelineConfig *config) {
+    memset(pipeline, 0, sizeof(*pipeline));
+    pipeline->config = *config;
+    PipelineConfig *cfg = &pipeline->config;
+    if (cfg->source == NULL || cfg->handler == NULL || cfg->worker_count <= 0 || cfg->chunk_size <= 0 ||
+        cfg->chunk_count <= 0 || cfg->packet_count <= 0 || cfg->priority_classes < 0 ||
+        cfg->priority_classes > PRIORITY_MAX_CLASSES) {
+        return -1;
+    }
+    // У каждой полосы packet_count мест, и слотов хватает на все полосы и
+    // пакеты в обработке: разбор ждёт только места в полосе своего класса
+    int workers = 0;
+    int parse_started = 0;
+    int slots = cfg->priority_classes > 0 ? cfg->packet_count * cfg->priority_classes + cfg->worker_count
+                                          : cfg->packet_count;
+
+    size_t stride = sizeof(Chunk) + (size_t)cfg->chunk_size;
+    pipeline->chunk_memory = malloc(stride * (size_t)cfg->chunk_count);
+    pipeline->packets = malloc(sizeof(PipelinePacket) * (size_t)slots);
+    pipeline->worker_threads = calloc((size_t)cfg->worker_count, sizeof(pthread_t));
+    pipeline->worker_handled = calloc((size_t)cfg->worker_count, sizeof(uint64_t));
+    if (pipeline->chunk_memory == NULL || pipeline->packets == NULL ||
+        pipeline->worker_threads == NULL || pipeline->worker_handled == NULL) {
+        goto fail;
+    }
+    if (cfg->priority_classes > 0) {
+        if (priority_lanes_init(&pipeline->lanes, cfg->priority_classes, cfg->packet_count,
+                                cfg->starvation_limit) != 0) {
+            goto fail;
+        }
+        for (unsigned int type = 0; cfg->type_priority != NULL && type < PARSER_TYPE_COUNT; type++) {
+            if (priority_lanes_set_class(&pipeline->lanes, type, cfg->type_priority[type]) != 0) {
+                priority_lanes_destroy(&pipeline->lanes);
+                goto fail;
+            }
+        }
+    } else if (cfg->preserve_type_order) {
+        int shards = cfg->shard_count > 0 ? cfg->shard_count : 16 * cfg->worker_count;
+        if (type_dispatcher_init(&pipeline->dispatcher, cfg->worker_count, shards, cfg->packet_count) != 0) {
+            goto fail;
+        }
+    } else if (bounded_queue_init(&pipeline->work_queue, cfg->packet_count) != 0) {
+        goto fail;
+    }
+
+    if (bounded_queue_init(&pipeline->free_chunks, cfg->chunk_count) != 0) {
+        goto fail_work;
+    }
+    if (bounded_queue_init(&pipeline->full_chunks, cfg->chunk_count) != 0) {
+        goto fail_free_chunks;
+    }
+    if (bounded_queue_init(&pipeline->free_packets, slots) != 0) {
+        goto fail_full_chunks;
+    }
+    for (int i = 0; i < cfg->chunk_count; i++) {
+        bounded_queue_push(&pipeline->free_chunks, chunk_at(pipeline, i));
+    }
+    for (int i = 0; i < slots; i++) {
+        bounded_queue_push(&pipeline->free_packets, &pipeline->packets[i]);
+    }
+
+    init_fifo(&pipeline->fifo);
+    init_parser(&pipeline->parser, &pipeline->fifo, NULL);
+    parser_set_handler(&pipeline->parser, enqueue_packet, pipeline);
+
+    for (workers = 0; workers < cfg->worker_count; workers++) {
+        WorkerArgs *args = malloc(sizeof(WorkerArgs));
+        if (args == NULL) {
+            goto fail_threads;
+        }
+        args->pipeline = pipeline;
+        args->index = workers;
+        if (pthread_create(&pipeline->worker_threads[workers], NULL, worker_main, args) != 0) {
+            free(args);
+            goto fail_threads;
+        }
+        pin_thread(pipeline->worker_threads[workers], cfg->worker_cpus != NULL ? cfg->worker_cpus[workers] : -1);
+    }
+    if (pthread_create(&pipeline->parse_thread, NULL, parse_main, pipeline) != 0) {
+        goto fail_threads;
+    }
+    parse_started = 1;
+    pin_thread(pipeline->parse_thread, cfg->parse_cpu);
+    if (pthread_create(&pipeline->rx_thread, NULL, rx_main, pipeline) != 0) {
+        goto fail_threads;
+    }
+    pin_thread(pipeline->rx_thread, cfg->rx_cpu);
+    return 0;
+
+fail_threads:
+    // Без потока приёма: закрытие full_chunks завершает разбор, а он закрывает очереди рабочих потоков
+    bounded_queue_close(&pipeline->full_chunks);
+    if (parse_started) {
+        pthread_join(pipeline->parse_thread, NULL);
+    } else {
+        close_work(pipeline);
+    }
+    for (int i = 0; i < workers; i++) {
+        pthread_join(pipeline->worker_threads[i], NULL);
+    }
+    bounded_queue_destroy(&pipeline->free_packets);
+fail_full_chunks:
+    bounded_queue_destroy(&pipeline->full_chunks);
+fail_free_chunks:
+    bounded_queue_destroy(&pipeline->free_chunks);
+fail_work:
+    destroy_work(pipeline);
+fail:
+    free(pipeline->chunk_memory);
+    free(pipeline->packets);
+    free(pipeline->worker_threads);
+    free(pipeline->worker_handled);
+    return -1;
+}
+
+void pipeline_stop(Pipeline *pipeline) {
+    atomic_store_explicit(&pipeline->stop, 1, memory_order_relaxed);
+}
+
+void pipeline_wait(Pipeline *pipeline) {
+    pthread_join(pipeline->rx_thread, NULL);
+    pthread_join(pipeline->parse_thread, NULL);
+    for (int i = 0; i < pipeline->config.worker_count; i++) {
+        pthread_join(pipeline->worker_threads[i], NULL);
+        pipeline->stats.packets_handled += pipeline->worker_handled[i];
+    }
+
+    bounded_queue_destroy(&pipeline->free_chunks);
+    bounded_queue_destroy(&pipeline->full_chunks);
+    bounded_queue_destroy(&pipeline->free_packets);
+    if (pipeline->config.priority_classes > 0) {
+        for (int i = 0; i < pipeline->config.priority_classes; i++) {
+            pipeline->stats.lanes[i] = pipeline->lanes.lanes[i].stats;
+        }
+    } else if (pipeline->config.preserve_type_order) {
+        type_dispatcher_report(&pipeline->dispatcher, &pipeline->stats.dispatch);
+    }
+    destroy_work(pipeline);
+    free(pipeline->chunk_memory);
+    free(pipeline->packets);
+    free(pipeline->worker_threads);
+    free(pipeline->worker_handled);
+    pipeline->chunk_memory = NULL;
+    pipeline->packets = NULL;
+    pipeline->worker_threads = NULL;
+    pipeline->worker_handled = NULL;
+}
@@ -0,0 +1,163 @@
+/**
+ * @file pipeline.h
+ * @brief Многопоточный конвейер: приём -> разбор -> пул обработчиков.
+ *
+ * Поток приёма читает данные из источника в блоки, поток разбора
+ * выполняет parse_uart над своим FIFO_Buffer, а готовые пакеты исполняются
+ * пулом рабочих потоков. Стадии связаны ограниченными очередями
+ * (BoundedQueue), поэтому медленный обработчик задерживает только очередь
+ * пакетов, а приём продолжается, пока не исчерпаны блоки. Поток разбора
+ * записывает в FIFO не больше свободного места, и write_fifo не теряет данные.
+ *
+ * Если нужен порядок внутри типа, пакеты раздаются через TypeDispatcher:
+ * очереди типов закреплены за потоками, а свободный поток забирает целую
+ * очередь у загруженного, поэтому тяжёлые обработчики занимают все ядра.
+ *
+ * С классами приоритета (priority_classes > 0) пакеты раздаются через
+ * PriorityLanes: у каждого класса своя полоса, и рабочие потоки сначала
+ * берут пакеты высших классов, поэтому управляющие пакеты не ждут за
+ * всплеском телеметрии. Порядок внутри типа тогда сохраняется только при
+ * одном рабочем потоке.
+ */
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include "bounded_queue.h"
+#include "parser.h"
+#include "parser_atomic.h"
+#include "priority_lanes.h"
+#include "type_dispatch.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Источник данных для потока приёма.
+ *
+ * Источник может блокироваться до прихода данных. Неблокирующий источник
+ * возвращает 0; поток приёма тогда уступает ядро (sched_yield), а после
+ * долгого простоя повторяет чтение с паузой 100 мкс.
+ *
+ * @param context Контекст источника.
+ * @param buffer Буфер для данных.
+ * @param capacity Размер буфера.
+ * @return Число прочитанных байтов, 0 если данных пока нет, -1 если поток данных закончился.
+ */
+typedef int (*PipelineSource)(void *context, unsigned char *buffer, int capacity);
+
+/**
+ * @struct PipelineConfig
+ * @brief Параметры конвейера.
+ */
+typedef struct {
+    PipelineSource source;      /**< Источник данных */
+    void *source_context;       /**< Контекст источника */
+    PacketHandler handler;      /**< Обработчик пакетов (вызывается из рабочих потоков) */
+    void *handler_context;      /**< Контекст обработчика */
+    int worker_count;           /**< Число рабочих потоков */
+    int chunk_size;             /**< Размер блока приёма, байт */
+    int chunk_count;            /**< Число блоков между приёмом и разбором */
+    int packet_count;           /**< Число пакетов между разбором и обработчиками */
+    int preserve_type_order;    /**< 1 - пакеты одного типа обрабатываются по порядку, не параллельно */
+    int shard_count;            /**< Очередей типов при preserve_type_order (0 - 16 на рабочий поток) */
+    int priority_classes;       /**< Классов приоритета (0 - без приоритетов, иначе preserve_type_order не действует) */
+    const uint8_t *type_priority; /**< Класс каждого типа, PARSER_TYPE_COUNT значений (0 - высший; NULL - все в низшем) */
+    int starvation_limit;       /**< Обходов непустой полосы до выдачи вне очереди (0 - строгий приоритет) */
+    int rx_cpu;                 /**< Ядро для потока приёма (-1 - не закреплять) */
+    int parse_cpu;              /**< Ядро для потока разбора (-1 - не закреплять) */
+    const int *worker_cpus;     /**< Ядра рабочих потоков (NULL или worker_count значений, -1 - не закреплять) */
+} PipelineConfig;
+
+/**
+ * @struct PipelineStats
+ * @brief Счётчики конвейера (читать после pipeline_wait).
+ */
+typedef struct {
+    uint64_t rx_bytes;          /**< Принято байтов */
+    uint64_t rx_chunks;         /**< Принято блоков */
+    uint64_t rx_waits;          /**< Сколько раз приём ждал свободного блока */
+    uint64_t parse_waits;       /**< Сколько раз разбор ждал свободного места под пакет */
+    uint64_t packets_parsed;    /**< Пакетов разобрано */
+    uint64_t packets_handled;   /**< Пакетов обработано */
+    TypeDispatchReport dispatch; /**< Порядок и нагрузка при preserve_type_order */
+    PriorityLaneStats lanes[PRIORITY_MAX_CLASSES]; /**< Счётчики полос при priority_classes > 0 */
+} PipelineStats;
+
+/**
+ * @struct PipelinePacket
+ * @brief Пакет в очереди к обработчикам.
+ */
+typedef struct {
+    unsigned int type;                   /**< Тип пакета */
+    unsigned int size;                   /**< Размер данных */
+    unsigned char data[MAX_PACKET_SIZE]; /**< Данные пакета */
+} PipelinePacket;
+
+/**
+ * @struct Pipeline
+ * @brief Состояние конвейера.
+ */
+typedef struct {
+    PipelineConfig config;        /**< Параметры */
+    FIFO_Buffer fifo;             /**< FIFO потока разбора */
+    Parser parser;                /**< Парсер потока разбора */
+    BoundedQueue free_chunks;     /**< Свободные блоки приёма */
+    BoundedQueue full_chunks;     /**< Заполненные блоки для разбора */
+    BoundedQueue free_packets;    /**< Свободные слоты пакетов */
+    BoundedQueue work_queue;      /**< Общая очередь рабочих потоков, если порядок не нужен */
+    TypeDispatcher dispatcher;    /**< Очереди типов, если порядок нужен */
+    PriorityLanes lanes;          /**< Полосы классов приоритета */
+    unsigned char *chunk_memory;  /**< Память блоков приёма */
+    PipelinePacket *packets;      /**< Слоты пакетов */
+    pthread_t rx_thread;          /**< Поток приёма */
+    pthread_t parse_thread;       /**< Поток разбора */
+    pthread_t *worker_threads;    /**< Рабочие потоки */
+    parser_atomic_int stop;       /**< Запрос досрочной остановки */
+    PipelineStats stats;          /**< Счётчики стадий */
+    uint64_t *worker_handled;     /**< Пакетов обработано каждым рабочим потоком */
+} Pipeline;
+
+/**
+ * @brief Заполняет параметры значениями по умолчанию.
+ *
+ * Два рабочих потока, блоки по 256 байт, без закрепления за ядрами,
+ * порядок внутри типа сохраняется, без классов приоритета (при их
+ * включении полоса, обойдённая 8 раз, обслуживается вне очереди).
+ *
+ * @param config Указатель на параметры.
+ */
+void pipeline_default_config(PipelineConfig *config);
+
+/**
+ * @brief Запускает все потоки конвейера.
+ *
+ * @param pipeline Указатель на конвейер.
+ * @param config Параметры (копируются).
+ * @return Возвращает 0 при успехе, -1 при ошибке.
+ */
+int pipeline_start(Pipeline *pipeline, const PipelineConfig *config);
+
+/**
+ * @brief Просит конвейер остановиться, не дожидаясь конца источника.
+ *
+ * Уже принятые данные будут разобраны и обработаны.
+ *
+ * @param pipeline Указатель на конвейер.
+ */
+void pipeline_stop(Pipeline *pipeline);
+
+/**
+ * @brief Ждёт завершения всех потоков и освобождает ресурсы.
+ *
+ * @param pipeline Указатель на конвейер.
+ */
+void pipeline_wait(Pipeline *pipeline);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PIPELINE_H
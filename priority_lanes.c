@@ -0,0 +1,145 @@
+/**
+ * @file priority_lanes.c
+ * @brief Реализация очередей классов приоритета.
+ */
+#include "priority_lanes.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "monotonic_clock.h"
+
+static void free_lanes(PriorityLanes *lanes) {
+    for (int i = 0; i < PRIORITY_MAX_CLASSES; i++) {
+        free(lanes->lanes[i].items);
+        free(lanes->lanes[i].enqueued_at);
+        lanes->lanes[i].items = NULL;
+        lanes->lanes[i].enqueued_at = NULL;
+    }
+}
+
+int priority_lanes_init(PriorityLanes *lanes, int class_count, int capacity, int starvation_limit) {
+    memset(lanes, 0, sizeof(*lanes));
+    if (class_count <= 0 || class_count > PRIORITY_MAX_CLASSES || capacity <= 0 || starvation_limit < 0) {
+        return -1;
+    }
+    for (int i = 0; i < class_count; i++) {
+        lanes->lanes[i].items = malloc((size_t)capacity * sizeof(void *));
+        lanes->lanes[i].enqueued_at = malloc((size_t)capacity * sizeof(uint64_t));
+        if (lanes->lanes[i].items == NULL || lanes->lanes[i].enqueued_at == NULL) {
+            free_lanes(lanes);
+            return -1;
+        }
+    }
+    lanes->class_count = class_count;
+    lanes->capacity = capacity;
+    lanes->starvation_limit = starvation_limit;
+    memset(lanes->class_of, class_count - 1, sizeof(lanes->class_of));
+    pthread_mutex_init(&lanes->lock, NULL);
+    pthread_cond_init(&lanes->not_empty, NULL);
+    pthread_cond_init(&lanes->not_full, NULL);
+    return 0;
+}
+
+void priority_lanes_destroy(PriorityLanes *lanes) {
+    pthread_cond_destroy(&lanes->not_full);
+    pthread_cond_destroy(&lanes->not_empty);
+    pthread_mutex_destroy(&lanes->lock);
+    free_lanes(lanes);
+}
+
+int priority_lanes_set_class(PriorityLanes *lanes, unsigned int type, int priority_class) {
+    if (type >= PARSER_TYPE_COUNT || priority_class < 0 || priority_class >= lanes->class_count) {
+        return -1;
+    }
+    lanes->class_of[type] = (uint8_t)priority_class;
+    return 0;
+}
+
+int priority_lanes_push(PriorityLanes *lanes, unsigned int type, void *item) {
+    PriorityLane *lane = &lanes->lanes[lanes->class_of[type % PARSER_TYPE_COUNT]];
+    int slot;
+    pthread_mutex_lock(&lanes->lock);
+    if (lane->count == lanes->capacity && !lanes->closed) {
+        lane->stats.full_waits++;
+        while (lane->count == lanes->capacity && !lanes->closed) {
+            pthread_cond_wait(&lanes->not_full, &lanes->lock);
+        }
+    }
+    if (lanes->closed) {
+        pthread_mutex_unlock(&lanes->lock);
+        return -1;
+    }
+    slot = (lane->head + lane->count) % lanes->capacity;
+    lane->items[slot] = item;
+    lane->enqueued_at[slot] = monotonic_clock_ns(NULL);
+    lane->count++;
+    lane->stats.pushed++;
+    pthread_cond_signal(&lanes->not_empty);
+    pthread_mutex_unlock(&lanes->lock);
+    return 0;
+}
+
+// Выбор полосы (под мьютексом): самая приоритетная непустая, если никакая
+// другая не ждёт дольше starvation_limit
+static int pick_lane(PriorityLanes *lanes) {
+    int chosen = -1;
+    for (int i = 0; i < lanes->class_count; i++) {
+        const PriorityLane *lane = &lanes->lanes[i];
+        if (lane->count == 0) {
+            continue;
+        }
+        if (chosen < 0) {
+            chosen = i;
+        } else if (lanes->starvation_limit > 0 && lane->skipped >= lanes->starvation_limit) {
+            lanes->lanes[i].stats.starvation_grants++;
+            chosen = i;
+            break;
+        }
+    }
+    if (chosen >= 0) {
+        for (int i = 0; i < lanes->class_count; i++) {
+            if (i != chosen && lanes->lanes[i].count > 0) {
+                lanes->lanes[i].skipped++;
+            }
+        }
+        lanes->lanes[chosen].skipped = 0;
+    }
+    return chosen;
+}
+
+int priority_lanes_pop(PriorityLanes *lanes, void **item) {
+    PriorityLane *lane;
+    uint64_t wait;
+    int chosen;
+    pthread_mutex_lock(&lanes->lock);
+    while ((chosen = pick_lane(lanes)) < 0) {
+        if (lanes->closed) {
+            pthread_mutex_unlock(&lanes->lock);
+            return -1;
+        }
+        pthread_cond_wait(&lanes->not_empty, &lanes->lock);
+    }
+    lane = &lanes->lanes[chosen];
+    *item = lane->items[lane->head];
+    wait = monotonic_clock_ns(NULL) - lane->enqueued_at[lane->head];
+    lane->head = (lane->head + 1) % lanes->capacity;
+    lane->count--;
+    lane->stats.popped++;
+    lane->stats.wait_total_ns += wait;
+    if (wait > lane->stats.wait_max_ns) {
+        lane->stats.wait_max_ns = wait;
+    }
+    // Места в полосах ждёт только поток разбора
+    pthread_cond_signal(&lanes->not_full);
+    pthread_mutex_unlock(&lanes->lock);
+    return chosen;
+}
+
+void priority_lanes_close(PriorityLanes *lanes) {
+    pthread_mutex_lock(&lanes->lock);
+    lanes->closed = 1;
+    pthread_cond_broadcast(&lanes->not_empty);
+    pthread_cond_broadcast(&lanes->not_full);
+    pthread_mutex_unlock(&lanes->lock);
+}
@@ -0,0 +1,130 @@
+/**
+ * @file priority_lanes.h
+ * @brief Очереди классов приоритета между разбором и обработчиками.
+ *
+ * Каждый тип пакета относится к классу приоритета (0 - высший). У каждого
+ * класса своя ограниченная очередь (полоса), поэтому всплеск объёмной
+ * телеметрии заполняет только свою полосу и не вытесняет управляющие
+ * пакеты. Планировщик выдаёт пакет из самой приоритетной непустой полосы.
+ * Чтобы низкие классы не голодали, полоса, которую обошли starvation_limit
+ * раз подряд, обслуживается вне очереди.
+ */
+#ifndef PRIORITY_LANES_H
+#define PRIORITY_LANES_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include "parser.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PRIORITY_MAX_CLASSES 4 /**< Наибольшее число классов приоритета */
+
+/**
+ * @struct PriorityLaneStats
+ * @brief Счётчики одной полосы.
+ */
+typedef struct {
+    uint64_t pushed;             /**< Поставлено пакетов */
+    uint64_t popped;             /**< Выдано пакетов */
+    uint64_t full_waits;         /**< Сколько раз разбор ждал места в полосе */
+    uint64_t starvation_grants;  /**< Выдач вне очереди по защите от голодания */
+    uint64_t wait_total_ns;      /**< Суммарное время от постановки до выдачи, нс */
+    uint64_t wait_max_ns;        /**< Наибольшее время от постановки до выдачи, нс */
+} PriorityLaneStats;
+
+/**
+ * @struct PriorityLane
+ * @brief Ограниченная очередь одного класса.
+ */
+typedef struct {
+    void **items;             /**< Кольцевой массив элементов */
+    uint64_t *enqueued_at;    /**< Время постановки каждого элемента */
+    int head;                 /**< Индекс первого элемента */
+    int count;                /**< Число элементов */
+    int skipped;              /**< Выдач из других полос, пока эта была непуста */
+    PriorityLaneStats stats;  /**< Счётчики */
+} PriorityLane;
+
+/**
+ * @struct PriorityLanes
+ * @brief Полосы всех классов и планировщик.
+ */
+typedef struct {
+    PriorityLane lanes[PRIORITY_MAX_CLASSES];   /**< Полосы, 0 - высший приоритет */
+    int class_count;                            /**< Число классов */
+    int capacity;                               /**< Ёмкость каждой полосы */
+    int starvation_limit;                       /**< Обходов непустой полосы до выдачи вне очереди (0 - строгий приоритет) */
+    uint8_t class_of[PARSER_TYPE_COUNT];        /**< Класс каждого типа */
+    int closed;                                 /**< Полосы закрыты */
+    pthread_mutex_t lock;                       /**< Мьютекс полос */
+    pthread_cond_t not_empty;                   /**< Сигнал для рабочих потоков */
+    pthread_cond_t not_full;                    /**< Сигнал для потока разбора */
+} PriorityLanes;
+
+/**
+ * @brief Создаёт полосы.
+ *
+ * Все типы изначально относятся к низшему классу (class_count - 1).
+ *
+ * @param lanes Указатель на полосы.
+ * @param class_count Число классов (1..PRIORITY_MAX_CLASSES).
+ * @param capacity Ёмкость каждой полосы.
+ * @param starvation_limit Обходов непустой полосы до выдачи вне очереди (0 - строгий приоритет).
+ * @return Возвращает 0 при успехе, -1 при ошибке.
+ */
+int priority_lanes_init(PriorityLanes *lanes, int class_count, int capacity, int starvation_limit);
+
+/**
+ * @brief Освобождает полосы (элементы не освобождаются).
+ *
+ * @param lanes Указатель на полосы.
+ */
+void priority_lanes_destroy(PriorityLanes *lanes);
+
+/**
+ * @brief Назначает класс типу.
+ *
+ * @param lanes Указатель на полосы.
+ * @param type Тип пакета.
+ * @param priority_class Класс (0 - высший).
+ * @return Возвращает 0 при успехе, -1 при неверном типе или классе.
+ */
+int priority_lanes_set_class(PriorityLanes *lanes, unsigned int type, int priority_class);
+
+/**
+ * @brief Ставит элемент в полосу класса его типа, ожидая места в ней.
+ *
+ * @param lanes Указатель на полосы.
+ * @param type Тип пакета.
+ * @param item Элемент.
+ * @return Возвращает 0 при успехе, -1 если полосы закрыты.
+ */
+int priority_lanes_push(PriorityLanes *lanes, unsigned int type, void *item);
+
+/**
+ * @brief Выдаёт элемент самой приоритетной непустой полосы, ожидая его появления.
+ *
+ * Полоса, которую обошли starvation_limit раз, пока в ней были элементы,
+ * обслуживается раньше более приоритетных.
+ *
+ * @param lanes Указатель на полосы.
+ * @param item Указатель, куда будет сохранён элемент.
+ * @return Класс выданного элемента; -1 если полосы закрыты и пусты.
+ */
+int priority_lanes_pop(PriorityLanes *lanes, void **item);
+
+/**
+ * @brief Закрывает полосы: новые элементы не принимаются, ждущие потоки просыпаются.
+ *
+ * @param lanes Указатель на полосы.
+ */
+void priority_lanes_close(PriorityLanes *lanes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PRIORITY_LANES_H
@@ -0,0 +1,152 @@
+// Проверка SerialReactor на парах псевдотерминалов: в сторону master каждого
+// порта пишутся пакеты, реактор читает стороны slave и считает принятые пакеты.
+//
+// Использование: serial_demo [ports] [packets_per_port] [epoll|uring]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "serial_port.h"
+#include "serial_reactor.h"
+#ifdef PARSER_WITH_IO_URING
+#include "uring_reactor.h"
+#endif
+
+typedef struct {
+    SerialChannel channel;
+    int master;
+    unsigned long long packets;
+} DemoPort;
+
+static void on_packet(void *context, unsigned int type, unsigned char *data, unsigned int size) {
+    DemoPort *port = (DemoPort *)context;
+    (void)type;
+    (void)data;
+    (void)size;
+    port->packets++;
+}
+
+int main(int argc, char **argv) {
+    int ports = argc > 1 ? atoi(argv[1]) : 64;
+    int packets = argc > 2 ? atoi(argv[2]) : 200;
+    int use_uring = argc > 3 && strcmp(argv[3], "uring") == 0;
+#ifndef PARSER_WITH_IO_URING
+    if (use_uring) {
+        fprintf(stderr, "built without io_uring support\n");
+        return EXIT_FAILURE;
+    }
+#endif
+
+    SerialPortConfig config;
+    serial_port_default_config(&config);
+
+    SerialReactor reactor;
+    if (serial_reactor_init(&reactor) != 0) {
+        perror("serial_reactor_init");
+        return EXIT_FAILURE;
+    }
+    DemoPort *demo = calloc((size_t)ports, sizeof(DemoPort));
+    for (int i = 0; i < ports; i++) {
+        int slave;
+        if (serial_open_pty_pair(&demo[i].master, &slave, &config) != 0) {
+            perror("pty");
+            return EXIT_FAILURE;
+        }
+        if (use_uring) {
+            serial_channel_init(&demo[i].channel, slave, on_packet, &demo[i]);
+        } else if (serial_reactor_add(&reactor, &demo[i].channel, slave, on_packet, &demo[i]) != 0) {
+            perror("serial_reactor_add");
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Каналы io_uring должны лежать одним массивом
+    SerialChannel *channels = NULL;
+#ifdef PARSER_WITH_IO_URING
+    UringReactor uring;
+    if (use_uring) {
+        channels = calloc((size_t)ports, sizeof(SerialChannel));
+        for (int i = 0; i < ports; i++) {
+            serial_channel_init(&channels[i], demo[i].channel.fd, on_packet, &demo[i]);
+        }
+        if (uring_reactor_init(&uring, channels, ports) != 0) {
+            perror("uring_reactor_init");
+            return EXIT_FAILURE;
+        }
+    }
+#endif
+    unsigned long long wait_calls = 0;
+
+    // Пакет с одним байтом-заполнителем: parse_uart дочитывает лишний байт после тела
+    unsigned char body[32];
+    unsigned char packet[SYNC_SEQUENCE_LENGTH + MAX_HEADER_SIZE + sizeof(body) + 1];
+    unsigned int length;
+    for (unsigned int i = 0; i < sizeof(body); i++) {
+        body[i] = (unsigned char)i;
+    }
+    build_packet(packet, &length, sizeof(body), 42, body);
+    packet[length++] = 0x00;
+
+    for (int n = 0; n < packets; n++) {
+        for (int i = 0; i < ports; i++) {
+            if (write(demo[i].master, packet, length) != (ssize_t)length) {
+                perror("write");
+                return EXIT_FAILURE;
+            }
+        }
+        if (!use_uring) {
+            do {
+                wait_calls++;
+            } while (serial_reactor_poll(&reactor, 0) > 0);
+        }
+#ifdef PARSER_WITH_IO_URING
+        else {
+            do {
+            } while (uring_reactor_poll(&uring, 0) > 0);
+        }
+#endif
+    }
+    if (!use_uring) {
+        do {
+            wait_calls++;
+        } while (serial_reactor_poll(&reactor, 50) > 0);
+    }
+#ifdef PARSER_WITH_IO_URING
+    else {
+        while (uring_reactor_poll(&uring, 50) > 0) {
+        }
+    }
+#endif
+
+    unsigned long long total_packets = 0;
+    unsigned long long total_bytes = 0;
+    unsigned long long total_reads = 0;
+    for (int i = 0; i < ports; i++) {
+        SerialChannel *channel = channels != NULL ? &channels[i] : &demo[i].channel;
+        total_packets += demo[i].packets;
+        total_bytes += channel->bytes_received;
+        total_reads += channel->read_calls;
+    }
+    unsigned long long syscalls = total_reads + wait_calls;
+#ifdef PARSER_WITH_IO_URING
+    if (use_uring) {
+        syscalls = uring.enter_calls;
+        uring_reactor_destroy(&uring);
+    }
+#endif
+    for (int i = 0; i < ports; i++) {
+        close(demo[i].master);
+        close(demo[i].channel.fd);
+    }
+    printf("%s, ports %d: %llu/%llu packets, %llu bytes, %llu reads, %llu syscalls (%.4f per byte)\n",
+           use_uring ? "io_uring" : "epoll", ports, total_packets,
+           (unsigned long long)ports * (unsigned long long)packets, total_bytes, total_reads, syscalls,
+           total_bytes ? (double)syscalls / (double)total_bytes : 0.0);
+
+    serial_reactor_destroy(&reactor);
+    free(channels);
+    free(demo);
+    return total_packets == (unsigned long long)ports * (unsigned long long)packets ? EXIT_SUCCESS : EXIT_FAILURE;
+}
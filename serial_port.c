@@ -0,0 +1,102 @@
+/**
+ * @file serial_port.c
+ * @brief Реализация открытия и настройки последовательных портов.
+ */
+#define _GNU_SOURCE
+#include "serial_port.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+// Преобразование скорости в константу termios
+static speed_t baud_to_speed(int baud) {
+    switch (baud) {
+        case 9600: return B9600;
+        case 19200: return B19200;
+        case 38400: return B38400;
+        case 57600: return B57600;
+        case 115200: return B115200;
+        case 230400: return B230400;
+        case 460800: return B460800;
+        case 921600: return B921600;
+        case 1000000: return B1000000;
+        case 2000000: return B2000000;
+        case 3000000: return B3000000;
+        case 4000000: return B4000000;
+        default: return B0;
+    }
+}
+
+void serial_port_default_config(SerialPortConfig *config) {
+    config->baud = 115200;
+    config->vmin = 0;
+    config->vtime = 0;
+}
+
+int serial_port_configure(int fd, const SerialPortConfig *config) {
+    struct termios tio;
+    speed_t speed = baud_to_speed(config->baud);
+    if (speed == B0) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (tcgetattr(fd, &tio) != 0) {
+        return -1;
+    }
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cflag &= ~(CSTOPB | CRTSCTS);
+    tio.c_cc[VMIN] = config->vmin;
+    tio.c_cc[VTIME] = config->vtime;
+    if (cfsetispeed(&tio, speed) != 0 || cfsetospeed(&tio, speed) != 0) {
+        return -1;
+    }
+    if (tcsetattr(fd, TCSANOW, &tio) != 0) {
+        return -1;
+    }
+    tcflush(fd, TCIFLUSH);
+    return 0;
+}
+
+int serial_port_open(const char *path, const SerialPortConfig *config) {
+    int fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    if (serial_port_configure(fd, config) != 0) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+    return fd;
+}
+
+int serial_open_pty_pair(int *master, int *slave, const SerialPortConfig *config) {
+    int m = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if (m < 0) {
+        return -1;
+    }
+    if (grantpt(m) != 0 || unlockpt(m) != 0) {
+        close(m);
+        return -1;
+    }
+    const char *name = ptsname(m);
+    int s = name != NULL ? serial_port_open(name, config) : -1;
+    if (s < 0) {
+        close(m);
+        return -1;
+    }
+    // Сторона master тоже "сырая", иначе драйвер терминала будет менять байты потока
+    struct termios tio;
+    if (tcgetattr(m, &tio) == 0) {
+        cfmakeraw(&tio);
+        tcsetattr(m, TCSANOW, &tio);
+    }
+    *master = m;
+    *slave = s;
+    return 0;
+}
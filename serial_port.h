@@ -0,0 +1,73 @@
+/**
+ * @file serial_port.h
+ * @brief Открытие и настройка последовательных портов (Linux, termios).
+ *
+ * Порт переводится в "сырой" режим: без эха, без обработки спецсимволов и
+ * преобразования переводов строк, 8N1. Для локальной проверки без
+ * оборудования есть serial_open_pty_pair.
+ */
+#ifndef SERIAL_PORT_H
+#define SERIAL_PORT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @struct SerialPortConfig
+ * @brief Параметры порта.
+ *
+ * VMIN/VTIME имеют смысл только для блокирующего чтения; порты,
+ * зарегистрированные в SerialReactor, читаются в неблокирующем режиме.
+ */
+typedef struct {
+    int baud;            /**< Скорость, бод (например, 115200) */
+    unsigned char vmin;  /**< VMIN: минимальное число байтов для завершения read */
+    unsigned char vtime; /**< VTIME: межбайтовый таймаут в десятых долях секунды */
+} SerialPortConfig;
+
+/**
+ * @brief Заполняет конфигурацию значениями по умолчанию (115200, VMIN=0, VTIME=0).
+ *
+ * @param config Указатель на конфигурацию.
+ */
+void serial_port_default_config(SerialPortConfig *config);
+
+/**
+ * @brief Применяет конфигурацию к открытому терминалу.
+ *
+ * @param fd Дескриптор терминала.
+ * @param config Параметры порта.
+ * @return Возвращает 0 при успехе, -1 при ошибке (errno установлен).
+ */
+int serial_port_configure(int fd, const SerialPortConfig *config);
+
+/**
+ * @brief Открывает и настраивает порт.
+ *
+ * Порт открывается с O_NOCTTY | O_NONBLOCK | O_CLOEXEC.
+ *
+ * @param path Путь к устройству, например "/dev/ttyUSB0".
+ * @param config Параметры порта.
+ * @return Дескриптор порта или -1 при ошибке.
+ */
+int serial_port_open(const char *path, const SerialPortConfig *config);
+
+/**
+ * @brief Создаёт пару псевдотерминалов для проверки без оборудования.
+ *
+ * Сторона slave настроена как обычный порт и читается парсером, в сторону
+ * master пишется тестовый поток.
+ *
+ * @param master Дескриптор стороны master.
+ * @param slave Дескриптор стороны slave (неблокирующий).
+ * @param config Параметры для стороны slave.
+ * @return Возвращает 0 при успехе, -1 при ошибке.
+ */
+int serial_open_pty_pair(int *master, int *slave, const SerialPortConfig *config);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SERIAL_PORT_H
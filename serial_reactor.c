@@ -0,0 +1,157 @@
+/**
+ * @file serial_reactor.c
+ * @brief Реализация цикла событий epoll для последовательных портов.
+ */
+#define _GNU_SOURCE
+#include "serial_reactor.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+int serial_reactor_init(SerialReactor *reactor) {
+    reactor->channel_count = 0;
+    atomic_init(&reactor->stop, 0);
+    reactor->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (reactor->epoll_fd < 0) {
+        return -1;
+    }
+    reactor->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (reactor->wake_fd < 0) {
+        close(reactor->epoll_fd);
+        return -1;
+    }
+    struct epoll_event event = {0};
+    event.events = EPOLLIN;
+    event.data.ptr = NULL; // NULL отличает eventfd от каналов
+    if (epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, reactor->wake_fd, &event) != 0) {
+        serial_reactor_destroy(reactor);
+        return -1;
+    }
+    return 0;
+}
+
+void serial_reactor_destroy(SerialReactor *reactor) {
+    if (reactor->wake_fd >= 0) {
+        close(reactor->wake_fd);
+        reactor->wake_fd = -1;
+    }
+    if (reactor->epoll_fd >= 0) {
+        close(reactor->epoll_fd);
+        reactor->epoll_fd = -1;
+    }
+}
+
+void serial_channel_init(SerialChannel *channel, int fd, PacketHandler handler, void *context) {
+    channel->fd = fd;
+    channel->bytes_received = 0;
+    channel->read_calls = 0;
+    channel->fifo_full = 0;
+    channel->hangup = 0;
+    init_fifo(&channel->fifo);
+    init_parser(&channel->parser, &channel->fifo, NULL);
+    parser_set_handler(&channel->parser, handler, context);
+}
+
+int serial_reactor_add(SerialReactor *reactor, SerialChannel *channel, int fd, PacketHandler handler, void *context) {
+    int flags = fcntl(fd, F_GETFL);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) != 0) {
+        return -1;
+    }
+    serial_channel_init(channel, fd, handler, context);
+
+    struct epoll_event event = {0};
+    event.events = EPOLLIN | EPOLLRDHUP;
+    event.data.ptr = channel;
+    if (epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+        return -1;
+    }
+    reactor->channel_count++;
+    return 0;
+}
+
+int serial_reactor_remove(SerialReactor *reactor, SerialChannel *channel) {
+    if (epoll_ctl(reactor->epoll_fd, EPOLL_CTL_DEL, channel->fd, NULL) != 0) {
+        return -1;
+    }
+    reactor->channel_count--;
+    return 0;
+}
+
+// Читаем порт прямо в FIFO и разбираем принятое
+static void service_channel(SerialReactor *reactor, SerialChannel *channel) {
+    for (int attempt = 0; attempt < SERIAL_REACTOR_READ_BUDGET; attempt++) {
+        struct iovec iov[2];
+        int first_length;
+        int second_length;
+        int free_space = fifo_write_regions(&channel->fifo, (unsigned char **)&iov[0].iov_base, &first_length,
+                                            (unsigned char **)&iov[1].iov_base, &second_length);
+        if (free_space == 0) {
+            // Парсер не освободил место (такого не бывает при исправном parse_uart), ждём следующего события
+            channel->fifo_full++;
+            return;
+        }
+        iov[0].iov_len = (size_t)first_length;
+        iov[1].iov_len = (size_t)second_length;
+
+        ssize_t received = readv(channel->fd, iov, second_length > 0 ? 2 : 1);
+        channel->read_calls++;
+        if (received > 0) {
+            fifo_commit_write(&channel->fifo, (int)received);
+            channel->bytes_received += (uint64_t)received;
+            parse_uart(&channel->parser);
+            if (received < free_space) {
+                return; // Порт вычитан до конца
+            }
+        } else if (received == 0 || (errno != EAGAIN && errno != EINTR)) {
+            // Конец потока или ошибка порта (у pty - закрытие стороны master)
+            channel->hangup = 1;
+            serial_reactor_remove(reactor, channel);
+            return;
+        } else {
+            return;
+        }
+    }
+}
+
+int serial_reactor_poll(SerialReactor *reactor, int timeout_ms) {
+    struct epoll_event events[SERIAL_REACTOR_MAX_EVENTS];
+    int count = epoll_wait(reactor->epoll_fd, events, SERIAL_REACTOR_MAX_EVENTS, timeout_ms);
+    if (count < 0) {
+        return errno == EINTR ? 0 : -1;
+    }
+    int serviced = 0;
+    for (int i = 0; i < count; i++) {
+        SerialChannel *channel = (SerialChannel *)events[i].data.ptr;
+        if (channel == NULL) {
+            uint64_t value;
+            ssize_t ignored = read(reactor->wake_fd, &value, sizeof(value));
+            (void)ignored;
+            continue;
+        }
+        if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+            service_channel(reactor, channel);
+            serviced++;
+        }
+    }
+    return serviced;
+}
+
+int serial_reactor_run(SerialReactor *reactor) {
+    while (!atomic_load_explicit(&reactor->stop, memory_order_relaxed)) {
+        if (serial_reactor_poll(reactor, -1) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void serial_reactor_stop(SerialReactor *reactor) {
+    uint64_t one = 1;
+    atomic_store_explicit(&reactor->stop, 1, memory_order_relaxed);
+    ssize_t ignored = write(reactor->wake_fd, &one, sizeof(one));
+    (void)ignored;
+}
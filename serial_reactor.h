@@ -0,0 +1,138 @@
+/**
+ * @file serial_reactor.h
+ * @brief Приём данных с множества последовательных портов через epoll (Linux).
+ *
+ * Один поток реактора обслуживает сотни портов: данные читаются readv прямо
+ * в свободное место FIFO_Buffer канала (см. fifo_write_regions), после чего
+ * для канала вызывается parse_uart.
+ */
+#ifndef SERIAL_REACTOR_H
+#define SERIAL_REACTOR_H
+
+#include <stdint.h>
+#include "parser.h"
+#include "parser_atomic.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef SERIAL_REACTOR_MAX_EVENTS
+#define SERIAL_REACTOR_MAX_EVENTS 64  /**< Сколько событий epoll обрабатывается за один вызов epoll_wait */
+#endif
+
+#ifndef SERIAL_REACTOR_READ_BUDGET
+#define SERIAL_REACTOR_READ_BUDGET 4  /**< Сколько раз подряд читать один порт за событие */
+#endif
+
+/**
+ * @struct SerialChannel
+ * @brief Один порт: дескриптор, его FIFO и парсер.
+ *
+ * Память под каналы выделяет вызывающий код (например, массивом), реактор
+ * хранит только указатели.
+ */
+typedef struct {
+    int fd;                     /**< Дескриптор порта */
+    FIFO_Buffer fifo;           /**< FIFO канала */
+    Parser parser;              /**< Парсер канала */
+    void *user;                 /**< Пользовательские данные */
+    uint64_t bytes_received;    /**< Всего принято байтов */
+    uint64_t read_calls;        /**< Число системных вызовов чтения */
+    uint64_t fifo_full;         /**< Сколько раз FIFO оказывался заполнен */
+    int hangup;                 /**< Другая сторона закрыла порт */
+} SerialChannel;
+
+/**
+ * @struct SerialReactor
+ * @brief Цикл событий epoll.
+ */
+typedef struct {
+    int epoll_fd;               /**< Дескриптор epoll */
+    int wake_fd;                /**< eventfd для остановки из другого потока */
+    int channel_count;          /**< Число зарегистрированных каналов */
+    parser_atomic_int stop;     /**< Флаг остановки serial_reactor_run (ставится из другого потока) */
+} SerialReactor;
+
+/**
+ * @brief Инициализирует канал: FIFO, парсер и счётчики.
+ *
+ * Вызывается из serial_reactor_add; отдельно нужна для других движков
+ * приёма (например, uring_reactor), которые работают с теми же каналами.
+ *
+ * @param channel Канал.
+ * @param fd Дескриптор открытого порта.
+ * @param handler Обработчик пакетов.
+ * @param context Контекст обработчика.
+ */
+void serial_channel_init(SerialChannel *channel, int fd, PacketHandler handler, void *context);
+
+/**
+ * @brief Создаёт реактор.
+ *
+ * @param reactor Указатель на реактор.
+ * @return Возвращает 0 при успехе, -1 при ошибке.
+ */
+int serial_reactor_init(SerialReactor *reactor);
+
+/**
+ * @brief Освобождает ресурсы реактора (дескрипторы каналов не закрываются).
+ *
+ * @param reactor Указатель на реактор.
+ */
+void serial_reactor_destroy(SerialReactor *reactor);
+
+/**
+ * @brief Регистрирует порт.
+ *
+ * Инициализирует FIFO и парсер канала; пакеты передаются в handler с
+ * контекстом context (обычно сам канал). Дескриптор переводится в
+ * неблокирующий режим.
+ *
+ * @param reactor Указатель на реактор.
+ * @param channel Канал (память принадлежит вызывающему коду).
+ * @param fd Дескриптор открытого порта.
+ * @param handler Обработчик пакетов.
+ * @param context Контекст обработчика.
+ * @return Возвращает 0 при успехе, -1 при ошибке.
+ */
+int serial_reactor_add(SerialReactor *reactor, SerialChannel *channel, int fd, PacketHandler handler, void *context);
+
+/**
+ * @brief Снимает порт с обслуживания.
+ *
+ * @param reactor Указатель на реактор.
+ * @param channel Канал.
+ * @return Возвращает 0 при успехе, -1 при ошибке.
+ */
+int serial_reactor_remove(SerialReactor *reactor, SerialChannel *channel);
+
+/**
+ * @brief Один проход цикла: ожидание событий и обработка готовых портов.
+ *
+ * @param reactor Указатель на реактор.
+ * @param timeout_ms Таймаут ожидания в миллисекундах (-1 - бесконечно).
+ * @return Число обработанных портов или -1 при ошибке.
+ */
+int serial_reactor_poll(SerialReactor *reactor, int timeout_ms);
+
+/**
+ * @brief Выполняет serial_reactor_poll до вызова serial_reactor_stop.
+ *
+ * @param reactor Указатель на реактор.
+ * @return Возвращает 0 после остановки, -1 при ошибке.
+ */
+int serial_reactor_run(SerialReactor *reactor);
+
+/**
+ * @brief Останавливает serial_reactor_run; можно вызывать из любого потока.
+ *
+ * @param reactor Указатель на реактор.
+ */
+void serial_reactor_stop(SerialReactor *reactor);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SERIAL_REACTOR_H
@@ -0,0 +1,320 @@
+/**
+ * @file shared_fifo.c
+ * @brief Реализация FIFO_Buffer в разделяемой памяти.
+ */
+#define _GNU_SOURCE
+#include "shared_fifo.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "monotonic_clock.h"
+
+// Поля писателя и читателя лежат в разных строках кэша
+typedef struct {
+    _Atomic uint32_t magic;         // пишется последним при создании
+    uint16_t version;
+    uint16_t header_size;           // смещение FIFO_Buffer от начала сегмента
+    uint32_t fifo_size;             // sizeof(FIFO_Buffer)
+    uint32_t capacity;              // MAX_FIFO_SIZE
+
+    _Alignas(64) _Atomic uint64_t written; // писатель: всего опубликовано байтов
+    _Atomic uint32_t data_seq;      // futex читателя
+    _Atomic uint32_t closed;        // писатель отключился
+    _Atomic uint32_t writer_waiting;
+
+    _Alignas(64) _Atomic uint64_t consumed; // читатель: всего освобождено байтов
+    _Atomic uint32_t space_seq;     // futex писателя
+    _Atomic uint32_t reader_waiting;
+    _Atomic uint32_t wake_level;    // сколько неосвобождённых байтов ждёт читатель
+} SharedFifoHeader;
+
+typedef struct {
+    SharedFifoHeader header;
+    _Alignas(64) FIFO_Buffer fifo;
+} SharedFifoSegment;
+
+static SharedFifoHeader *header_of(SharedFifo *shared) {
+    return &((SharedFifoSegment *)shared->segment)->header;
+}
+
+static void futex_wake(_Atomic uint32_t *word) {
+    syscall(SYS_futex, word, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+// Пробуждает другую сторону, если она ждёт; seq меняется до вызова, чтобы
+// не потерять пробуждение между проверкой условия и FUTEX_WAIT
+static void wake_if_waiting(SharedFifo *shared, _Atomic uint32_t *waiting, _Atomic uint32_t *seq) {
+    if (atomic_load(waiting)) {
+        atomic_fetch_add(seq, 1);
+        futex_wake(seq);
+        shared->wake_calls++;
+    }
+}
+
+typedef int (*ReadyFn)(SharedFifo *shared, int length);
+
+static int wait_for(SharedFifo *shared, _Atomic uint32_t *waiting, _Atomic uint32_t *seq,
+                    ReadyFn ready, int length, int timeout_ms) {
+    uint64_t deadline = timeout_ms < 0 ? 0 : monotonic_clock_ns(NULL) + (uint64_t)timeout_ms * 1000000u;
+    for (;;) {
+        uint32_t value = atomic_load(seq);
+        struct timespec ts;
+        struct timespec *timeout = NULL;
+        atomic_store(waiting, 1);
+        if (ready(shared, length)) {
+            atomic_store(waiting, 0);
+            return 1;
+        }
+        if (timeout_ms >= 0) {
+            uint64_t now = monotonic_clock_ns(NULL);
+            if (now >= deadline) {
+                atomic_store(waiting, 0);
+                return 0;
+            }
+            ts.tv_sec = (time_t)((deadline - now) / 1000000000u);
+            ts.tv_nsec = (long)((deadline - now) % 1000000000u);
+            timeout = &ts;
+        }
+        shared->wait_calls++;
+        if (syscall(SYS_futex, seq, FUTEX_WAIT, value, timeout, NULL, 0) != 0 &&
+            errno != EAGAIN && errno != EINTR && errno != ETIMEDOUT) {
+            atomic_store(waiting, 0);
+            return -1;
+        }
+        atomic_store(waiting, 0);
+    }
+}
+
+static int map_segment(SharedFifo *shared, int fd, const char *name, int writer) {
+    shared->segment_size = sizeof(SharedFifoSegment);
+    shared->segment = mmap(NULL, shared->segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (shared->segment == MAP_FAILED) {
+        shared->segment = NULL;
+        return -1;
+    }
+    shared->fifo = &((SharedFifoSegment *)shared->segment)->fifo;
+    shared->writer = writer;
+    shared->position = 0;
+    shared->wait_calls = 0;
+    shared->wake_calls = 0;
+    strncpy(shared->name, name, sizeof(shared->name) - 1);
+    shared->name[sizeof(shared->name) - 1] = '\0';
+    return 0;
+}
+
+int shared_fifo_create(SharedFifo *shared, const char *name) {
+    SharedFifoHeader *header;
+    int fd;
+    if (strlen(name) >= sizeof(shared->name)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    // Старый сегмент мог остаться от упавшего писателя; читатели, ещё
+    // подключённые к нему, своё отображение не теряют
+    shm_unlink(name);
+    fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        return -1;
+    }
+    if (ftruncate(fd, (off_t)sizeof(SharedFifoSegment)) != 0) {
+        int error = errno;
+        close(fd);
+        shm_unlink(name);
+        errno = error;
+        return -1;
+    }
+    if (map_segment(shared, fd, name, 1) != 0) {
+        int error = errno;
+        shm_unlink(name);
+        errno = error;
+        return -1;
+    }
+    // ftruncate заполнил сегмент нулями
+    header = header_of(shared);
+    header->version = SHARED_FIFO_VERSION;
+    header->header_size = (uint16_t)offsetof(SharedFifoSegment, fifo);
+    header->fifo_size = (uint32_t)sizeof(FIFO_Buffer);
+    header->capacity = MAX_FIFO_SIZE;
+    init_fifo(shared->fifo);
+    atomic_store(&header->magic, SHARED_FIFO_MAGIC);
+    return 0;
+}
+
+int shared_fifo_attach(SharedFifo *shared, const char *name) {
+    SharedFifoHeader *header;
+    struct stat st;
+    uint64_t consumed;
+    int fd;
+    if (strlen(name) >= sizeof(shared->name)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    fd = shm_open(name, O_RDWR | O_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(SharedFifoSegment)) {
+        close(fd);
+        errno = EPROTO;
+        return -1;
+    }
+    if (map_segment(shared, fd, name, 0) != 0) {
+        return -1;
+    }
+    header = header_of(shared);
+    if (atomic_load(&header->magic) != SHARED_FIFO_MAGIC || header->version != SHARED_FIFO_VERSION ||
+        header->header_size != offsetof(SharedFifoSegment, fifo) ||
+        header->fifo_size != sizeof(FIFO_Buffer) || header->capacity != MAX_FIFO_SIZE) {
+        munmap(shared->segment, shared->segment_size);
+        shared->segment = NULL;
+        errno = EPROTO;
+        return -1;
+    }
+    // Разбор начинается с первого неосвобождённого байта: то, что прежний
+    // читатель принял, но не освободил, разбирается заново
+    consumed = atomic_load(&header->consumed);
+    shared->position = consumed;
+    shared->fifo->head = (int)(consumed % MAX_FIFO_SIZE);
+    shared->fifo->size = 0;
+    shared->fifo->timestamps = NULL;
+    shared->fifo->watermark = NULL;
+    shared->fifo->pool = NULL;
+    shared->fifo->overflow = NULL;
+    shared->fifo->overflow_tail = NULL;
+    shared->fifo->overflow_size = 0;
+    shared->fifo->overflow_segments = 0;
+    shared->fifo->max_segments = 0;
+    return 0;
+}
+
+void shared_fifo_detach(SharedFifo *shared) {
+    SharedFifoHeader *header;
+    if (shared->segment == NULL) {
+        return;
+    }
+    header = header_of(shared);
+    if (shared->writer) {
+        atomic_store(&header->closed, 1);
+        atomic_fetch_add(&header->data_seq, 1);
+        futex_wake(&header->data_seq);
+        shm_unlink(shared->name);
+    }
+    munmap(shared->segment, shared->segment_size);
+    shared->segment = NULL;
+    shared->fifo = NULL;
+}
+
+static int free_space(SharedFifo *shared) {
+    return MAX_FIFO_SIZE - (int)(shared->position - atomic_load(&header_of(shared)->consumed));
+}
+
+int shared_fifo_write_regions(SharedFifo *shared, unsigned char **first, int *first_length,
+                              unsigned char **second, int *second_length) {
+    int space = free_space(shared);
+    int tail = shared->fifo->tail;
+    int until_end = MAX_FIFO_SIZE - tail;
+    *first = &shared->fifo->buffer[tail];
+    *first_length = space < until_end ? space : until_end;
+    *second = shared->fifo->buffer;
+    *second_length = space - *first_length;
+    return space;
+}
+
+int shared_fifo_commit(SharedFifo *shared, int length) {
+    SharedFifoHeader *header = header_of(shared);
+    if (length < 0 || length > free_space(shared)) {
+        return -1;
+    }
+    shared->fifo->tail = (shared->fifo->tail + length) % MAX_FIFO_SIZE;
+    shared->position += (uint64_t)length;
+    atomic_store(&header->written, shared->position);
+    // Читатель спит, пока неосвобождённых байтов меньше его уровня
+    if (shared->position - atomic_load(&header->consumed) >= atomic_load(&header->wake_level)) {
+        wake_if_waiting(shared, &header->reader_waiting, &header->data_seq);
+    }
+    return 0;
+}
+
+int shared_fifo_write(SharedFifo *shared, const unsigned char *data, int length) {
+    unsigned char *first;
+    unsigned char *second;
+    int first_length;
+    int second_length;
+    if (data == NULL || length < 0 ||
+        shared_fifo_write_regions(shared, &first, &first_length, &second, &second_length) < length) {
+        return -1;
+    }
+    if (length <= first_length) {
+        memcpy(first, data, (size_t)length);
+    } else {
+        memcpy(first, data, (size_t)first_length);
+        memcpy(second, data + first_length, (size_t)(length - first_length));
+    }
+    shared_fifo_commit(shared, length);
+    return length;
+}
+
+static int space_ready(SharedFifo *shared, int length) {
+    return free_space(shared) >= length;
+}
+
+int shared_fifo_wait_space(SharedFifo *shared, int length, int timeout_ms) {
+    SharedFifoHeader *header = header_of(shared);
+    if (length < 0 || length > MAX_FIFO_SIZE) {
+        return -1;
+    }
+    return wait_for(shared, &header->writer_waiting, &header->space_seq, space_ready, length, timeout_ms);
+}
+
+int shared_fifo_acquire(SharedFifo *shared) {
+    uint64_t written = atomic_load_explicit(&header_of(shared)->written, memory_order_acquire);
+    int count = (int)(written - shared->position);
+    shared->fifo->size += count;
+    shared->position = written;
+    return count;
+}
+
+void shared_fifo_release(SharedFifo *shared) {
+    SharedFifoHeader *header = header_of(shared);
+    atomic_store(&header->consumed, shared->position - (uint64_t)shared->fifo->size);
+    wake_if_waiting(shared, &header->writer_waiting, &header->space_seq);
+}
+
+static int level_ready(SharedFifo *shared, int level) {
+    SharedFifoHeader *header = header_of(shared);
+    return atomic_load(&header->written) - atomic_load(&header->consumed) >= (uint64_t)level ||
+           atomic_load(&header->closed);
+}
+
+int shared_fifo_wait_level(SharedFifo *shared, int level, int timeout_ms) {
+    SharedFifoHeader *header = header_of(shared);
+    if (level < 1 || level > MAX_FIFO_SIZE) {
+        return -1;
+    }
+    // Уровень публикуется до флага ожидания, писатель читает их в обратном порядке
+    atomic_store(&header->wake_level, (uint32_t)level);
+    return wait_for(shared, &header->reader_waiting, &header->data_seq, level_ready, level, timeout_ms);
+}
+
+int shared_fifo_wait(SharedFifo *shared, int timeout_ms) {
+    // Любой байт сверх уже принятого
+    int level = (int)(shared->position - atomic_load(&header_of(shared)->consumed)) + 1;
+    return shared_fifo_wait_level(shared, level < MAX_FIFO_SIZE ? level : MAX_FIFO_SIZE, timeout_ms);
+}
+
+int shared_fifo_finished(SharedFifo *shared) {
+    SharedFifoHeader *header = header_of(shared);
+    return atomic_load(&header->closed) && atomic_load(&header->written) == shared->position;
+}
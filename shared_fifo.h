@@ -0,0 +1,181 @@
+/**
+ * @file shared_fifo.h
+ * @brief FIFO_Buffer в разделяемой памяти POSIX для передачи между процессами (Linux).
+ *
+ * Сегмент состоит из заголовка с версией и обычного FIFO_Buffer. Писатель
+ * (например, процесс чтения портов) создаёт сегмент и пишет байты в
+ * свободное место кольца, читатель подключается к сегменту по имени и
+ * вызывает parse_uart прямо для FIFO_Buffer внутри сегмента - без копий.
+ *
+ * Буфер безопасен для одного писателя и одного читателя (SPSC). Писатель
+ * меняет только tail и счётчик записанных байтов, читатель - head и size
+ * (это делает parse_uart). Обмен между процессами идёт пакетно: читатель
+ * забирает всё опубликованное одним атомарным чтением (shared_fifo_acquire)
+ * и после разбора публикует освобождённое место (shared_fifo_release).
+ * Системные вызовы (futex) нужны только для пробуждения стороны, которая
+ * заснула в shared_fifo_wait или shared_fifo_wait_space; пока обе стороны
+ * работают, порции передаются без системных вызовов.
+ *
+ * Отметки времени FIFO (fifo_enable_timestamps) в разделяемом буфере не
+ * поддерживаются.
+ */
+#ifndef SHARED_FIFO_H
+#define SHARED_FIFO_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "fifo.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SHARED_FIFO_MAGIC 0x48534655u /**< Сигнатура сегмента ("UFSH") */
+#define SHARED_FIFO_VERSION 2         /**< Версия раскладки сегмента */
+
+/**
+ * @struct SharedFifo
+ * @brief Подключение одного процесса к сегменту.
+ */
+typedef struct {
+    void *segment;          /**< Отображённый сегмент */
+    size_t segment_size;    /**< Размер отображения */
+    FIFO_Buffer *fifo;      /**< FIFO внутри сегмента (для init_parser у читателя) */
+    int writer;             /**< 1 - писатель (создатель сегмента), 0 - читатель */
+    uint64_t position;      /**< Писатель: записано байтов; читатель: принято в fifo */
+    uint64_t wait_calls;    /**< Число вызовов futex при ожидании */
+    uint64_t wake_calls;    /**< Число вызовов futex для пробуждения другой стороны */
+    char name[64];          /**< Имя сегмента */
+} SharedFifo;
+
+/**
+ * @brief Создаёт сегмент и подключается к нему как писатель.
+ *
+ * Существующий сегмент с тем же именем пересоздаётся.
+ *
+ * @param shared Указатель на подключение.
+ * @param name Имя сегмента в формате shm_open ("/name").
+ * @return Возвращает 0 при успехе или -1 при ошибке (errno сохраняется).
+ */
+int shared_fifo_create(SharedFifo *shared, const char *name);
+
+/**
+ * @brief Подключается к сегменту как читатель.
+ *
+ * Проверяет сигнатуру, версию и размер FIFO_Buffer: сегмент, созданный
+ * сборкой с другим MAX_FIFO_SIZE, не подключается.
+ *
+ * @param shared Указатель на подключение.
+ * @param name Имя сегмента.
+ * @return Возвращает 0 при успехе или -1 при ошибке (EPROTO - несовместимый сегмент).
+ */
+int shared_fifo_attach(SharedFifo *shared, const char *name);
+
+/**
+ * @brief Отключается от сегмента.
+ *
+ * Писатель перед отключением помечает поток закрытым и удаляет имя
+ * сегмента; читатели дочитывают уже записанные данные.
+ *
+ * @param shared Указатель на подключение.
+ */
+void shared_fifo_detach(SharedFifo *shared);
+
+/**
+ * @brief Возвращает свободное место кольца для записи без копирования (писатель).
+ *
+ * Аналог fifo_write_regions; записанное фиксируется shared_fifo_commit.
+ *
+ * @return Общий объём свободного места.
+ */
+int shared_fifo_write_regions(SharedFifo *shared, unsigned char **first, int *first_length,
+                              unsigned char **second, int *second_length);
+
+/**
+ * @brief Публикует байты, записанные в свободное место (писатель).
+ *
+ * Будит читателя, только если он ждёт в shared_fifo_wait.
+ *
+ * @param shared Указатель на подключение.
+ * @param length Число записанных байтов.
+ * @return Возвращает 0 при успехе или -1, если length больше свободного места.
+ */
+int shared_fifo_commit(SharedFifo *shared, int length);
+
+/**
+ * @brief Копирует данные в кольцо и публикует их (писатель).
+ *
+ * Как write_fifo: данные записываются целиком или не записываются вовсе.
+ *
+ * @return Возвращает length при успехе или -1, если не хватает места.
+ */
+int shared_fifo_write(SharedFifo *shared, const unsigned char *data, int length);
+
+/**
+ * @brief Ждёт, пока в кольце освободится не меньше length байтов (писатель).
+ *
+ * @param shared Указатель на подключение.
+ * @param length Нужное свободное место.
+ * @param timeout_ms Таймаут в миллисекундах (отрицательный - без ограничения).
+ * @return 1 - место есть, 0 - таймаут, -1 - ошибка.
+ */
+int shared_fifo_wait_space(SharedFifo *shared, int length, int timeout_ms);
+
+/**
+ * @brief Забирает опубликованные писателем байты в fifo (читатель).
+ *
+ * После вызова новые байты видны parse_uart через shared->fifo.
+ *
+ * @param shared Указатель на подключение.
+ * @return Число новых байтов.
+ */
+int shared_fifo_acquire(SharedFifo *shared);
+
+/**
+ * @brief Публикует место, освобождённое разбором (читатель).
+ *
+ * Вызывается после parse_uart; будит писателя, если он ждёт места.
+ *
+ * @param shared Указатель на подключение.
+ */
+void shared_fifo_release(SharedFifo *shared);
+
+/**
+ * @brief Ждёт новых данных от писателя (читатель).
+ *
+ * @param shared Указатель на подключение.
+ * @param timeout_ms Таймаут в миллисекундах (отрицательный - без ограничения).
+ * @return 1 - есть данные или поток закрыт, 0 - таймаут, -1 - ошибка.
+ */
+int shared_fifo_wait(SharedFifo *shared, int timeout_ms);
+
+/**
+ * @brief Ждёт, пока в кольце наберётся не меньше level неосвобождённых байтов (читатель).
+ *
+ * Неосвобождённые - это принятые, но не разобранные байты shared->fifo и
+ * ещё не принятые опубликованные. Писатель будит читателя только при
+ * достижении уровня, поэтому читатель, ждущий целый заголовок или тело
+ * (parser_bytes_needed), не просыпается на каждом байте. Уровень не должен
+ * превышать MAX_FIFO_SIZE минус наибольшую порцию, которую писатель ждёт
+ * в shared_fifo_wait_space, иначе обе стороны будут ждать друг друга.
+ *
+ * @param shared Указатель на подключение.
+ * @param level Уровень, байт (1..MAX_FIFO_SIZE).
+ * @param timeout_ms Таймаут в миллисекундах (отрицательный - без ограничения).
+ * @return 1 - уровень достигнут или поток закрыт, 0 - таймаут, -1 - ошибка.
+ */
+int shared_fifo_wait_level(SharedFifo *shared, int level, int timeout_ms);
+
+/**
+ * @brief Проверяет, закрыт ли поток писателем и всё ли из него принято (читатель).
+ *
+ * @param shared Указатель на подключение.
+ * @return 1, если писатель отключился и новых данных больше не будет.
+ */
+int shared_fifo_finished(SharedFifo *shared);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SHARED_FIFO_H
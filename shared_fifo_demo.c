@@ -0,0 +1,150 @@
+// Передача потока между процессами через SharedFifo: писатель выдаёт поток
+// traffic_gen в сегмент разделяемой памяти, читатель подключается к нему по
+// имени и вызывает parse_uart прямо для FIFO внутри сегмента.
+//
+// Использование:
+//   shared_fifo_demo [packets]            писатель и читатель в двух процессах (fork)
+//   shared_fifo_demo write NAME [packets] только писатель
+//   shared_fifo_demo read NAME            только читатель
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "monotonic_clock.h"
+#include "shared_fifo.h"
+#include "traffic_gen.h"
+
+static unsigned long long g_parsed;
+
+static void count_packet(void *context, unsigned int type, unsigned char *data, unsigned int size) {
+    (void)context;
+    (void)type;
+    (void)data;
+    (void)size;
+    g_parsed++;
+}
+
+static int shared_sink(void *context, const unsigned char *data, size_t length) {
+    SharedFifo *shared = (SharedFifo *)context;
+    while (length > 0) {
+        int part = length < MAX_FIFO_SIZE / 2 ? (int)length : MAX_FIFO_SIZE / 2;
+        if (shared_fifo_wait_space(shared, part, 1000) != 1) {
+            return -1; // Читатель не освобождает место
+        }
+        shared_fifo_write(shared, data, part);
+        data += part;
+        length -= (size_t)part;
+    }
+    return 0;
+}
+
+static int run_writer(SharedFifo *shared, unsigned long long packets) {
+    TrafficConfig config;
+    TrafficGenerator generator;
+    uint64_t start;
+    double seconds;
+    int result;
+    traffic_default_config(&config);
+    config.packets = packets;
+    traffic_gen_init(&generator, &config);
+    start = monotonic_clock_ns(NULL);
+    result = traffic_gen_run(&generator, shared_sink, shared);
+    seconds = (double)(monotonic_clock_ns(NULL) - start) * 1e-9;
+    fprintf(stderr, "writer: %llu packets, %llu bytes in %llu chunks, %.1f MB/s; futex waits %llu, wakes %llu\n",
+            (unsigned long long)generator.stats.packets, (unsigned long long)generator.stats.bytes,
+            (unsigned long long)generator.stats.chunks,
+            seconds > 0.0 ? (double)generator.stats.bytes / seconds / 1e6 : 0.0,
+            (unsigned long long)shared->wait_calls, (unsigned long long)shared->wake_calls);
+    return result;
+}
+
+static int run_reader(const char *name, int ready_fd) {
+    static Parser parser;
+    SharedFifo shared;
+    unsigned long long batches = 0;
+    if (shared_fifo_attach(&shared, name) != 0) {
+        perror("shared_fifo_attach");
+        return -1;
+    }
+    if (ready_fd >= 0) {
+        char ready = 1;
+        if (write(ready_fd, &ready, 1) != 1) {
+            return -1;
+        }
+        close(ready_fd);
+    }
+    init_parser(&parser, shared.fifo, NULL);
+    parser_set_handler(&parser, count_packet, NULL);
+    parser_set_event_sink(&parser, NULL, NULL);
+    while (!shared_fifo_finished(&shared)) {
+        if (shared_fifo_acquire(&shared) > 0) {
+            parse_uart(&parser);
+            shared_fifo_release(&shared);
+            batches++;
+        }
+        // Писатель будит, только когда набрался заголовок или остаток тела
+        if (shared_fifo_wait_level(&shared, parser_bytes_needed(&parser), 1000) < 0) {
+            perror("shared_fifo_wait_level");
+            break;
+        }
+    }
+    fprintf(stderr, "reader: %llu packets in %llu batches; futex waits %llu, wakes %llu\n",
+            g_parsed, batches, (unsigned long long)shared.wait_calls, (unsigned long long)shared.wake_calls);
+    shared_fifo_detach(&shared);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    SharedFifo shared;
+    if (argc > 2 && strcmp(argv[1], "read") == 0) {
+        return run_reader(argv[2], -1) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (argc > 2 && strcmp(argv[1], "write") == 0) {
+        int result;
+        if (shared_fifo_create(&shared, argv[2]) != 0) {
+            perror("shared_fifo_create");
+            return EXIT_FAILURE;
+        }
+        result = run_writer(&shared, argc > 3 ? strtoull(argv[3], NULL, 0) : 100000);
+        shared_fifo_detach(&shared);
+        return result == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    char name[64];
+    int ready[2];
+    char byte;
+    pid_t child;
+    int status;
+    int result;
+    snprintf(name, sizeof(name), "/shared_fifo_demo.%d", (int)getpid());
+    if (shared_fifo_create(&shared, name) != 0) {
+        perror("shared_fifo_create");
+        return EXIT_FAILURE;
+    }
+    if (pipe(ready) != 0) {
+        perror("pipe");
+        return EXIT_FAILURE;
+    }
+    child = fork();
+    if (child == 0) {
+        // Отображение писателя наследуется, но читатель подключается по имени, как отдельный процесс
+        close(ready[0]);
+        _exit(run_reader(name, ready[1]) == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+    close(ready[1]);
+    // Имя сегмента удаляется при отключении писателя, поэтому ждём подключения читателя
+    if (child < 0 || read(ready[0], &byte, 1) != 1) {
+        fprintf(stderr, "reader failed to start\n");
+        shared_fifo_detach(&shared);
+        return EXIT_FAILURE;
+    }
+    result = run_writer(&shared, argc > 1 ? strtoull(argv[1], NULL, 0) : 100000);
+    shared_fifo_detach(&shared);
+    if (waitpid(child, &status, 0) != child || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        result = -1;
+    }
+    return result == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,329 @@
+/**
+ * @file traffic_gen.c
+ * @brief Реализация генератора синтетического потока пакетов.
+ */
+#include "traffic_gen.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "monotonic_clock.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+static const unsigned char SYNC[SYNC_SEQUENCE_LENGTH] = PARSER_SYNC_SEQUENCE;
+
+// xorshift64* с начальным состоянием из splitmix64
+static uint64_t next_random(TrafficGenerator *generator) {
+    uint64_t x = generator->rng;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    generator->rng = x;
+    return x * 0x2545F4914F6CDD1Dull;
+}
+
+// Равномерно в [0, 1)
+static double next_unit(TrafficGenerator *generator) {
+    return (double)(next_random(generator) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Равномерно в [min, max]
+static uint64_t next_range(TrafficGenerator *generator, uint64_t min, uint64_t max) {
+    if (max <= min) {
+        return min;
+    }
+    return min + next_random(generator) % (max - min + 1);
+}
+
+static unsigned int sample(TrafficGenerator *generator, const TrafficDistribution *distribution) {
+    double total = 0.0;
+    double point;
+    if (distribution->count == 0) {
+        return (unsigned int)next_range(generator, distribution->min, distribution->max);
+    }
+    for (int i = 0; i < distribution->count; i++) {
+        total += distribution->weights[i];
+    }
+    point = next_unit(generator) * total;
+    for (int i = 0; i < distribution->count; i++) {
+        if (point < distribution->weights[i]) {
+            return distribution->values[i];
+        }
+        point -= distribution->weights[i];
+    }
+    return distribution->values[distribution->count - 1];
+}
+
+void traffic_default_config(TrafficConfig *config) {
+    memset(config, 0, sizeof(*config));
+    config->seed = 1;
+    config->types.min = 0;
+    config->types.max = 127;
+    config->sizes.min = 0;
+    config->sizes.max = 64;
+    config->padding = 1;
+    config->chunk_min = 256;
+    config->chunk_max = 256;
+}
+
+int traffic_parse_distribution(const char *text, TrafficDistribution *distribution) {
+    char *end;
+    memset(distribution, 0, sizeof(*distribution));
+    if (strchr(text, ':') == NULL) {
+        distribution->min = (unsigned int)strtoul(text, &end, 0);
+        distribution->max = distribution->min;
+        if (end == text) {
+            return -1;
+        }
+        if (*end == '-') {
+            const char *start = end + 1;
+            distribution->max = (unsigned int)strtoul(start, &end, 0);
+            if (end == start || distribution->max < distribution->min) {
+                return -1;
+            }
+        }
+        return *end == '\0' ? 0 : -1;
+    }
+    while (*text != '\0') {
+        if (distribution->count == TRAFFIC_MAX_WEIGHTS) {
+            return -1;
+        }
+        distribution->values[distribution->count] = (unsigned int)strtoul(text, &end, 0);
+        if (end == text || *end != ':') {
+            return -1;
+        }
+        text = end + 1;
+        distribution->weights[distribution->count] = strtod(text, &end);
+        if (end == text || distribution->weights[distribution->count] < 0.0) {
+            return -1;
+        }
+        distribution->count++;
+        text = *end == ',' ? end + 1 : end;
+        if (*end != ',' && *end != '\0') {
+            return -1;
+        }
+    }
+    return distribution->count > 0 ? 0 : -1;
+}
+
+int traffic_gen_init(TrafficGenerator *generator, const TrafficConfig *config) {
+    uint64_t z;
+    if (config->padding < 0 || config->padding > 16 || config->chunk_min == 0 ||
+        config->chunk_max < config->chunk_min || config->chunk_pattern_length < 0 ||
+        config->chunk_pattern_length > TRAFFIC_MAX_CHUNKS) {
+        return -1;
+    }
+    for (int i = 0; i < config->chunk_pattern_length; i++) {
+        if (config->chunk_pattern[i] == 0) {
+            return -1;
+        }
+    }
+    memset(generator, 0, sizeof(*generator));
+    generator->config = *config;
+    // splitmix64: нулевое состояние xorshift недопустимо
+    z = config->seed + 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    z ^= z >> 31;
+    generator->rng = z ? z : 1;
+    return 0;
+}
+
+// Следующий пакет с искажениями в pending; 0 - поток закончился
+static int make_packet(TrafficGenerator *generator) {
+    const TrafficConfig *config = &generator->config;
+    unsigned char body[MAX_PACKET_SIZE];
+    unsigned char packet[SYNC_SEQUENCE_LENGTH + MAX_HEADER_SIZE + MAX_PACKET_SIZE];
+    unsigned int length;
+    unsigned int size;
+    unsigned int type;
+    int intact = 1;
+
+    if (config->packets != 0 && generator->stats.packets >= config->packets) {
+        return 0;
+    }
+    size = sample(generator, &config->sizes);
+    type = sample(generator, &config->types) & (PARSER_TYPE_COUNT - 1);
+    if (size > MAX_PACKET_SIZE) {
+        size = MAX_PACKET_SIZE;
+    }
+    for (unsigned int i = 0; i < size; i++) {
+        body[i] = (unsigned char)next_random(generator);
+    }
+    if (config->false_sync_rate > 0.0 && size >= SYNC_SEQUENCE_LENGTH &&
+        next_unit(generator) < config->false_sync_rate) {
+        memcpy(&body[next_range(generator, 0, size - SYNC_SEQUENCE_LENGTH)], SYNC, SYNC_SEQUENCE_LENGTH);
+        generator->stats.false_syncs++;
+    }
+    build_packet(packet, &length, size, type, body);
+    memset(&packet[length], 0, (size_t)config->padding);
+    length += (unsigned int)config->padding;
+
+    // Искажения побайтно: выпадение или инверсия одного бита
+    generator->pending_length = 0;
+    for (unsigned int i = 0; i < length; i++) {
+        unsigned char byte = packet[i];
+        if (config->drop_rate > 0.0 && next_unit(generator) < config->drop_rate) {
+            generator->stats.dropped_bytes++;
+            intact = 0;
+            continue;
+        }
+        if (config->bit_error_rate > 0.0 && next_unit(generator) < config->bit_error_rate) {
+            byte ^= (unsigned char)(1u << (next_random(generator) & 7));
+            generator->stats.flipped_bits++;
+            intact = 0;
+        }
+        generator->pending[generator->pending_length++] = byte;
+    }
+    generator->pending_pos = 0;
+    generator->stats.packets++;
+    if (intact) {
+        generator->stats.intact_packets++;
+    }
+    return 1;
+}
+
+size_t traffic_gen_fill(TrafficGenerator *generator, unsigned char *buffer, size_t capacity) {
+    size_t filled = 0;
+    while (filled < capacity) {
+        size_t available = generator->pending_length - generator->pending_pos;
+        if (available == 0) {
+            if (!make_packet(generator)) {
+                break;
+            }
+            continue;
+        }
+        if (available > capacity - filled) {
+            available = capacity - filled;
+        }
+        memcpy(buffer + filled, generator->pending + generator->pending_pos, available);
+        generator->pending_pos += available;
+        filled += available;
+    }
+    generator->stats.bytes += filled;
+    return filled;
+}
+
+size_t traffic_gen_next_chunk(TrafficGenerator *generator, unsigned char *buffer, size_t capacity) {
+    const TrafficConfig *config = &generator->config;
+    size_t length;
+    if (config->chunk_pattern_length > 0) {
+        length = config->chunk_pattern[generator->chunk_index];
+        generator->chunk_index = (generator->chunk_index + 1) % config->chunk_pattern_length;
+    } else {
+        length = (size_t)next_range(generator, config->chunk_min, config->chunk_max);
+    }
+    if (length > capacity) {
+        length = capacity;
+    }
+    length = traffic_gen_fill(generator, buffer, length);
+    if (length > 0) {
+        generator->stats.chunks++;
+    }
+    return length;
+}
+
+static void sleep_ns(uint64_t ns) {
+#ifdef _WIN32
+    Sleep((DWORD)(ns / 1000000u));
+#else
+    struct timespec ts;
+    ts.tv_sec = (time_t)(ns / 1000000000u);
+    ts.tv_nsec = (long)(ns % 1000000000u);
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+    }
+#endif
+}
+
+// Ожидание до момента, когда выданный объём укладывается в заданную скорость
+static void pace(TrafficGenerator *generator) {
+    const TrafficConfig *config = &generator->config;
+    double due = 0.0;
+    double elapsed;
+    if (config->bytes_per_second > 0.0) {
+        due = (double)generator->stats.bytes / config->bytes_per_second;
+    }
+    if (config->packets_per_second > 0.0) {
+        double packets_due = (double)generator->stats.packets / config->packets_per_second;
+        if (packets_due > due) {
+            due = packets_due;
+        }
+    }
+    elapsed = (double)(monotonic_clock_ns(NULL) - generator->start_time) * 1e-9;
+    if (due > elapsed) {
+        sleep_ns((uint64_t)((due - elapsed) * 1e9));
+    }
+}
+
+int traffic_gen_run(TrafficGenerator *generator, TrafficSink sink, void *context) {
+    unsigned char chunk[4096];
+    int paced = generator->config.bytes_per_second > 0.0 || generator->config.packets_per_second > 0.0;
+    size_t length;
+    generator->start_time = monotonic_clock_ns(NULL);
+    while ((length = traffic_gen_next_chunk(generator, chunk, sizeof(chunk))) > 0) {
+        if (sink(context, chunk, length) != 0) {
+            return -1;
+        }
+        if (paced) {
+            pace(generator);
+        }
+    }
+    return 0;
+}
+
+int traffic_sink_file(void *context, const unsigned char *data, size_t length) {
+    return fwrite(data, 1, length, (FILE *)context) == length ? 0 : -1;
+}
+
+#ifndef _WIN32
+int traffic_sink_fd(void *context, const unsigned char *data, size_t length) {
+    int fd = *(const int *)context;
+    while (length > 0) {
+        ssize_t written = write(fd, data, length);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                struct pollfd pfd;
+                pfd.fd = fd;
+                pfd.events = POLLOUT;
+                poll(&pfd, 1, -1);
+                continue;
+            }
+            return -1;
+        }
+        data += written;
+        length -= (size_t)written;
+    }
+    return 0;
+}
+#endif
+
+int traffic_sink_fifo(void *context, const unsigned char *data, size_t length) {
+    TrafficFifoSink *sink = (TrafficFifoSink *)context;
+    while (length > 0) {
+        int space = MAX_FIFO_SIZE - sink->fifo->size;
+        int part = length < (size_t)space ? (int)length : space;
+        if (part == 0) {
+            return -1; // Парсер не освободил место
+        }
+        write_fifo(sink->fifo, data, part);
+        data += part;
+        length -= (size_t)part;
+        if (sink->parser != NULL) {
+            parse_uart(sink->parser);
+        } else if (length > 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,204 @@
+/**
+ * @file traffic_gen.h
+ * @brief Генератор синтетического потока пакетов для нагрузочных проверок.
+ *
+ * Поток собирается из пакетов build_packet со случайными типом и размером
+ * по заданным распределениям. Поверх пакетов можно внести искажения
+ * (инверсия случайного бита, выпадение байта), вставить ложную
+ * синхропоследовательность внутрь тела и выдавать поток порциями заданного
+ * шаблона с ограничением скорости. При одинаковом seed поток повторяется
+ * байт в байт.
+ */
+#ifndef TRAFFIC_GEN_H
+#define TRAFFIC_GEN_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "parser.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TRAFFIC_MAX_WEIGHTS 64  /**< Наибольшее число значений во взвешенном распределении */
+#define TRAFFIC_MAX_CHUNKS 64   /**< Наибольшая длина циклического шаблона порций */
+
+/**
+ * @struct TrafficDistribution
+ * @brief Распределение целых значений (тип или размер тела).
+ *
+ * При count == 0 значение равномерно в [min, max], иначе выбирается одно из
+ * values[i] с вероятностью, пропорциональной weights[i].
+ */
+typedef struct {
+    unsigned int min;                          /**< Нижняя граница равномерного распределения */
+    unsigned int max;                          /**< Верхняя граница равномерного распределения */
+    int count;                                 /**< Число значений во взвешенном распределении */
+    unsigned int values[TRAFFIC_MAX_WEIGHTS];  /**< Значения */
+    double weights[TRAFFIC_MAX_WEIGHTS];       /**< Веса значений */
+} TrafficDistribution;
+
+/**
+ * @struct TrafficConfig
+ * @brief Параметры генератора.
+ */
+typedef struct {
+    uint64_t seed;                  /**< Начальное значение генератора случайных чисел */
+    uint64_t packets;               /**< Сколько пакетов выдать (0 - без ограничения) */
+    TrafficDistribution types;      /**< Распределение типов */
+    TrafficDistribution sizes;      /**< Распределение размеров тела (обрезается до MAX_PACKET_SIZE) */
+    int padding;                    /**< Байтов 0x00 после каждого пакета (parse_uart дочитывает один лишний байт после тела) */
+
+    double bit_error_rate;          /**< Вероятность инверсии одного бита в байте */
+    double drop_rate;               /**< Вероятность выпадения байта */
+    double false_sync_rate;         /**< Доля пакетов с синхропоследовательностью внутри тела */
+
+    size_t chunk_min;               /**< Наименьшая порция (равномерно в [chunk_min, chunk_max]) */
+    size_t chunk_max;               /**< Наибольшая порция */
+    int chunk_pattern_length;       /**< Длина циклического шаблона порций (0 - равномерно) */
+    size_t chunk_pattern[TRAFFIC_MAX_CHUNKS]; /**< Циклический шаблон размеров порций */
+
+    double bytes_per_second;        /**< Ограничение скорости в байтах (0 - нет) */
+    double packets_per_second;      /**< Ограничение скорости в пакетах (0 - нет) */
+} TrafficConfig;
+
+/**
+ * @struct TrafficStats
+ * @brief Что именно выдал генератор.
+ */
+typedef struct {
+    uint64_t packets;         /**< Сгенерировано пакетов */
+    uint64_t intact_packets;  /**< Пакеты без искажений и выпавших байтов */
+    uint64_t bytes;           /**< Выдано байтов */
+    uint64_t flipped_bits;    /**< Инвертировано битов */
+    uint64_t dropped_bytes;   /**< Выброшено байтов */
+    uint64_t false_syncs;     /**< Вставлено ложных синхропоследовательностей */
+    uint64_t chunks;          /**< Выдано порций */
+} TrafficStats;
+
+/**
+ * @struct TrafficGenerator
+ * @brief Состояние генератора.
+ */
+typedef struct {
+    TrafficConfig config;      /**< Параметры */
+    uint64_t rng;              /**< Состояние генератора случайных чисел */
+    TrafficStats stats;        /**< Счётчики */
+    int chunk_index;           /**< Позиция в шаблоне порций */
+    unsigned char pending[SYNC_SEQUENCE_LENGTH + MAX_HEADER_SIZE + MAX_PACKET_SIZE + 16]; /**< Текущий пакет */
+    size_t pending_length;     /**< Длина текущего пакета */
+    size_t pending_pos;        /**< Сколько байтов текущего пакета уже выдано */
+    uint64_t start_time;       /**< Начало выдачи для ограничения скорости */
+} TrafficGenerator;
+
+/**
+ * @brief Тип приёмника порций потока.
+ *
+ * @param context Контекст приёмника.
+ * @param data Порция.
+ * @param length Длина порции.
+ * @return Возвращает 0 при успехе или -1, чтобы остановить выдачу.
+ */
+typedef int (*TrafficSink)(void *context, const unsigned char *data, size_t length);
+
+/**
+ * @brief Параметры по умолчанию.
+ *
+ * Типы 0..127, размеры 0..64, один байт заполнения, без искажений,
+ * порции по 256 байтов, без ограничения скорости и числа пакетов.
+ *
+ * @param config Указатель на параметры.
+ */
+void traffic_default_config(TrafficConfig *config);
+
+/**
+ * @brief Разбирает распределение из строки.
+ *
+ * Формат "min-max" (равномерное), "value" (постоянное) или
+ * "value:weight,value:weight,..." (взвешенное).
+ *
+ * @param text Строка.
+ * @param distribution Результат.
+ * @return Возвращает 0 при успехе или -1 при ошибке формата.
+ */
+int traffic_parse_distribution(const char *text, TrafficDistribution *distribution);
+
+/**
+ * @brief Инициализирует генератор.
+ *
+ * @param generator Указатель на генератор.
+ * @param config Параметры (копируются).
+ * @return Возвращает 0 при успехе или -1 при недопустимых параметрах.
+ */
+int traffic_gen_init(TrafficGenerator *generator, const TrafficConfig *config);
+
+/**
+ * @brief Заполняет буфер потоком без учёта шаблона порций и скорости.
+ *
+ * @param generator Указатель на генератор.
+ * @param buffer Буфер.
+ * @param capacity Размер буфера.
+ * @return Число записанных байтов; меньше capacity только по исчерпании config.packets.
+ */
+size_t traffic_gen_fill(TrafficGenerator *generator, unsigned char *buffer, size_t capacity);
+
+/**
+ * @brief Выдаёт следующую порцию по шаблону порций.
+ *
+ * @param generator Указатель на генератор.
+ * @param buffer Буфер.
+ * @param capacity Размер буфера (порция обрезается до него).
+ * @return Длина порции; 0 - поток закончился.
+ */
+size_t traffic_gen_next_chunk(TrafficGenerator *generator, unsigned char *buffer, size_t capacity);
+
+/**
+ * @brief Выдаёт поток порциями в приёмник с ограничением скорости.
+ *
+ * Работает до исчерпания config.packets или до ошибки приёмника.
+ *
+ * @param generator Указатель на генератор.
+ * @param sink Приёмник.
+ * @param context Контекст приёмника.
+ * @return Возвращает 0, если поток выдан целиком, или -1 при ошибке приёмника.
+ */
+int traffic_gen_run(TrafficGenerator *generator, TrafficSink sink, void *context);
+
+/**
+ * @brief Приёмник, пишущий в FILE* (context).
+ */
+int traffic_sink_file(void *context, const unsigned char *data, size_t length);
+
+#ifndef _WIN32
+/**
+ * @brief Приёмник, пишущий в дескриптор (context указывает на int).
+ *
+ * Подходит для файла, канала, стороны master псевдотерминала и порта.
+ * Неблокирующий дескриптор ожидается через poll.
+ */
+int traffic_sink_fd(void *context, const unsigned char *data, size_t length);
+#endif
+
+/**
+ * @struct TrafficFifoSink
+ * @brief Контекст приёмника traffic_sink_fifo.
+ */
+typedef struct {
+    FIFO_Buffer *fifo;  /**< FIFO, куда пишутся порции */
+    Parser *parser;     /**< Парсер этого FIFO (NULL - только запись) */
+} TrafficFifoSink;
+
+/**
+ * @brief Приёмник, пишущий порции в FIFO_Buffer и сразу разбирающий их.
+ *
+ * Если parser задан, после каждой порции вызывается parse_uart.
+ * Без парсера порция, не помещающаяся в FIFO, даёт ошибку.
+ */
+int traffic_sink_fifo(void *context, const unsigned char *data, size_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TRAFFIC_GEN_H
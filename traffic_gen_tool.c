@@ -0,0 +1,218 @@
+// Генератор нагрузочного потока (traffic_gen.h).
+//
+// Использование: traffic_gen [параметры]
+//   --seed=N              начальное значение (1)
+//   --packets=N           число пакетов (100000, 0 - без ограничения)
+//   --types=SPEC          распределение типов: "min-max", "v" или "v:w,v:w,..." (0-127)
+//   --sizes=SPEC          распределение размеров тела (0-64)
+//   --padding=N           байтов 0x00 после пакета (1)
+//   --bit-errors=P        вероятность инверсии бита на байт
+//   --drops=P             вероятность выпадения байта
+//   --false-sync=P        доля пакетов с синхропоследовательностью в теле
+//   --chunks=SPEC         порции: "min-max" или циклический шаблон "a,b,c" (256)
+//   --rate=B              ограничение скорости, байт/с
+//   --pps=N               ограничение скорости, пакетов/с
+//   --out=DEST            parse (по умолчанию) - разбор в FIFO_Buffer с отчётом о потерях,
+//                         file:PATH, fd:N, tty:PATH или pty (имя стороны slave печатается в stderr)
+//   --profile=PATH        после разбора записать счётчики стадий (parser_profile.h) в PATH;
+//                         только в сборке с PARSER_PROFILE и при --out=parse
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "monotonic_clock.h"
+#include "traffic_gen.h"
+#if PARSER_PROFILE
+#include "parser_profile.h"
+#endif
+#ifdef __linux__
+#include "serial_port.h"
+#endif
+
+static unsigned long long g_parsed;
+
+static void count_packet(void *context, unsigned int type, unsigned char *data, unsigned int size) {
+    (void)context;
+    (void)type;
+    (void)data;
+    (void)size;
+    g_parsed++;
+}
+
+static int parse_chunks(const char *text, TrafficConfig *config) {
+    char *end;
+    if (strchr(text, ',') == NULL) {
+        TrafficDistribution range;
+        if (traffic_parse_distribution(text, &range) != 0 || range.count != 0 || range.min == 0) {
+            return -1;
+        }
+        config->chunk_min = range.min;
+        config->chunk_max = range.max;
+        return 0;
+    }
+    config->chunk_pattern_length = 0;
+    while (*text != '\0') {
+        if (config->chunk_pattern_length == TRAFFIC_MAX_CHUNKS) {
+            return -1;
+        }
+        config->chunk_pattern[config->chunk_pattern_length] = strtoul(text, &end, 0);
+        if (end == text || config->chunk_pattern[config->chunk_pattern_length] == 0 || (*end != ',' && *end != '\0')) {
+            return -1;
+        }
+        config->chunk_pattern_length++;
+        text = *end == ',' ? end + 1 : end;
+    }
+    return 0;
+}
+
+static const char *option_value(const char *arg, const char *name) {
+    size_t length = strlen(name);
+    if (strncmp(arg, name, length) == 0 && arg[length] == '=') {
+        return arg + length + 1;
+    }
+    return NULL;
+}
+
+static void print_stats(const TrafficStats *stats, double seconds) {
+    fprintf(stderr, "generated %llu packets (%llu intact), %llu bytes in %llu chunks, %.3f s\n",
+            (unsigned long long)stats->packets, (unsigned long long)stats->intact_packets,
+            (unsigned long long)stats->bytes, (unsigned long long)stats->chunks, seconds);
+    fprintf(stderr, "impairments: %llu flipped bits, %llu dropped bytes, %llu false syncs\n",
+            (unsigned long long)stats->flipped_bits, (unsigned long long)stats->dropped_bytes,
+            (unsigned long long)stats->false_syncs);
+}
+
+int main(int argc, char **argv) {
+    TrafficConfig config;
+    TrafficGenerator generator;
+    const char *out = "parse";
+#if PARSER_PROFILE
+    const char *profile = NULL;
+#endif
+    uint64_t start;
+    int result;
+
+    traffic_default_config(&config);
+    config.packets = 100000;
+    for (int i = 1; i < argc; i++) {
+        const char *value;
+        int ok = 1;
+        if ((value = option_value(argv[i], "--seed")) != NULL) {
+            config.seed = strtoull(value, NULL, 0);
+        } else if ((value = option_value(argv[i], "--packets")) != NULL) {
+            config.packets = strtoull(value, NULL, 0);
+        } else if ((value = option_value(argv[i], "--types")) != NULL) {
+            ok = traffic_parse_distribution(value, &config.types) == 0;
+        } else if ((value = option_value(argv[i], "--sizes")) != NULL) {
+            ok = traffic_parse_distribution(value, &config.sizes) == 0;
+        } else if ((value = option_value(argv[i], "--padding")) != NULL) {
+            config.padding = atoi(value);
+        } else if ((value = option_value(argv[i], "--bit-errors")) != NULL) {
+            config.bit_error_rate = strtod(value, NULL);
+        } else if ((value = option_value(argv[i], "--drops")) != NULL) {
+            config.drop_rate = strtod(value, NULL);
+        } else if ((value = option_value(argv[i], "--false-sync")) != NULL) {
+            config.false_sync_rate = strtod(value, NULL);
+        } else if ((value = option_value(argv[i], "--chunks")) != NULL) {
+            ok = parse_chunks(value, &config) == 0;
+        } else if ((value = option_value(argv[i], "--rate")) != NULL) {
+            config.bytes_per_second = strtod(value, NULL);
+        } else if ((value = option_value(argv[i], "--pps")) != NULL) {
+            config.packets_per_second = strtod(value, NULL);
+        } else if ((value = option_value(argv[i], "--out")) != NULL) {
+            out = value;
+        } else if ((value = option_value(argv[i], "--profile")) != NULL) {
+#if PARSER_PROFILE
+            profile = value;
+#else
+            fprintf(stderr, "%s: --profile needs a build with PARSER_PROFILE\n", argv[0]);
+            return EXIT_FAILURE;
+#endif
+        } else {
+            ok = 0;
+        }
+        if (!ok) {
+            fprintf(stderr, "%s: bad option %s (see the header of traffic_gen_tool.c)\n", argv[0], argv[i]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (traffic_gen_init(&generator, &config) != 0) {
+        fprintf(stderr, "%s: invalid generator configuration\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    start = monotonic_clock_ns(NULL);
+    if (strcmp(out, "parse") == 0) {
+        static FIFO_Buffer fifo;
+        static Parser parser;
+        TrafficFifoSink sink;
+        double seconds;
+        init_fifo(&fifo);
+        init_parser(&parser, &fifo, NULL);
+        parser_set_handler(&parser, count_packet, NULL);
+        parser_set_event_sink(&parser, NULL, NULL);
+        sink.fifo = &fifo;
+        sink.parser = &parser;
+        result = traffic_gen_run(&generator, traffic_sink_fifo, &sink);
+        seconds = (double)(monotonic_clock_ns(NULL) - start) * 1e-9;
+        print_stats(&generator.stats, seconds);
+        fprintf(stderr, "parsed %llu packets (%.2f%% of generated), %.1f MB/s; checksum errors %llu, resyncs %llu\n",
+                g_parsed, generator.stats.packets ? 100.0 * (double)g_parsed / (double)generator.stats.packets : 0.0,
+                seconds > 0.0 ? (double)generator.stats.bytes / seconds / 1e6 : 0.0,
+                (unsigned long long)parser.stats.checksum_failures, (unsigned long long)parser.stats.resync_events);
+#if PARSER_PROFILE
+        if (profile != NULL && parser_profile_export_file(profile) != 0) {
+            fprintf(stderr, "%s: cannot write profile to %s\n", argv[0], profile);
+            result = -1;
+        }
+#endif
+        return result == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (strncmp(out, "file:", 5) == 0) {
+        FILE *file = fopen(out + 5, "wb");
+        if (file == NULL) {
+            perror(out + 5);
+            return EXIT_FAILURE;
+        }
+        result = traffic_gen_run(&generator, traffic_sink_file, file);
+        if (fclose(file) != 0) {
+            result = -1;
+        }
+#ifndef _WIN32
+    } else if (strncmp(out, "fd:", 3) == 0) {
+        int fd = atoi(out + 3);
+        result = traffic_gen_run(&generator, traffic_sink_fd, &fd);
+#endif
+#ifdef __linux__
+    } else if (strncmp(out, "tty:", 4) == 0) {
+        SerialPortConfig port_config;
+        int fd;
+        serial_port_default_config(&port_config);
+        fd = serial_port_open(out + 4, &port_config);
+        if (fd < 0) {
+            perror(out + 4);
+            return EXIT_FAILURE;
+        }
+        result = traffic_gen_run(&generator, traffic_sink_fd, &fd);
+    } else if (strcmp(out, "pty") == 0) {
+        SerialPortConfig port_config;
+        int master;
+        int slave;
+        serial_port_default_config(&port_config);
+        if (serial_open_pty_pair(&master, &slave, &port_config) != 0) {
+            perror("pty");
+            return EXIT_FAILURE;
+        }
+        // Сторона slave остаётся открытой, чтобы данные не терялись до подключения читателя
+        fprintf(stderr, "pty: %s\n", ptsname(master));
+        result = traffic_gen_run(&generator, traffic_sink_fd, &master);
+#endif
+    } else {
+        fprintf(stderr, "%s: unknown output %s\n", argv[0], out);
+        return EXIT_FAILURE;
+    }
+    print_stats(&generator.stats, (double)(monotonic_clock_ns(NULL) - start) * 1e-9);
+    return result == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,229 @@
+/**
+ * @file type_dispatch.c
+ * @brief Реализация распределителя с очередями по типам.
+ */
+#include "type_dispatch.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static void free_shards(TypeDispatcher *dispatcher) {
+    if (dispatcher->shards != NULL) {
+        for (int i = 0; i < dispatcher->shard_count; i++) {
+            free(dispatcher->shards[i].items);
+            free(dispatcher->shards[i].sequence);
+        }
+    }
+    free(dispatcher->shards);
+    free(dispatcher->workers);
+    dispatcher->shards = NULL;
+    dispatcher->workers = NULL;
+    dispatcher->shard_count = 0;
+}
+
+int type_dispatcher_init(TypeDispatcher *dispatcher, int worker_count, int shard_count, int capacity) {
+    memset(dispatcher, 0, sizeof(*dispatcher));
+    if (worker_count <= 0 || shard_count <= 0 || capacity <= 0) {
+        return -1;
+    }
+    dispatcher->shards = calloc((size_t)shard_count, sizeof(TypeShard));
+    dispatcher->workers = calloc((size_t)worker_count, sizeof(TypeDispatchWorker));
+    if (dispatcher->shards == NULL || dispatcher->workers == NULL) {
+        goto fail;
+    }
+    dispatcher->shard_count = shard_count;
+    dispatcher->worker_count = worker_count;
+    dispatcher->capacity = capacity;
+    for (int i = 0; i < shard_count; i++) {
+        TypeShard *shard = &dispatcher->shards[i];
+        shard->items = malloc((size_t)capacity * sizeof(void *));
+        shard->sequence = malloc((size_t)capacity * sizeof(uint32_t));
+        if (shard->items == NULL || shard->sequence == NULL) {
+            goto fail;
+        }
+        shard->home = i % worker_count;
+        shard->owner = -1;
+        shard->last_worker = -1;
+        shard->next_ready = -1;
+    }
+    for (int i = 0; i < worker_count; i++) {
+        dispatcher->workers[i].ready_head = -1;
+        dispatcher->workers[i].ready_tail = -1;
+        dispatcher->workers[i].current = -1;
+    }
+    pthread_mutex_init(&dispatcher->lock, NULL);
+    pthread_cond_init(&dispatcher->work, NULL);
+    return 0;
+
+fail:
+    free_shards(dispatcher);
+    return -1;
+}
+
+void type_dispatcher_destroy(TypeDispatcher *dispatcher) {
+    pthread_cond_destroy(&dispatcher->work);
+    pthread_mutex_destroy(&dispatcher->lock);
+    free_shards(dispatcher);
+}
+
+int type_dispatcher_shard(const TypeDispatcher *dispatcher, unsigned int type) {
+    // Перемешивание Фибоначчи: соседние типы расходятся по разным очередям
+    uint32_t hash = (uint32_t)type * 0x9E3779B1u;
+    return (int)((hash ^ (hash >> 16)) % (uint32_t)dispatcher->shard_count);
+}
+
+// Ставит очередь в конец списка готовых её домашнего потока (под мьютексом)
+static void make_ready(TypeDispatcher *dispatcher, int index) {
+    TypeShard *shard = &dispatcher->shards[index];
+    TypeDispatchWorker *home = &dispatcher->workers[shard->home];
+    shard->ready = 1;
+    shard->next_ready = -1;
+    if (home->ready_tail >= 0) {
+        dispatcher->shards[home->ready_tail].next_ready = index;
+    } else {
+        home->ready_head = index;
+    }
+    home->ready_tail = index;
+    home->ready_count++;
+    if (dispatcher->idle > 0) {
+        pthread_cond_signal(&dispatcher->work);
+    }
+}
+
+// Снимает первую очередь из списка готовых потока (под мьютексом)
+static int take_ready(TypeDispatcher *dispatcher, TypeDispatchWorker *worker) {
+    int index = worker->ready_head;
+    if (index < 0) {
+        return -1;
+    }
+    worker->ready_head = dispatcher->shards[index].next_ready;
+    if (worker->ready_head < 0) {
+        worker->ready_tail = -1;
+    }
+    worker->ready_count--;
+    dispatcher->shards[index].ready = 0;
+    return index;
+}
+
+int type_dispatcher_push(TypeDispatcher *dispatcher, unsigned int type, void *item) {
+    int index = type_dispatcher_shard(dispatcher, type);
+    TypeShard *shard = &dispatcher->shards[index];
+    int slot;
+    pthread_mutex_lock(&dispatcher->lock);
+    if (dispatcher->closed || shard->count == dispatcher->capacity) {
+        pthread_mutex_unlock(&dispatcher->lock);
+        return -1;
+    }
+    slot = (shard->head + shard->count) % dispatcher->capacity;
+    shard->items[slot] = item;
+    shard->sequence[slot] = shard->pushed++;
+    shard->count++;
+    // Очередь, которую держит поток, вернётся в список готовых при освобождении
+    if (shard->owner < 0 && !shard->ready) {
+        make_ready(dispatcher, index);
+    }
+    pthread_mutex_unlock(&dispatcher->lock);
+    return 0;
+}
+
+int type_dispatcher_pop(TypeDispatcher *dispatcher, int worker_index, void **items, int max_items) {
+    TypeDispatchWorker *worker = &dispatcher->workers[worker_index];
+    TypeShard *shard;
+    int index;
+    int count;
+    pthread_mutex_lock(&dispatcher->lock);
+    if (worker->current >= 0) {
+        shard = &dispatcher->shards[worker->current];
+        shard->owner = -1;
+        if (shard->count > 0) {
+            make_ready(dispatcher, worker->current);
+        }
+        worker->current = -1;
+    }
+    for (;;) {
+        index = take_ready(dispatcher, worker);
+        if (index >= 0) {
+            break;
+        }
+        // Кража целой очереди у потока с самым длинным списком готовых
+        int victim = -1;
+        for (int i = 0; i < dispatcher->worker_count; i++) {
+            if (dispatcher->workers[i].ready_count > 0 &&
+                (victim < 0 || dispatcher->workers[i].ready_count > dispatcher->workers[victim].ready_count)) {
+                victim = i;
+            }
+        }
+        if (victim >= 0) {
+            index = take_ready(dispatcher, &dispatcher->workers[victim]);
+            worker->shards_stolen++;
+            break;
+        }
+        if (dispatcher->closed) {
+            pthread_mutex_unlock(&dispatcher->lock);
+            return 0;
+        }
+        worker->idle_waits++;
+        dispatcher->idle++;
+        pthread_cond_wait(&dispatcher->work, &dispatcher->lock);
+        dispatcher->idle--;
+    }
+
+    shard = &dispatcher->shards[index];
+    shard->owner = worker_index;
+    if (shard->last_worker >= 0 && shard->last_worker != worker_index) {
+        dispatcher->migrations++;
+    }
+    shard->last_worker = worker_index;
+    worker->current = index;
+    worker->shards_taken++;
+    worker->batches++;
+
+    count = shard->count < max_items ? shard->count : max_items;
+    for (int i = 0; i < count; i++) {
+        if (shard->sequence[shard->head] != shard->popped) {
+            dispatcher->order_violations++;
+        }
+        shard->popped = shard->sequence[shard->head] + 1;
+        items[i] = shard->items[shard->head];
+        shard->head = (shard->head + 1) % dispatcher->capacity;
+    }
+    shard->count -= count;
+    worker->items += (uint64_t)count;
+    pthread_mutex_unlock(&dispatcher->lock);
+    return count;
+}
+
+void type_dispatcher_close(TypeDispatcher *dispatcher) {
+    pthread_mutex_lock(&dispatcher->lock);
+    dispatcher->closed = 1;
+    pthread_cond_broadcast(&dispatcher->work);
+    pthread_mutex_unlock(&dispatcher->lock);
+}
+
+void type_dispatcher_report(TypeDispatcher *dispatcher, TypeDispatchReport *report) {
+    memset(report, 0, sizeof(*report));
+    pthread_mutex_lock(&dispatcher->lock);
+    report->min_worker_items = UINT64_MAX;
+    for (int i = 0; i < dispatcher->worker_count; i++) {
+        const TypeDispatchWorker *worker = &dispatcher->workers[i];
+        report->items += worker->items;
+        report->shards_taken += worker->shards_taken;
+        report->shards_stolen += worker->shards_stolen;
+        if (worker->items < report->min_worker_items) {
+            report->min_worker_items = worker->items;
+        }
+        if (worker->items > report->max_worker_items) {
+            report->max_worker_items = worker->items;
+        }
+    }
+    for (int i = 0; i < dispatcher->shard_count; i++) {
+        if (dispatcher->shards[i].pushed > 0) {
+            report->active_shards++;
+        }
+    }
+    report->migrations = dispatcher->migrations;
+    report->order_violations = dispatcher->order_violations;
+    report->imbalance = report->items > 0
+        ? (double)report->max_worker_items * dispatcher->worker_count / (double)report->items : 1.0;
+    pthread_mutex_unlock(&dispatcher->lock);
+}
@@ -0,0 +1,162 @@
+/**
+ * @file type_dispatch.h
+ * @brief Распределение пакетов по рабочим потокам с очередями по типам.
+ *
+ * Пакеты раскладываются по очередям типов (TypeShard) по хешу типа, поэтому
+ * пакеты одного типа всегда попадают в одну очередь. У каждой очереди есть
+ * «домашний» рабочий поток. Поток берёт очередь целиком и, пока держит её,
+ * обрабатывает её пакеты по порядку; другой поток эту очередь не получит.
+ * Если у потока нет готовых очередей, он забирает (крадёт) целую очередь
+ * у самого загруженного соседа. Так порядок внутри типа сохраняется, а
+ * нагрузка выравнивается без разбиения очередей на отдельные пакеты.
+ */
+#ifndef TYPE_DISPATCH_H
+#define TYPE_DISPATCH_H
+
+#include <pthread.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @struct TypeShard
+ * @brief Очередь пакетов одной группы типов.
+ */
+typedef struct {
+    void **items;          /**< Кольцевой массив элементов */
+    uint32_t *sequence;    /**< Порядковые номера элементов */
+    int head;              /**< Индекс первого элемента */
+    int count;             /**< Число элементов */
+    int home;              /**< Домашний рабочий поток */
+    int owner;             /**< Поток, который держит очередь (-1 - никто) */
+    int last_worker;       /**< Поток, который держал очередь последним */
+    int ready;             /**< Очередь стоит в списке готовых */
+    int next_ready;        /**< Следующая очередь в списке готовых (-1 - конец) */
+    uint32_t pushed;       /**< Номер следующего добавленного элемента */
+    uint32_t popped;       /**< Номер следующего ожидаемого элемента */
+} TypeShard;
+
+/**
+ * @struct TypeDispatchWorker
+ * @brief Список готовых очередей и счётчики одного рабочего потока.
+ */
+typedef struct {
+    int ready_head;          /**< Первая готовая очередь (-1 - нет) */
+    int ready_tail;          /**< Последняя готовая очередь */
+    int ready_count;         /**< Число готовых очередей */
+    int current;             /**< Очередь, которую поток держит сейчас (-1 - нет) */
+    uint64_t items;          /**< Обработано элементов */
+    uint64_t batches;        /**< Получено порций */
+    uint64_t shards_taken;   /**< Взято очередей (включая украденные) */
+    uint64_t shards_stolen;  /**< Украдено очередей у других потоков */
+    uint64_t idle_waits;     /**< Сколько раз поток ждал работы */
+} TypeDispatchWorker;
+
+/**
+ * @struct TypeDispatchReport
+ * @brief Итоги распределения.
+ */
+typedef struct {
+    uint64_t items;             /**< Всего выдано элементов */
+    uint64_t shards_taken;      /**< Всего взято очередей */
+    uint64_t shards_stolen;     /**< Из них украдено */
+    uint64_t migrations;        /**< Сколько раз очередь переходила к другому потоку */
+    uint64_t order_violations;  /**< Элементы, выданные не по порядку своей очереди (должно быть 0) */
+    int active_shards;          /**< Очередей, через которые прошёл хотя бы один элемент */
+    uint64_t min_worker_items;  /**< Наименьшая нагрузка потока */
+    uint64_t max_worker_items;  /**< Наибольшая нагрузка потока */
+    double imbalance;           /**< Наибольшая нагрузка потока к средней (1.0 - идеально ровно) */
+} TypeDispatchReport;
+
+/**
+ * @struct TypeDispatcher
+ * @brief Состояние распределителя.
+ */
+typedef struct {
+    TypeShard *shards;            /**< Очереди типов */
+    int shard_count;              /**< Число очередей */
+    int capacity;                 /**< Ёмкость каждой очереди */
+    TypeDispatchWorker *workers;  /**< Рабочие потоки */
+    int worker_count;             /**< Число рабочих потоков */
+    int idle;                     /**< Потоков, ждущих работы */
+    int closed;                   /**< Распределитель закрыт */
+    uint64_t migrations;          /**< Переходы очередей между потоками */
+    uint64_t order_violations;    /**< Нарушения порядка внутри очереди */
+    pthread_mutex_t lock;         /**< Мьютекс распределителя */
+    pthread_cond_t work;          /**< Сигнал о готовой очереди */
+} TypeDispatcher;
+
+/**
+ * @brief Создаёт распределитель.
+ *
+ * @param dispatcher Указатель на распределитель.
+ * @param worker_count Число рабочих потоков.
+ * @param shard_count Число очередей типов (больше worker_count даёт чем выравнивать нагрузку).
+ * @param capacity Ёмкость очереди: не меньше числа элементов, одновременно находящихся в распределителе.
+ * @return Возвращает 0 при успехе, -1 при ошибке.
+ */
+int type_dispatcher_init(TypeDispatcher *dispatcher, int worker_count, int shard_count, int capacity);
+
+/**
+ * @brief Освобождает ресурсы распределителя.
+ *
+ * @param dispatcher Указатель на распределитель.
+ */
+void type_dispatcher_destroy(TypeDispatcher *dispatcher);
+
+/**
+ * @brief Номер очереди для типа.
+ *
+ * @param dispatcher Указатель на распределитель.
+ * @param type Тип пакета.
+ * @return Номер очереди.
+ */
+int type_dispatcher_shard(const TypeDispatcher *dispatcher, unsigned int type);
+
+/**
+ * @brief Добавляет элемент в очередь его типа.
+ *
+ * @param dispatcher Указатель на распределитель.
+ * @param type Тип пакета.
+ * @param item Элемент.
+ * @return Возвращает 0 при успехе, -1 если распределитель закрыт или очередь переполнена.
+ */
+int type_dispatcher_push(TypeDispatcher *dispatcher, unsigned int type, void *item);
+
+/**
+ * @brief Выдаёт рабочему потоку порцию элементов одной очереди.
+ *
+ * Очередь, полученная предыдущим вызовом, считается обработанной и
+ * освобождается. Поток сначала берёт свои готовые очереди, затем крадёт
+ * очередь у соседа с самым длинным списком готовых, иначе ждёт.
+ *
+ * @param dispatcher Указатель на распределитель.
+ * @param worker Номер рабочего потока.
+ * @param items Массив для элементов.
+ * @param max_items Наибольшая порция.
+ * @return Число элементов; 0 - распределитель закрыт и все элементы выданы.
+ */
+int type_dispatcher_pop(TypeDispatcher *dispatcher, int worker, void **items, int max_items);
+
+/**
+ * @brief Закрывает распределитель: новые элементы не принимаются, ждущие потоки просыпаются.
+ *
+ * @param dispatcher Указатель на распределитель.
+ */
+void type_dispatcher_close(TypeDispatcher *dispatcher);
+
+/**
+ * @brief Собирает итоги порядка и нагрузки.
+ *
+ * @param dispatcher Указатель на распределитель.
+ * @param report Результат.
+ */
+void type_dispatcher_report(TypeDispatcher *dispatcher, TypeDispatchReport *report);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TYPE_DISPATCH_H
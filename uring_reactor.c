@@ -0,0 +1,337 @@
+/**
+ * @file uring_reactor.c
+ * @brief Реализация приёма через io_uring на прямых системных вызовах.
+ */
+#define _GNU_SOURCE
+#include "uring_reactor.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+static int uring_setup(unsigned int entries, struct io_uring_params *params) {
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int uring_enter(int fd, unsigned int submit, unsigned int min_complete, unsigned int flags,
+                       const void *arg, size_t arg_size) {
+    return (int)syscall(__NR_io_uring_enter, fd, submit, min_complete, flags, arg, arg_size);
+}
+
+static int uring_register(int fd, unsigned int opcode, const void *arg, unsigned int count) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, count);
+}
+
+static unsigned int load_acquire(unsigned int *p) {
+    return atomic_load_explicit((_Atomic unsigned int *)p, memory_order_acquire);
+}
+
+static void store_release(unsigned int *p, unsigned int value) {
+    atomic_store_explicit((_Atomic unsigned int *)p, value, memory_order_release);
+}
+
+// user_data таймаутов ожидания: у чтений - номер канала, у IORING_OP_TIMEOUT - метка и поколение
+#define URING_TIMEOUT_TAG (1ull << 63)
+#define URING_TIMEOUT_REMOVE_TAG UINT64_MAX
+
+static struct io_uring_sqe *next_sqe(UringReactor *reactor) {
+    unsigned int slot = reactor->sq_local_tail & *reactor->sq_mask;
+    struct io_uring_sqe *sqe = &reactor->sqes[slot];
+    memset(sqe, 0, sizeof(*sqe));
+    reactor->sq_array[slot] = slot;
+    reactor->sq_local_tail++;
+    reactor->pending++;
+    return sqe;
+}
+
+// Ставит в очередь чтение в первый непрерывный участок свободного места FIFO канала.
+// Без свободного места канал запоминается и чтение ставится в следующем uring_reactor_poll:
+// иначе его никто не поставит, ведь новые чтения ставятся только по завершениям.
+static void arm_read(UringReactor *reactor, int index) {
+    SerialChannel *channel = &reactor->channels[index];
+    unsigned char *first;
+    unsigned char *second;
+    int first_length;
+    int second_length;
+    fifo_write_regions(&channel->fifo, &first, &first_length, &second, &second_length);
+    if (first_length == 0) {
+        channel->fifo_full++;
+        reactor->starved[reactor->starved_count++] = index;
+        return;
+    }
+    struct io_uring_sqe *sqe = next_sqe(reactor);
+    if (first >= channel->fifo.buffer && first < channel->fifo.buffer + sizeof(channel->fifo.buffer)) {
+        sqe->opcode = IORING_OP_READ_FIXED;
+        sqe->buf_index = (uint16_t)index;
+    } else {
+        // Сегмент пула растущего FIFO не входит в зарегистрированный буфер: обычное чтение
+        sqe->opcode = IORING_OP_READ;
+    }
+    sqe->fd = channel->fd;
+    sqe->addr = (uint64_t)(uintptr_t)first;
+    sqe->len = (unsigned int)first_length;
+    sqe->off = (uint64_t)-1; // Текущая позиция: у терминалов смещения нет
+    sqe->user_data = (uint64_t)index;
+    reactor->armed[index] = 1;
+    channel->read_calls++;
+}
+
+int uring_reactor_init(UringReactor *reactor, SerialChannel *channels, int count) {
+    memset(reactor, 0, sizeof(*reactor));
+    reactor->ring_fd = -1;
+    reactor->channels = channels;
+    reactor->channel_count = count;
+    reactor->active = count;
+
+    // На каждый канал не больше одного чтения в полёте плюс таймаут ожидания и его снятие,
+    // так что SQ не переполнится
+    unsigned int entries = 8;
+    while (entries < (unsigned int)count + 2) {
+        entries <<= 1;
+    }
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    reactor->ring_fd = uring_setup(entries, &params);
+    if (reactor->ring_fd < 0) {
+        return -1;
+    }
+    reactor->features = params.features;
+
+    reactor->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    reactor->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (reactor->cq_ring_size > reactor->sq_ring_size) {
+            reactor->sq_ring_size = reactor->cq_ring_size;
+        }
+        reactor->cq_ring_size = reactor->sq_ring_size;
+    }
+    reactor->sq_ring = mmap(NULL, reactor->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                            reactor->ring_fd, IORING_OFF_SQ_RING);
+    if (reactor->sq_ring == MAP_FAILED) {
+        reactor->sq_ring = NULL;
+        uring_reactor_destroy(reactor);
+        return -1;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        reactor->cq_ring = reactor->sq_ring;
+    } else {
+        reactor->cq_ring = mmap(NULL, reactor->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                reactor->ring_fd, IORING_OFF_CQ_RING);
+        if (reactor->cq_ring == MAP_FAILED) {
+            reactor->cq_ring = NULL;
+            uring_reactor_destroy(reactor);
+            return -1;
+        }
+    }
+    reactor->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    reactor->sqes = mmap(NULL, reactor->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         reactor->ring_fd, IORING_OFF_SQES);
+    if (reactor->sqes == MAP_FAILED) {
+        reactor->sqes = NULL;
+        uring_reactor_destroy(reactor);
+        return -1;
+    }
+
+    char *sq = (char *)reactor->sq_ring;
+    char *cq = (char *)reactor->cq_ring;
+    reactor->sq_tail = (unsigned int *)(sq + params.sq_off.tail);
+    reactor->sq_mask = (unsigned int *)(sq + params.sq_off.ring_mask);
+    reactor->sq_array = (unsigned int *)(sq + params.sq_off.array);
+    reactor->sq_local_tail = *reactor->sq_tail;
+    reactor->cq_head = (unsigned int *)(cq + params.cq_off.head);
+    reactor->cq_tail = (unsigned int *)(cq + params.cq_off.tail);
+    reactor->cq_mask = (unsigned int *)(cq + params.cq_off.ring_mask);
+    reactor->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+
+    reactor->ready = malloc((size_t)count * sizeof(int));
+    reactor->starved = malloc((size_t)count * sizeof(int));
+    reactor->armed = calloc((size_t)count, 1);
+    struct iovec *buffers = malloc((size_t)count * sizeof(struct iovec));
+    if (reactor->ready == NULL || reactor->starved == NULL || reactor->armed == NULL || buffers == NULL) {
+        free(buffers);
+        uring_reactor_destroy(reactor);
+        errno = ENOMEM;
+        return -1;
+    }
+    for (int i = 0; i < count; i++) {
+        int flags = fcntl(channels[i].fd, F_GETFL);
+        if (flags >= 0) {
+            fcntl(channels[i].fd, F_SETFL, flags & ~O_NONBLOCK);
+        }
+        buffers[i].iov_base = channels[i].fifo.buffer;
+        buffers[i].iov_len = sizeof(channels[i].fifo.buffer);
+    }
+    int registered = uring_register(reactor->ring_fd, IORING_REGISTER_BUFFERS, buffers, (unsigned int)count);
+    free(buffers);
+    if (registered < 0) {
+        uring_reactor_destroy(reactor);
+        return -1;
+    }
+
+    for (int i = 0; i < count; i++) {
+        arm_read(reactor, i);
+    }
+    return 0;
+}
+
+void uring_reactor_destroy(UringReactor *reactor) {
+    if (reactor->sqes != NULL) {
+        munmap(reactor->sqes, reactor->sqes_size);
+    }
+    if (reactor->cq_ring != NULL && reactor->cq_ring != reactor->sq_ring) {
+        munmap(reactor->cq_ring, reactor->cq_ring_size);
+    }
+    if (reactor->sq_ring != NULL) {
+        munmap(reactor->sq_ring, reactor->sq_ring_size);
+    }
+    if (reactor->ring_fd >= 0) {
+        close(reactor->ring_fd); // Ядро отменит висящие чтения
+    }
+    free(reactor->ready);
+    free(reactor->starved);
+    free(reactor->armed);
+    memset(reactor, 0, sizeof(*reactor));
+    reactor->ring_fd = -1;
+}
+
+// Ядра без IORING_FEAT_EXT_ARG не принимают срок в io_uring_enter: ожидание ограничивает
+// IORING_OP_TIMEOUT. Прежний таймаут, если он ещё не сработал, снимается, чтобы срок
+// отсчитывался от этого вызова. Возвращает число служебных завершений, которые появятся
+// сразу (снятие и снятый или уже сработавший прежний таймаут), чтобы ожидание их не считало.
+static unsigned int arm_timeout(UringReactor *reactor, int timeout_ms) {
+    unsigned int extra = 0;
+    struct io_uring_sqe *sqe;
+    if (reactor->timeout_armed) {
+        sqe = next_sqe(reactor);
+        sqe->opcode = IORING_OP_TIMEOUT_REMOVE;
+        sqe->fd = -1;
+        sqe->addr = URING_TIMEOUT_TAG | reactor->timeout_generation;
+        sqe->user_data = URING_TIMEOUT_REMOVE_TAG;
+        reactor->timeout_armed = 0;
+        extra = 2;
+    }
+    if (timeout_ms > 0) {
+        reactor->timeout_generation = (reactor->timeout_generation + 1) & (URING_TIMEOUT_TAG - 1);
+        reactor->wait_timeout.tv_sec = timeout_ms / 1000;
+        reactor->wait_timeout.tv_nsec = (long long)(timeout_ms % 1000) * 1000000;
+        sqe = next_sqe(reactor);
+        sqe->opcode = IORING_OP_TIMEOUT;
+        sqe->fd = -1;
+        sqe->addr = (uint64_t)(uintptr_t)&reactor->wait_timeout;
+        sqe->len = 1;
+        sqe->user_data = URING_TIMEOUT_TAG | reactor->timeout_generation;
+        reactor->timeout_armed = 1;
+    }
+    return extra;
+}
+
+// Повторно ставит чтения каналам, у FIFO которых не было места (читатель мог его освободить,
+// а растущему FIFO - вернуться сегменты в пул)
+static void retry_starved(UringReactor *reactor) {
+    int count = reactor->starved_count;
+    reactor->starved_count = 0;
+    for (int i = 0; i < count; i++) {
+        int index = reactor->starved[i];
+        parse_uart(&reactor->channels[index].parser);
+        arm_read(reactor, index);
+    }
+}
+
+int uring_reactor_poll(UringReactor *reactor, int timeout_ms) {
+    if (reactor->active == 0 && reactor->pending == 0) {
+        return 0;
+    }
+    if (reactor->starved_count > 0) {
+        retry_starved(reactor);
+        // Оставшимся каналам место может освободиться без завершений в кольце: ждём недолго
+        if (reactor->starved_count > 0 && (timeout_ms < 0 || timeout_ms > URING_STARVED_RETRY_MS)) {
+            timeout_ms = URING_STARVED_RETRY_MS;
+        }
+    }
+
+    unsigned int flags = 0;
+    unsigned int min_complete = 0;
+    struct __kernel_timespec timeout;
+    struct io_uring_getevents_arg arg;
+    const void *enter_arg = NULL;
+    size_t enter_arg_size = 0;
+    if (timeout_ms != 0) {
+        flags |= IORING_ENTER_GETEVENTS;
+        min_complete = 1;
+        if (!(reactor->features & IORING_FEAT_EXT_ARG)) {
+            min_complete += arm_timeout(reactor, timeout_ms);
+        } else if (timeout_ms > 0) {
+            timeout.tv_sec = timeout_ms / 1000;
+            timeout.tv_nsec = (long long)(timeout_ms % 1000) * 1000000;
+            memset(&arg, 0, sizeof(arg));
+            arg.ts = (uint64_t)(uintptr_t)&timeout;
+            flags |= IORING_ENTER_EXT_ARG;
+            enter_arg = &arg;
+            enter_arg_size = sizeof(arg);
+        }
+    }
+    // Публикуем новые SQE (с таймаутом) и ждём хотя бы одно завершение одним системным вызовом
+    store_release(reactor->sq_tail, reactor->sq_local_tail);
+    if (reactor->pending > 0 || min_complete > 0) {
+        int submitted = uring_enter(reactor->ring_fd, reactor->pending, min_complete, flags, enter_arg, enter_arg_size);
+        reactor->enter_calls++;
+        if (submitted < 0 && errno != ETIME && errno != EINTR && errno != EBUSY) {
+            return -1;
+        }
+        if (submitted > 0) {
+            reactor->pending -= (unsigned int)submitted;
+        }
+    }
+
+    // Вычитываем все готовые завершения
+    int ready_count = 0;
+    int processed = 0;
+    unsigned int head = *reactor->cq_head;
+    unsigned int tail = load_acquire(reactor->cq_tail);
+    while (head != tail) {
+        struct io_uring_cqe *cqe = &reactor->cqes[head & *reactor->cq_mask];
+        if (cqe->user_data & URING_TIMEOUT_TAG) {
+            // Служебное завершение; сработавший текущий таймаут больше не нужно снимать
+            if (cqe->user_data == (URING_TIMEOUT_TAG | reactor->timeout_generation)) {
+                reactor->timeout_armed = 0;
+            }
+            head++;
+            continue;
+        }
+        int index = (int)cqe->user_data;
+        SerialChannel *channel = &reactor->channels[index];
+        reactor->armed[index] = 0;
+        if (cqe->res > 0) {
+            fifo_commit_write(&channel->fifo, cqe->res);
+            channel->bytes_received += (uint64_t)cqe->res;
+            reactor->ready[ready_count++] = index;
+        } else if (cqe->res == -EINTR || cqe->res == -EAGAIN) {
+            reactor->ready[ready_count++] = index; // Просто ставим чтение заново
+        } else {
+            channel->hangup = 1;
+            reactor->active--;
+        }
+        head++;
+        processed++;
+    }
+    store_release(reactor->cq_head, head);
+    reactor->completions += (uint64_t)processed;
+
+    // Разбор пачкой, затем новые чтения уйдут со следующим io_uring_enter
+    for (int i = 0; i < ready_count; i++) {
+        int index = reactor->ready[i];
+        parse_uart(&reactor->channels[index].parser);
+        if (!reactor->armed[index]) {
+            arm_read(reactor, index);
+        }
+    }
+    return processed;
+}
@@ -0,0 +1,116 @@
+/**
+ * @file uring_reactor.h
+ * @brief Приём данных с множества портов через io_uring (Linux, без liburing).
+ *
+ * Хранилища FIFO всех каналов регистрируются в кольце как фиксированные
+ * буферы (IORING_REGISTER_BUFFERS), и для каждого канала постоянно висит
+ * чтение IORING_OP_READ_FIXED прямо в свободное место его FIFO_Buffer.
+ * Завершения вычитываются пачкой, затем для каждого затронутого канала
+ * вызывается parse_uart и чтение ставится снова. Отправка новых чтений и
+ * ожидание завершений совмещены в одном io_uring_enter, поэтому число
+ * системных вызовов на байт намного меньше, чем у схемы epoll + read.
+ *
+ * Каналы с растущим FIFO (fifo_set_pool) тоже поддерживаются: когда кольцо
+ * заполнено и свободное место лежит в сегменте пула, вне зарегистрированного
+ * буфера, чтение ставится обычным IORING_OP_READ.
+ */
+#ifndef URING_REACTOR_H
+#define URING_REACTOR_H
+
+#include <linux/time_types.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "serial_reactor.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef URING_STARVED_RETRY_MS
+#define URING_STARVED_RETRY_MS 1 /**< Наибольшее ожидание в uring_reactor_poll, пока у канала нет места под чтение */
+#endif
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+/**
+ * @struct UringReactor
+ * @brief Кольцо io_uring и обслуживаемые им каналы.
+ */
+typedef struct {
+    int ring_fd;                    /**< Дескриптор io_uring */
+    unsigned int features;          /**< Возможности ядра (IORING_FEAT_*) */
+
+    void *sq_ring;                  /**< Отображение кольца отправки */
+    size_t sq_ring_size;            /**< Размер отображения кольца отправки */
+    unsigned int *sq_tail;          /**< Хвост кольца отправки */
+    unsigned int *sq_mask;          /**< Маска кольца отправки */
+    unsigned int *sq_array;         /**< Индексы SQE */
+    struct io_uring_sqe *sqes;      /**< Массив SQE */
+    size_t sqes_size;               /**< Размер отображения массива SQE */
+    unsigned int sq_local_tail;     /**< Хвост с учётом ещё не опубликованных SQE */
+    unsigned int pending;           /**< SQE, ожидающие отправки */
+
+    void *cq_ring;                  /**< Отображение кольца завершений */
+    size_t cq_ring_size;            /**< Размер отображения кольца завершений */
+    unsigned int *cq_head;          /**< Голова кольца завершений */
+    unsigned int *cq_tail;          /**< Хвост кольца завершений */
+    unsigned int *cq_mask;          /**< Маска кольца завершений */
+    struct io_uring_cqe *cqes;      /**< Массив CQE */
+
+    SerialChannel *channels;        /**< Каналы (память принадлежит вызывающему коду) */
+    int channel_count;              /**< Число каналов */
+    int *ready;                     /**< Каналы с новыми данными в текущей пачке */
+    unsigned char *armed;           /**< Есть ли у канала незавершённое чтение */
+    int *starved;                   /**< Каналы без чтения: в FIFO не было места */
+    int starved_count;              /**< Число таких каналов */
+    int active;                     /**< Каналы, которые ещё не закрыты */
+    struct __kernel_timespec wait_timeout; /**< Срок IORING_OP_TIMEOUT (ядра без IORING_FEAT_EXT_ARG) */
+    uint64_t timeout_generation;    /**< Поколение последнего IORING_OP_TIMEOUT (в user_data) */
+    int timeout_armed;              /**< Последний IORING_OP_TIMEOUT ещё не сработал */
+
+    uint64_t enter_calls;           /**< Число вызовов io_uring_enter */
+    uint64_t completions;           /**< Число обработанных завершений */
+} UringReactor;
+
+/**
+ * @brief Создаёт кольцо и регистрирует FIFO каналов как фиксированные буферы.
+ *
+ * Каналы должны быть подготовлены serial_channel_init. Дескрипторы
+ * переводятся в блокирующий режим: ожидание данных берёт на себя io_uring.
+ *
+ * @param reactor Указатель на реактор.
+ * @param channels Массив каналов.
+ * @param count Число каналов.
+ * @return Возвращает 0 при успехе, -1 при ошибке (например, io_uring недоступен).
+ */
+int uring_reactor_init(UringReactor *reactor, SerialChannel *channels, int count);
+
+/**
+ * @brief Освобождает кольцо (дескрипторы каналов не закрываются).
+ *
+ * @param reactor Указатель на реактор.
+ */
+void uring_reactor_destroy(UringReactor *reactor);
+
+/**
+ * @brief Отправляет накопленные чтения, ждёт завершений и обрабатывает их пачкой.
+ *
+ * Если ядро не поддерживает IORING_FEAT_EXT_ARG (до 5.11), срок ожидания
+ * задаётся операцией IORING_OP_TIMEOUT в том же кольце.
+ *
+ * Каналам, у FIFO которых не было места под чтение, чтение ставится заново
+ * в начале вызова; пока такие каналы есть, ожидание не дольше
+ * URING_STARVED_RETRY_MS.
+ *
+ * @param reactor Указатель на реактор.
+ * @param timeout_ms Таймаут ожидания в миллисекундах (-1 - бесконечно, 0 - не ждать).
+ * @return Число обработанных завершений, 0 по таймауту или -1 при ошибке.
+ */
+int uring_reactor_poll(UringReactor *reactor, int timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // URING_REACTOR_H
@@ -0,0 +1,185 @@
+// Пробуждение потока разбора по уровню FIFO (FifoWatermark) через eventfd.
+//
+// Поток записи кладёт поток пакетов в FIFO мелкими порциями всплесками с
+// паузами между ними, поток разбора спит в poll на eventfd и разбирает FIFO
+// только после пробуждения. Сравниваются пробуждение на каждом заголовке
+// или теле и адаптивное объединение; «по записи» - сколько вызовов
+// parse_uart было бы при разборе после каждой записи, как в main.c.
+//
+// Использование: watermark_demo [bursts] [chunk]
+
+#define _GNU_SOURCE
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "monotonic_clock.h"
+#include "parser.h"
+
+#define BURST_PACKETS 200
+#define IDLE_PAUSE_NS 2000000 // пауза между всплесками
+#define EXPIRE_MS 1           // таймаут потребителя, пока в FIFO есть данные ниже уровня
+
+typedef struct {
+    FIFO_Buffer fifo;
+    Parser parser;
+    FifoWatermark watermark;
+    pthread_mutex_t lock;
+    int event_fd;
+    int done;
+    const unsigned char *stream;
+    size_t length;
+    int chunk;
+    unsigned long long writes;
+    unsigned long long parses;
+    unsigned long long packets;
+} Demo;
+
+static void wake_eventfd(void *context) {
+    uint64_t one = 1;
+    if (write(*(int *)context, &one, sizeof(one)) != sizeof(one)) {
+        perror("eventfd write");
+    }
+}
+
+static void count_packet(void *context, unsigned int type, unsigned char *data, unsigned int size) {
+    (void)type;
+    (void)data;
+    (void)size;
+    ((Demo *)context)->packets++;
+}
+
+// Типы и размеры меньше 128: контрольная сумма parse_uart учитывает только младшие байты полей
+static unsigned char *make_stream(int packets, size_t *length) {
+    unsigned char *stream = malloc((size_t)packets * (SYNC_SEQUENCE_LENGTH + MAX_HEADER_SIZE + 128 + 1));
+    unsigned char body[128];
+    memset(body, 0x3C, sizeof(body));
+    *length = 0;
+    for (int i = 0; i < packets; i++) {
+        unsigned int packet_length;
+        build_packet(stream + *length, &packet_length, 16 + (unsigned int)(i * 7) % 100, (unsigned int)i % 100, body);
+        *length += packet_length;
+        stream[(*length)++] = 0x00; // parse_uart дочитывает байт после тела
+    }
+    return stream;
+}
+
+static void *writer_main(void *arg) {
+    Demo *demo = (Demo *)arg;
+    size_t burst_bytes = demo->length / 16 + 1;
+    size_t offset = 0;
+    while (offset < demo->length) {
+        size_t burst_end = offset + burst_bytes < demo->length ? offset + burst_bytes : demo->length;
+        while (offset < burst_end) {
+            int length = burst_end - offset < (size_t)demo->chunk ? (int)(burst_end - offset) : demo->chunk;
+            int written;
+            pthread_mutex_lock(&demo->lock);
+            written = write_fifo(&demo->fifo, demo->stream + offset, length) == 0;
+            pthread_mutex_unlock(&demo->lock);
+            if (written) {
+                offset += (size_t)length;
+                demo->writes++;
+            } else {
+                usleep(20); // FIFO полон: поток разбора уже разбужен
+            }
+        }
+        nanosleep(&(struct timespec){0, IDLE_PAUSE_NS}, NULL);
+    }
+    pthread_mutex_lock(&demo->lock);
+    demo->done = 1;
+    pthread_mutex_unlock(&demo->lock);
+    wake_eventfd(&demo->event_fd);
+    return NULL;
+}
+
+static void run(Demo *demo, int coalesce) {
+    pthread_t writer;
+    uint64_t start;
+    init_fifo(&demo->fifo);
+    init_parser(&demo->parser, &demo->fifo, NULL);
+    parser_set_handler(&demo->parser, count_packet, demo);
+    parser_set_event_sink(&demo->parser, NULL, NULL);
+    fifo_set_watermark(&demo->fifo, &demo->watermark, wake_eventfd, &demo->event_fd);
+    if (coalesce) {
+        fifo_watermark_coalesce(&demo->watermark, 1, MAX_FIFO_SIZE / 2, 200000, monotonic_clock_ns, NULL);
+    }
+    demo->done = 0;
+    demo->writes = 0;
+    demo->parses = 0;
+    demo->packets = 0;
+    start = monotonic_clock_ns(NULL);
+    pthread_create(&writer, NULL, writer_main, demo);
+    for (;;) {
+        int ready;
+        int pending;
+        int done;
+        pthread_mutex_lock(&demo->lock);
+        parse_uart(&demo->parser);
+        demo->parses++;
+        ready = fifo_watermark_arm(&demo->fifo, parser_bytes_needed(&demo->parser));
+        pending = demo->fifo.size;
+        done = demo->done;
+        pthread_mutex_unlock(&demo->lock);
+        if (ready) {
+            continue;
+        }
+        if (done) {
+            break;
+        }
+        // Пустой FIFO: спим без таймаута, канал без данных ничего не стоит
+        struct pollfd pfd = {demo->event_fd, POLLIN, 0};
+        int result = poll(&pfd, 1, pending > 0 ? EXPIRE_MS : -1);
+        if (result == 0) {
+            pthread_mutex_lock(&demo->lock);
+            fifo_watermark_expire(&demo->fifo);
+            pthread_mutex_unlock(&demo->lock);
+        } else if (result > 0) {
+            uint64_t count;
+            if (read(demo->event_fd, &count, sizeof(count)) != sizeof(count)) {
+                perror("eventfd read");
+            }
+        }
+    }
+    pthread_join(writer, NULL);
+    printf("%-10s %8llu %8llu %8llu %8llu %8d %10llu %8.1f\n", coalesce ? "adaptive" : "per-need", demo->writes,
+           (unsigned long long)demo->watermark.wakeups, demo->parses,
+           (unsigned long long)demo->watermark.expirations, demo->watermark.level, demo->packets,
+           (double)(monotonic_clock_ns(NULL) - start) * 1e-6);
+}
+
+int main(int argc, char **argv) {
+    static Demo demo;
+    int bursts = argc > 1 ? atoi(argv[1]) : 16;
+    int packets = bursts * BURST_PACKETS;
+    int failed = 0;
+    demo.chunk = argc > 2 ? atoi(argv[2]) : 16;
+    demo.stream = make_stream(packets, &demo.length);
+    demo.event_fd = eventfd(0, EFD_CLOEXEC);
+    if (demo.event_fd < 0) {
+        perror("eventfd");
+        return EXIT_FAILURE;
+    }
+    pthread_mutex_init(&demo.lock, NULL);
+    printf("%d packets, %zu bytes, %d-byte writes\n", packets, demo.length, demo.chunk);
+    printf("%-10s %8s %8s %8s %8s %8s %10s %8s\n", "mode", "writes", "wakeups", "parses", "expired", "level",
+           "packets", "ms");
+    for (int coalesce = 0; coalesce <= 1; coalesce++) {
+        run(&demo, coalesce);
+        if (demo.packets != (unsigned long long)packets) {
+            failed = 1;
+        }
+    }
+    pthread_mutex_destroy(&demo.lock);
+    close(demo.event_fd);
+    free((void *)demo.stream);
+    if (failed) {
+        fprintf(stderr, "FAILED: lost packets\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}